@@ -0,0 +1,69 @@
+#include "archiver.h"
+#include "database.h"
+
+static const char *kArchiverConnection = "archiver";
+
+// Small transactions keep the write lock short so the GUI connection never waits long
+static const int kBatchSize = 500;
+
+ArchiverWorker::ArchiverWorker(const QString &dbName, QObject *parent)
+    : DatabaseWorker(dbName, kArchiverConnection, parent)
+{}
+
+void ArchiverWorker::prepare(Database *database)
+{
+    database->attachArchive();
+}
+
+void ArchiverWorker::archive(const QDate &cutoff)
+{
+    int plans = 0;
+    int tasks = 0;
+
+    int moved;
+    do {
+        moved = database()->archivePlansBefore(cutoff, kBatchSize);
+        if (plans == 0 && moved > 0) {
+            emit plansArchiving();
+        }
+        plans += moved;
+        QThread::yieldCurrentThread();
+    } while (moved == kBatchSize);
+
+    do {
+        moved = database()->archiveTasksBefore(cutoff, kBatchSize);
+        tasks += moved;
+        QThread::yieldCurrentThread();
+    } while (moved == kBatchSize);
+
+    emit archived(plans, tasks);
+}
+
+Archiver::Archiver(const QString &dbName, int cutoffDays, QObject *parent)
+    : QObject{parent}
+    , m_cutoffDays(cutoffDays)
+{
+    ArchiverWorker *worker = new ArchiverWorker(dbName);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &Archiver::archiveRequested, worker, &ArchiverWorker::archive);
+    connect(worker, &ArchiverWorker::plansArchiving, this, &Archiver::plansArchiving);
+    connect(worker, &ArchiverWorker::archived, this, &Archiver::archived);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+Archiver::~Archiver()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void Archiver::start()
+{
+    if (m_cutoffDays <= 0) {
+        return;
+    }
+    emit archiveRequested(QDate::currentDate().addDays(-m_cutoffDays));
+}
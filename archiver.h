@@ -0,0 +1,58 @@
+#ifndef ARCHIVER_H
+#define ARCHIVER_H
+
+#include "databaseworker.h"
+
+#include <QDate>
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief ArchiverWorker Moves cold rows into the archive file in small batches
+ *        on its own database connection inside the archiver thread
+ */
+class ArchiverWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit ArchiverWorker(const QString &dbName, QObject *parent = nullptr);
+
+public slots:
+    void archive(const QDate &cutoff);
+
+signals:
+    void plansArchiving();
+    void archived(int plans, int tasks);
+
+protected:
+    void prepare(Database *database) override;
+};
+
+/**
+ * @brief Archiver Keeps finished tasks and plan history older than cutoffDays
+ *        out of the hot tables; runs once per start
+ */
+class Archiver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Archiver(const QString &dbName, int cutoffDays, QObject *parent = nullptr);
+    ~Archiver();
+
+    void start();
+
+signals:
+    /**
+     * @brief plansArchiving The first plan batch moved, and with it the archived
+     *        date boundary other connections must reread
+     */
+    void plansArchiving();
+    void archived(int plans, int tasks);
+    void archiveRequested(const QDate &cutoff);
+
+private:
+    QThread m_thread;
+    int m_cutoffDays;
+};
+
+#endif // ARCHIVER_H
@@ -0,0 +1,179 @@
+#include "autosaver.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+static const char *kAutoSaverConnection = "autosaver";
+
+namespace {
+
+QByteArray batchToJson(const EditBatch &batch)
+{
+    QJsonObject root;
+    root.insert("date", batch.date.toString(Qt::ISODate));
+
+    QJsonArray removed;
+    for (int id : batch.removedIds) {
+        removed.append(id);
+    }
+    root.insert("removed", removed);
+
+    QJsonArray changes;
+    for (const PlanChange &change : batch.changes) {
+        QJsonObject object;
+        object.insert("id", change.id);
+        object.insert("task_id", change.taskId);
+        object.insert("habit_id", change.habitId);
+        object.insert("name", change.name);
+        object.insert("index_id", change.indexId);
+        object.insert("status", static_cast<int>(change.status));
+        changes.append(object);
+    }
+    root.insert("changes", changes);
+
+    if (batch.hasReview) {
+        QJsonObject review;
+        review.insert("type", batch.reviewType);
+        review.insert("reflection", batch.reflection);
+        review.insert("summary", batch.summary);
+        root.insert("review", review);
+    }
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool batchFromJson(const QByteArray &json, EditBatch &batch)
+{
+    const QJsonObject root = QJsonDocument::fromJson(json).object();
+    batch.date = QDate::fromString(root.value("date").toString(), Qt::ISODate);
+    if (!batch.date.isValid()) {
+        return false;
+    }
+
+    const QJsonArray removed = root.value("removed").toArray();
+    for (const QJsonValue &id : removed) {
+        batch.removedIds.append(id.toInt());
+    }
+
+    const QJsonArray changes = root.value("changes").toArray();
+    for (const QJsonValue &value : changes) {
+        const QJsonObject object = value.toObject();
+        PlanChange change;
+        change.id = object.value("id").toInt();
+        change.taskId = object.value("task_id").toInt();
+        change.habitId = object.value("habit_id").toInt();
+        change.name = object.value("name").toString();
+        change.indexId = object.value("index_id").toInt();
+        change.status = Utils::planStatusFromInt(object.value("status").toInt());
+        batch.changes.append(change);
+    }
+
+    const QJsonObject review = root.value("review").toObject();
+    batch.hasReview = !review.isEmpty();
+    batch.reviewType = review.value("type").toString();
+    batch.reflection = review.value("reflection").toString();
+    batch.summary = review.value("summary").toString();
+    return true;
+}
+
+} // namespace
+
+AutoSaverWorker::AutoSaverWorker(const QString &dbName, const QString &journalPath, QObject *parent)
+    : DatabaseWorker(dbName, kAutoSaverConnection, parent)
+    , m_journalPath(journalPath)
+{}
+
+void AutoSaverWorker::journal(const EditBatch &batch)
+{
+    // Written to a temporary file and renamed, so a crash never leaves half a journal
+    QSaveFile file(m_journalPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "写入编辑日志失败:" << file.errorString();
+        return;
+    }
+    file.write(batchToJson(batch));
+    if (!file.commit()) {
+        qDebug() << "写入编辑日志失败:" << file.errorString();
+    }
+}
+
+void AutoSaverWorker::save(int saveId, const EditBatch &batch)
+{
+    journal(batch);
+
+    QList<int> insertedIds;
+    bool ok = database()->saveEdits(batch, &insertedIds);
+    if (ok) {
+        QFile::remove(m_journalPath);
+    }
+    emit saved(saveId, ok, insertedIds);
+}
+
+AutoSaver::AutoSaver(const QString &dbName, const QString &journalPath, QObject *parent)
+    : QObject{parent}
+    , m_lastSave(0)
+{
+    m_worker = new AutoSaverWorker(dbName, journalPath);
+    m_worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(this, &AutoSaver::journalRequested, m_worker, &AutoSaverWorker::journal);
+    connect(this, &AutoSaver::saveRequested, m_worker, &AutoSaverWorker::save);
+    connect(m_worker, &AutoSaverWorker::saved, this, &AutoSaver::saved);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+AutoSaver::~AutoSaver()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void AutoSaver::journal(const EditBatch &batch)
+{
+    emit journalRequested(batch);
+}
+
+int AutoSaver::save(const EditBatch &batch)
+{
+    emit saveRequested(++m_lastSave, batch);
+    return m_lastSave;
+}
+
+void AutoSaver::waitForIdle()
+{
+    // The worker runs queued calls in order, so an empty one returns after the last batch
+    QMetaObject::invokeMethod(m_worker, [] {}, Qt::BlockingQueuedConnection);
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+QString AutoSaver::journalPath(const QString &dbFile)
+{
+    return dbFile + QStringLiteral(".journal");
+}
+
+bool AutoSaver::recover(Database &database, const QString &journalPath)
+{
+    QFile file(journalPath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "读取编辑日志失败:" << file.errorString();
+        return false;
+    }
+
+    EditBatch batch;
+    bool ok = batchFromJson(file.readAll(), batch) && database.saveEdits(batch);
+    file.close();
+    if (!ok) {
+        qDebug() << "恢复未保存的编辑失败:" << journalPath;
+        return false;
+    }
+    return QFile::remove(journalPath);
+}
@@ -0,0 +1,70 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include "database.h"
+#include "databaseworker.h"
+
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief AutoSaverWorker Writes edit batches on its own database connection
+ *        inside the saver thread, journaling each batch until it is committed
+ */
+class AutoSaverWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit AutoSaverWorker(const QString &dbName, const QString &journalPath, QObject *parent = nullptr);
+
+public slots:
+    void journal(const EditBatch &batch);
+    void save(int saveId, const EditBatch &batch);
+
+signals:
+    void saved(int saveId, bool ok, const QList<int> &insertedIds);
+
+private:
+    QString m_journalPath;
+};
+
+/**
+ * @brief AutoSaver Saves coalesced plan and review edits off the GUI thread.
+ *        Unsaved edits are kept in a journal next to the database file and
+ *        replayed on the next start if the application dies before saving.
+ */
+class AutoSaver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AutoSaver(const QString &dbName, const QString &journalPath, QObject *parent = nullptr);
+    ~AutoSaver();
+
+    void journal(const EditBatch &batch);
+    int save(const EditBatch &batch);
+
+    /**
+     * @brief waitForIdle Blocks until every queued batch is written and its
+     *        saved() signal has been delivered
+     */
+    void waitForIdle();
+
+    static QString journalPath(const QString &dbFile);
+
+    /**
+     * @brief recover Replays a journal left behind by an unfinished save
+     */
+    static bool recover(Database &database, const QString &journalPath);
+
+signals:
+    void saved(int saveId, bool ok, const QList<int> &insertedIds);
+    void journalRequested(const EditBatch &batch);
+    void saveRequested(int saveId, const EditBatch &batch);
+
+private:
+    QThread m_thread;
+    AutoSaverWorker *m_worker;
+    int m_lastSave;
+};
+
+#endif // AUTOSAVER_H
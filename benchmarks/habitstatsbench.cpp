@@ -0,0 +1,154 @@
+// Times the habit streak paths on a synthetic history: the per-habit SQL read and
+// calendar walk of Database::getHabitMaxTimes against one completion read folded
+// into HabitStats bitsets. The two must report the same longest streak for every
+// habit before anything is timed.
+//
+// Usage: habitstats_bench [habits] [years]
+
+#include "../database.h"
+#include "../habitstats.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+namespace {
+
+const int kRuns = 5;
+
+const QStringList kFrequencies = {
+    "每日一次", "每二日一次", "每三日一次", "每周工作日", "每周休息日", "每周周三"
+};
+
+QList<HabitData> seed(Database &database, int habitCount, int years)
+{
+    const QDate today = QDate::currentDate();
+    const QDate firstDay = today.addYears(-years);
+    QRandomGenerator random(20240101);
+
+    QList<HabitData> habits;
+    QSqlQuery query(QSqlDatabase::database());
+    QSqlDatabase::database().transaction();
+    for (int i = 0; i < habitCount; ++i) {
+        HabitData habit;
+        habit.name = QString("习惯%1").arg(i + 1);
+        habit.target_frequency = kFrequencies.at(i % kFrequencies.size());
+        habit.createdDate = firstDay;
+        habit.status = HabitStatus::InProgress;
+        habit.id = database.addHabit(habit);
+
+        query.prepare("UPDATE habits SET created_date = ? WHERE id = ?");
+        query.addBindValue(firstDay);
+        query.addBindValue(habit.id);
+        query.exec();
+        habits.append(habit);
+    }
+
+    // One row per due day, most of them completed, in runs broken by a miss now and then
+    query.prepare("INSERT INTO daily_plan (habit_id, plan_date, index_id, status) VALUES (?, ?, ?, ?)");
+    for (const HabitData &habit : std::as_const(habits)) {
+        const HabitSchedule schedule = Utils::habitSchedule(habit.target_frequency);
+        int index = 0;
+        for (QDate day = firstDay; day <= today; day = day.addDays(1)) {
+            if (!schedule.isDue(firstDay, day)) continue;
+            query.addBindValue(habit.id);
+            query.addBindValue(day);
+            query.addBindValue(++index);
+            query.addBindValue(random.bounded(100) < 92 ? 1 : 2);
+            if (!query.exec()) {
+                qDebug() << "写入测试数据失败:" << query.lastError().text();
+                return QList<HabitData>();
+            }
+        }
+    }
+    QSqlDatabase::database().commit();
+    return habits;
+}
+
+// Best of kRuns, in milliseconds
+template <typename Run>
+double best(Run run)
+{
+    double fastest = -1;
+    for (int i = 0; i < kRuns; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        double elapsed = timer.nsecsElapsed() / 1e6;
+        fastest = fastest < 0 ? elapsed : qMin(fastest, elapsed);
+    }
+    return fastest;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int habitCount = args.size() > 1 ? qMax(1, args.at(1).toInt()) : 50;
+    const int years = args.size() > 2 ? qMax(1, args.at(2).toInt()) : 10;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qDebug() << "创建临时目录失败:" << dir.errorString();
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    QList<HabitData> habits;
+    {
+        Database database(dir.filePath("bench.db"));
+        habits = seed(database, habitCount, years);
+        if (habits.isEmpty()) {
+            return 1;
+        }
+        out << habits.size() << " habits x " << years << " years\n";
+
+        // Both paths must agree on every habit before either is timed
+        HabitStats stats;
+        stats.rebuild(habits, database.getHabitCompletions());
+        for (const HabitData &habit : std::as_const(habits)) {
+            const int expected = database.getHabitMaxTimes(habit);
+            const int actual = stats.longestStreak(habit.id);
+            if (actual != expected) {
+                out << "streak mismatch for " << habit.name << " (" << habit.target_frequency << "): "
+                    << "getHabitMaxTimes " << expected << ", HabitStats " << actual << "\n";
+                return 1;
+            }
+        }
+
+        qint64 checksum = 0;
+        const double sqlWalk = best([&] {
+            for (const HabitData &habit : std::as_const(habits)) {
+                checksum += database.getHabitMaxTimes(habit);
+            }
+        });
+
+        const double bitsetsWithRead = best([&] {
+            HabitStats stats;
+            stats.rebuild(habits, database.getHabitCompletions());
+            for (const HabitData &habit : std::as_const(habits)) {
+                checksum += stats.longestStreak(habit.id);
+            }
+        });
+
+        const double bitsetsOnly = best([&] {
+            for (const HabitData &habit : std::as_const(habits)) {
+                checksum += stats.longestStreak(habit.id) + stats.currentStreak(habit.id)
+                            + stats.completedDays(habit.id, QDate::currentDate().addDays(-365), QDate::currentDate());
+            }
+        });
+
+        out << "getHabitMaxTimes, every habit:         " << sqlWalk << " ms\n";
+        out << "HabitStats read + rebuild + streaks:   " << bitsetsWithRead << " ms\n";
+        out << "HabitStats streaks and 1y window only: " << bitsetsOnly << " ms\n";
+        out << "(checksum " << checksum << ")\n";
+    }
+    QSqlDatabase::removeDatabase(QLatin1String(QSqlDatabase::defaultConnection));
+    return 0;
+}
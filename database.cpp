@@ -1,22 +1,237 @@
 #include "database.h"
+#include "periodcalendar.h"
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QAtomicInt>
+#include <QtConcurrentMap>
 
-Database::Database(const QString &dbName) {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
+static const QLatin1String kTaskColumns("id, name, created_date, due_date, completed_date, status");
+static const QLatin1String kPlanColumns("id, task_id, habit_id, plan_date, plan_name, name_id, index_id, status");
+static const QLatin1String kReviewColumns("id, type, review_date, period_start, period_end, period_key, reflection, summary");
+
+// SQLite allows ten attached files by default; leave room for the archive
+static const int kMaxAttachedShards = 6;
+
+// Review bodies at least this long (UTF-8 bytes) are stored as qCompress blobs
+static const int kReviewCompressThreshold = 512;
+
+// Finished tasks are archived by the day they ended; cancelled ones have no completed_date
+static const QLatin1String kArchivableTask("status IN (1, 3, 4) "
+                                           "AND COALESCE(NULLIF(completed_date, ''), due_date, created_date) < ?");
+
+// Search index rowids are (kind << kSearchKindShift) | source id, one entry per source row
+static const int kSearchKindShift = 40;
+
+namespace {
+
+QString shardSchema(int year)
+{
+    return QString("y%1").arg(year);
+}
+
+void readRows(QSqlQuery &query, QList<QVariantList> &rows)
+{
+    const int columns = query.record().count();
+    while (query.next()) {
+        QVariantList row;
+        row.reserve(columns);
+        for (int i = 0; i < columns; ++i) {
+            row.append(query.value(i));
+        }
+        rows.append(row);
+    }
+}
+
+struct ShardQuery {
+    QString path;
+    QString sql;
+    QVariantList binds;
+};
+
+// Runs on a pool thread with a private read-only connection to one year file
+QList<QVariantList> runShardQuery(const ShardQuery &shardQuery)
+{
+    static QAtomicInt counter;
+    const QString connectionName = QString("shard_reader_%1").arg(counter.fetchAndAddRelaxed(1));
+
+    QList<QVariantList> rows;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(shardQuery.path);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (db.open()) {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare(shardQuery.sql);
+            for (const QVariant &value : shardQuery.binds) {
+                query.addBindValue(value);
+            }
+            if (query.exec()) {
+                readRows(query, rows);
+            } else {
+                qDebug() << "查询年度分片失败:" << query.lastError().text();
+            }
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return rows;
+}
+
+// Opens path read-only and runs SQLite's quick check, so a truncated snapshot is never swapped in
+bool isIntactDatabase(const QString &path)
+{
+    if (!QFileInfo::exists(path)) {
+        return false;
+    }
+
+    static QAtomicInt counter;
+    const QString connectionName = QString("integrity_check_%1").arg(counter.fetchAndAddRelaxed(1));
+    bool intact = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(path);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (db.open()) {
+            QSqlQuery query(db);
+            intact = query.exec("PRAGMA quick_check") && query.next() && query.value(0).toString() == "ok";
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return intact;
+}
+
+// A flush that died between its two renames leaves no file at filePath: the new
+// snapshot is taken back when it is complete, the previous file otherwise
+void recoverInterruptedFlush(const QString &filePath)
+{
+    if (QFileInfo::exists(filePath)) {
+        return;
+    }
+
+    const QString tempPath = filePath + ".flush";
+    const QString backupPath = filePath + ".bak";
+    if (isIntactDatabase(tempPath) && QFile::rename(tempPath, filePath)) {
+        qDebug() << "已从未完成的写回恢复数据库:" << tempPath;
+        return;
+    }
+    if (QFileInfo::exists(backupPath) && QFile::rename(backupPath, filePath)) {
+        qDebug() << "已从备份恢复数据库:" << backupPath;
+    }
+}
+
+// "?, ?, ?" for an IN list of count bound values
+QString placeholderList(int count)
+{
+    QStringList placeholders;
+    placeholders.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        placeholders.append("?");
+    }
+    return placeholders.join(", ");
+}
+
+QVariant packReviewText(const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+    if (utf8.size() < kReviewCompressThreshold) {
+        return text;
+    }
+    return qCompress(utf8, 9);
+}
+
+// A quoted FTS5 phrase, so user input is never parsed as query syntax
+QString ftsPhrase(const QString &text)
+{
+    QString phrase = text;
+    phrase.replace('"', "\"\"");
+    return '"' + phrase + '"';
+}
+
+// Sort keys map onto the expressions the task indexes are built on; NULL dates sort first
+QString taskSortExpression(TaskQuery::SortKey sortKey)
+{
+    switch (sortKey) {
+    case TaskQuery::SortKey::Name:
+        return QStringLiteral("name");
+    case TaskQuery::SortKey::CreatedDate:
+        return QStringLiteral("IFNULL(created_date, '')");
+    case TaskQuery::SortKey::DueDate:
+        return QStringLiteral("IFNULL(due_date, '')");
+    case TaskQuery::SortKey::Id:
+        break;
+    }
+    return QStringLiteral("id");
+}
+
+// Keeps search_index in step with a plain-text name column
+QString searchTrigger(const QString &table, const QString &event, SearchKind kind)
+{
+    return QString("CREATE TRIGGER IF NOT EXISTS search_%1_%2 AFTER %3 ON %1 BEGIN "
+                   "INSERT OR REPLACE INTO search_index (rowid, body, kind, ref_id) "
+                   "VALUES ((%4 << %5) | new.id, new.name, %4, new.id); "
+                   "END")
+        .arg(table, event == "INSERT" ? QStringLiteral("insert") : QStringLiteral("update"), event)
+        .arg(static_cast<int>(kind))
+        .arg(kSearchKindShift);
+}
+
+// Link table of a tag kind and its task or habit id column
+QLatin1String tagLinkTable(TagKind kind)
+{
+    return kind == TagKind::Task ? QLatin1String("task_tag") : QLatin1String("habit_tag");
+}
+
+QLatin1String tagRefColumn(TagKind kind)
+{
+    return kind == TagKind::Task ? QLatin1String("task_id") : QLatin1String("habit_id");
+}
+
+QString unpackReviewText(const QVariant &value)
+{
+    // Short bodies stay TEXT, long ones come back as BLOB
+    if (value.typeId() == QMetaType::QByteArray) {
+        return QString::fromUtf8(qUncompress(value.toByteArray()));
+    }
+    return value.toString();
+}
+
+} // namespace
+
+Database::Database(const QString &dbName, const QString &connectionName)
+    : m_archiveAttached(false)
+    , m_yearShards(false)
+    , m_searchIndex(false)
+{
+    // Every connection to the same memory name shares one database in this process
+    m_inMemory = dbName.startsWith("file:") && dbName.contains("mode=memory");
+    m_filePath = m_inMemory ? dbName.mid(5).section('?', 0, 0) : dbName;
+
+    m_db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
     m_db.setDatabaseName(dbName);
+    m_db.setConnectOptions(m_inMemory ? "QSQLITE_BUSY_TIMEOUT=5000;QSQLITE_OPEN_URI" : "QSQLITE_BUSY_TIMEOUT=5000");
     if (!m_db.open()) {
         qDebug() << "Error: " << m_db.lastError().text();
     } else {
         qDebug() << "Database opened";
     }
 
+    if (m_inMemory) {
+        loadFromDisk();
+    }
     createTables();
+
+    if (QFileInfo::exists(archivePath())) {
+        attachArchive();
+    }
 }
 
 void Database::createTables()
 {
-    QSqlQuery query;
+    QSqlQuery query(m_db);
 
     query.exec(
         "CREATE TABLE IF NOT EXISTS task ("
@@ -45,6 +260,7 @@ void Database::createTables()
         "habit_id INTEGER, "
         "plan_date DATE NOT NULL, "
         "plan_name TEXT, "
+        "name_id INTEGER REFERENCES name_dict(id), "
         "index_id INTEGER, "
         "status INTEGER DEFAULT 0, "
         "FOREIGN KEY (task_id) REFERENCES task(id) ON DELETE CASCADE, "
@@ -60,33 +276,382 @@ void Database::createTables()
         "review_date DATE NOT NULL, "
         "period_start DATE, "
         "period_end DATE, "
+        "period_key INTEGER, "
+        "reflection TEXT, "
+        "summary TEXT"
+        ")"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS name_dict ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "name TEXT NOT NULL UNIQUE"
+        ")"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS review_draft ("
+        "period_key INTEGER PRIMARY KEY, "
         "reflection TEXT, "
         "summary TEXT"
         ")"
     );
+
+    // Subtask hierarchy: one row per ancestor/descendant pair at any depth, so subtrees
+    // and rollups are index range reads. A task gets its depth 0 row when it first
+    // joins a hierarchy; rows outlive archiving, which keeps ids.
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS task_closure ("
+        "ancestor INTEGER NOT NULL, "
+        "descendant INTEGER NOT NULL, "
+        "depth INTEGER NOT NULL, "
+        "PRIMARY KEY (ancestor, descendant)"
+        ") WITHOUT ROWID"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS tag ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "name TEXT NOT NULL UNIQUE"
+        ")"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS task_tag ("
+        "tag_id INTEGER NOT NULL REFERENCES tag(id) ON DELETE CASCADE, "
+        "task_id INTEGER NOT NULL, "
+        "PRIMARY KEY (tag_id, task_id)"
+        ") WITHOUT ROWID"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS habit_tag ("
+        "tag_id INTEGER NOT NULL REFERENCES tag(id) ON DELETE CASCADE, "
+        "habit_id INTEGER NOT NULL REFERENCES habits(id) ON DELETE CASCADE, "
+        "PRIMARY KEY (tag_id, habit_id)"
+        ") WITHOUT ROWID"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS storage_meta ("
+        "key TEXT PRIMARY KEY, "
+        "value TEXT"
+        ")"
+    );
+
+    query.exec("CREATE INDEX IF NOT EXISTS idx_daily_plan_date ON daily_plan (plan_date, index_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_daily_plan_habit ON daily_plan (habit_id, plan_date)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_daily_plan_name ON daily_plan (name_id, plan_date)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_status_due ON task (status, due_date)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_name ON task (name, id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_created ON task (IFNULL(created_date, ''), id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_due ON task (IFNULL(due_date, ''), id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_closure_depth ON task_closure (ancestor, depth)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_closure_descendant ON task_closure (descendant, depth)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_task_tag_task ON task_tag (task_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_habit_tag_habit ON habit_tag (habit_id)");
+
+    // Migrations need to know where plan and review rows live
+    if (query.exec("SELECT value FROM storage_meta WHERE key = 'year_shards'") && query.next()) {
+        m_yearShards = query.value(0).toInt() == 1;
+    }
+
+    migrateSchema();
+
+    m_searchIndex = query.exec("SELECT 1 FROM sqlite_master WHERE name = 'search_index'") && query.next();
+}
+
+void Database::migrateSchema()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        return;
+    }
+    int version = query.value(0).toInt();
+
+    if (version < 1) {
+        // Plan names move into name_dict; rows keep only the id
+        m_db.transaction();
+        bool hasNameId = false;
+        query.exec("PRAGMA table_info(daily_plan)");
+        while (query.next()) {
+            if (query.value(1).toString() == "name_id") hasNameId = true;
+        }
+        bool ok = hasNameId || query.exec("ALTER TABLE daily_plan ADD COLUMN name_id INTEGER REFERENCES name_dict(id)");
+        ok = ok && query.exec("INSERT OR IGNORE INTO name_dict (name) "
+                              "SELECT DISTINCT plan_name FROM daily_plan "
+                              "WHERE name_id IS NULL AND plan_name IS NOT NULL");
+        ok = ok && query.exec("UPDATE daily_plan "
+                              "SET name_id = (SELECT id FROM name_dict WHERE name = daily_plan.plan_name), plan_name = NULL "
+                              "WHERE name_id IS NULL AND plan_name IS NOT NULL");
+        ok = ok && query.exec("PRAGMA user_version = 1");
+        if (!ok) {
+            qDebug() << "迁移计划名称失败:" << query.lastError().text();
+            m_db.rollback();
+            return;
+        }
+        m_db.commit();
+    }
+
+    if (version < 2) {
+        // Long review bodies written before compression existed
+        m_db.transaction();
+        QSqlQuery update(m_db);
+        update.prepare("UPDATE daily_review SET reflection = ?, summary = ? WHERE id = ?");
+        bool ok = query.exec(QString("SELECT id, reflection, summary FROM daily_review "
+                                     "WHERE length(CAST(reflection AS BLOB)) >= %1 "
+                                     "OR length(CAST(summary AS BLOB)) >= %1").arg(kReviewCompressThreshold));
+        while (ok && query.next()) {
+            update.addBindValue(packReviewText(query.value(1).toString()));
+            update.addBindValue(packReviewText(query.value(2).toString()));
+            update.addBindValue(query.value(0));
+            ok = update.exec();
+        }
+        ok = ok && query.exec("PRAGMA user_version = 2");
+        if (!ok) {
+            qDebug() << "压缩总结失败:" << query.lastError().text() << update.lastError().text();
+            m_db.rollback();
+            return;
+        }
+        m_db.commit();
+    }
+
+    if (version < 3) {
+        // Reviews are looked up by integer period key; drafts are a cache and start over
+        m_db.transaction();
+        bool ok = ensurePeriodKeys(QStringLiteral("main"));
+        ok = ok && query.exec("DROP TABLE IF EXISTS review_draft");
+        ok = ok && query.exec("CREATE TABLE review_draft ("
+                              "period_key INTEGER PRIMARY KEY, "
+                              "reflection TEXT, "
+                              "summary TEXT"
+                              ")");
+        ok = ok && query.exec("PRAGMA user_version = 3");
+        if (!ok) {
+            qDebug() << "迁移总结周期失败:" << query.lastError().text();
+            m_db.rollback();
+            return;
+        }
+        m_db.commit();
+    }
+
+    if (version < 4) {
+        // Full-text search; left for the next start if SQLite lacks FTS5. Reviews are
+        // read first because year files cannot be attached inside the transaction.
+        const QList<QVariantList> reviews = selectRows(ShardedTable::Review,
+                                                       "SELECT period_key, reflection, summary "
+                                                       "FROM %1 "
+                                                       "WHERE period_key IS NOT NULL;",
+                                                       {}, QDate(), QDate());
+        m_db.transaction();
+        bool ok = createSearchIndex();
+        m_searchIndex = ok;
+        for (const QVariantList &row : reviews) {
+            ok = ok && indexReview(row.at(0).toLongLong(), unpackReviewText(row.at(1)), unpackReviewText(row.at(2)));
+        }
+        ok = ok && query.exec("PRAGMA user_version = 4");
+        if (!ok) {
+            qDebug() << "创建搜索索引失败:" << query.lastError().text();
+            m_db.rollback();
+            return;
+        }
+        m_db.commit();
+    }
+}
+
+const QString &Database::planName(int nameId)
+{
+    if (m_names.isEmpty()) {
+        QSqlQuery query(m_db);
+        query.setForwardOnly(true);
+        if (query.exec("SELECT id, name FROM name_dict")) {
+            while (query.next()) {
+                QString name = query.value(1).toString();
+                m_nameIds.insert(name, query.value(0).toInt());
+                m_names.insert(query.value(0).toInt(), name);
+            }
+        }
+    }
+
+    auto it = m_names.constFind(nameId);
+    if (it != m_names.constEnd()) {
+        return it.value();
+    }
+
+    // Written by another connection since the dictionary was loaded
+    QSqlQuery query(m_db);
+    query.prepare("SELECT name FROM name_dict WHERE id = ?");
+    query.addBindValue(nameId);
+    if (!query.exec() || !query.next()) {
+        static const QString empty;
+        return empty;
+    }
+    QString name = query.value(0).toString();
+    m_nameIds.insert(name, nameId);
+    return m_names.insert(nameId, name).value();
+}
+
+int Database::planNameId(const QString &name)
+{
+    auto it = m_nameIds.constFind(name);
+    if (it != m_nameIds.constEnd()) {
+        return it.value();
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR IGNORE INTO name_dict (name) VALUES (?)");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("SELECT id FROM name_dict WHERE name = ?");
+    query.addBindValue(name);
+    if (!query.exec() || !query.next()) {
+        return 0;
+    }
+
+    int nameId = query.value(0).toInt();
+    m_nameIds.insert(name, nameId);
+    m_names.insert(nameId, name);
+    return nameId;
+}
+
+void TaskQuery::continueAfter(const TaskData &task)
+{
+    afterId = task.id;
+    switch (sortKey) {
+    case SortKey::Name:
+        afterValue = task.name;
+        break;
+    case SortKey::CreatedDate:
+        afterValue = task.createdDate.isValid() ? task.createdDate.toString(Qt::ISODate) : QString("");
+        break;
+    case SortKey::DueDate:
+        afterValue = task.dueDate.isValid() ? task.dueDate.toString(Qt::ISODate) : QString("");
+        break;
+    case SortKey::Id:
+        afterValue = QVariant();
+        break;
+    }
 }
 
 QList<TaskData> Database::getTaskByStatus(int status)
+{
+    TaskQuery taskQuery;
+    if (status > 0) {
+        taskQuery.statuses.append(Utils::taskStatusFromInt(status - 1));
+    }
+    return queryTasks(taskQuery);
+}
+
+QList<TaskData> Database::queryTasks(const TaskQuery &taskQuery)
 {
     QList<TaskData> taskDataList;
-    QSqlQuery query;
+    QStringList conditions;
+    QVariantList binds;
+
+    // Only finished tasks are ever archived
+    bool includeArchive = taskQuery.statuses.isEmpty();
+    const QString statusList = placeholderList(taskQuery.statuses.size());
+    if (!taskQuery.statuses.isEmpty()) {
+        for (TaskStatus status : taskQuery.statuses) {
+            binds.append(static_cast<int>(status));
+            includeArchive = includeArchive
+                             || status == TaskStatus::Completed
+                             || status == TaskStatus::LateCompleted
+                             || status == TaskStatus::Cancelled;
+        }
+        conditions.append(QString("status IN (%1)").arg(statusList));
+    }
 
-    if (status == 0) {
-        if (!query.exec("SELECT id, name, created_date, due_date, completed_date, status "
-                        "FROM task"))
-        {
-            return taskDataList;
+    if (!taskQuery.ids.isEmpty()) {
+        conditions.append(QString("t.id IN (%1)").arg(placeholderList(taskQuery.ids.size())));
+        for (int id : taskQuery.ids) {
+            binds.append(id);
         }
-    } else {
-        status = status - 1;
-        query.prepare("SELECT id, name, created_date, due_date, completed_date, status "
-                      "FROM task "
-                      "WHERE status = ?");
-        query.addBindValue(status);
-        if (!query.exec())
-        {
-            return taskDataList;
+    }
+    if (taskQuery.parentId > 0) {
+        conditions.append("t.id IN (SELECT descendant FROM main.task_closure WHERE ancestor = ? AND depth = 1)");
+        binds.append(taskQuery.parentId);
+    }
+    if (taskQuery.tagFiltered) {
+        conditions.append("t.id IN temp.task_tag_filter");
+    }
+    if (taskQuery.rootsOnly) {
+        // The parent's status is read by primary key, so each row costs two index lookups
+        QString parentListed = QStringLiteral("1");
+        if (!taskQuery.statuses.isEmpty()) {
+            QString parentStatus = QStringLiteral("(SELECT status FROM main.task WHERE id = c.ancestor)");
+            if (m_archiveAttached && includeArchive) {
+                parentStatus = QString("COALESCE(%1, (SELECT status FROM archive.task WHERE id = c.ancestor))").arg(parentStatus);
+            }
+            parentListed = QString("%1 IN (%2)").arg(parentStatus, statusList);
+            for (TaskStatus status : taskQuery.statuses) {
+                binds.append(static_cast<int>(status));
+            }
+        }
+        conditions.append(QString("NOT EXISTS (SELECT 1 FROM main.task_closure c "
+                                  "WHERE c.descendant = t.id AND c.depth = 1 AND %1)").arg(parentListed));
+    }
+
+    if (taskQuery.dueFrom.isValid()) {
+        conditions.append("due_date >= ?");
+        binds.append(taskQuery.dueFrom);
+    }
+    if (taskQuery.dueTo.isValid()) {
+        conditions.append("due_date <= ?");
+        binds.append(taskQuery.dueTo);
+    }
+
+    const QString needle = taskQuery.nameContains.trimmed();
+    if (m_searchIndex && needle.size() >= 3) {
+        // The trigram index answers substrings without reading every name
+        conditions.append(QString("id IN (SELECT ref_id FROM main.search_index "
+                                  "WHERE search_index MATCH ? AND kind = %1)").arg(static_cast<int>(SearchKind::Task)));
+        binds.append(ftsPhrase(needle));
+    } else if (!needle.isEmpty()) {
+        conditions.append("instr(lower(name), lower(?)) > 0");
+        binds.append(needle);
+    }
+
+    const QString sortExpression = taskSortExpression(taskQuery.sortKey);
+    const QLatin1String direction(taskQuery.descending ? "DESC" : "ASC");
+    if (taskQuery.afterId > 0) {
+        const QLatin1Char op(taskQuery.descending ? '<' : '>');
+        if (taskQuery.sortKey == TaskQuery::SortKey::Id) {
+            conditions.append(QString("id %1 ?").arg(op));
+        } else {
+            // The plain bound lets SQLite seek the (expression, id) index to the cursor;
+            // the row value comparison then skips ties already read
+            conditions.append(QString("%1 %2= ? AND (%1, id) %2 (?, ?)").arg(sortExpression).arg(op));
+            binds.append(taskQuery.afterValue);
+            binds.append(taskQuery.afterValue);
         }
+        binds.append(taskQuery.afterId);
+    }
+
+    QString sql = QString("SELECT %1 FROM %2 AS t").arg(kTaskColumns, taskSource(includeArchive));
+    if (!conditions.isEmpty()) {
+        sql += " WHERE " + conditions.join(" AND ");
+    }
+    if (taskQuery.sortKey == TaskQuery::SortKey::Id) {
+        sql += QString(" ORDER BY id %1").arg(direction);
+    } else {
+        sql += QString(" ORDER BY %1 %2, id %2").arg(sortExpression, direction);
+    }
+    if (taskQuery.limit > 0) {
+        sql += " LIMIT ?";
+        binds.append(taskQuery.limit);
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (const QVariant &value : std::as_const(binds)) {
+        query.addBindValue(value);
+    }
+    if (!query.exec()) {
+        qDebug() << "查询任务失败:" << query.lastError().text();
+        return taskDataList;
     }
 
     while (query.next()) {
@@ -96,7 +661,7 @@ QList<TaskData> Database::getTaskByStatus(int status)
         taskData.createdDate = query.value(2).toDate();
         taskData.dueDate = query.value(3).toDate();
         taskData.completedDate = query.value(4).toDate();
-        taskData.status = query.value(5).toInt();
+        taskData.status = Utils::taskStatusFromInt(query.value(5).toInt());
         taskDataList.append(taskData);
     }
 
@@ -106,7 +671,7 @@ QList<TaskData> Database::getTaskByStatus(int status)
 QList<HabitData> Database::getHabitByStatus(int status)
 {
     QList<HabitData> habitDataList;
-    QSqlQuery query;
+    QSqlQuery query(m_db);
 
     if (status == 0) {
         if (!query.exec("SELECT id, name, created_date, target_frequency, status "
@@ -131,7 +696,7 @@ QList<HabitData> Database::getHabitByStatus(int status)
         habitData.name = query.value(1).toString();
         habitData.createdDate = query.value(2).toDate();
         habitData.target_frequency = query.value(3).toString();
-        habitData.status = query.value(4).toInt();
+        habitData.status = Utils::habitStatusFromInt(query.value(4).toInt());
 
         habitDataList.append(habitData);
     }
@@ -143,24 +708,26 @@ QList<PlanData> Database::getPlanByDate(const QDate &date)
 {
     QList<PlanData> planDataList;
 
-    QSqlQuery query("SELECT task_id, habit_id, plan_name, status "
-                    "FROM daily_plan "
-                    "WHERE plan_date = ?;");
-    query.addBindValue(date);
-
-    if (!query.exec()) {
-        return planDataList;
-    }
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT task_id, habit_id, name_id, status, id, index_id "
+                                                "FROM %1 "
+                                                "WHERE plan_date = ? "
+                                                "ORDER BY index_id, id;",
+                                                {date}, date, date);
 
-    while(query.next()) {
+    for (const QVariantList &row : rows) {
         PlanData planData;
-        planData.name = query.value(2).toString();
-        planData.status = query.value(3).toInt();
-
-        if (!query.value(0).isNull()) {
-            planData.type = "任务";
-        } else if (!query.value(1).isNull()) {
-            planData.type = "习惯";
+        planData.id = row.at(4).toInt();
+        planData.name = planName(row.at(2).toInt());
+        planData.status = Utils::planStatusFromInt(row.at(3).toInt());
+        planData.indexId = row.at(5).toInt();
+
+        if (!row.at(0).isNull()) {
+            planData.type = QStringLiteral("任务");
+            planData.taskId = row.at(0).toInt();
+        } else if (!row.at(1).isNull()) {
+            planData.type = QStringLiteral("习惯");
+            planData.habitId = row.at(1).toInt();
         } else {
             continue;
         }
@@ -171,27 +738,77 @@ QList<PlanData> Database::getPlanByDate(const QDate &date)
     return planDataList;
 }
 
-QMap<QDate, double> Database::getPlanNumberByDate(const QDate &startDate, const QDate &endDate)
+QMap<QDate, QList<PlanData>> Database::getPlanByRange(const QDate &startDate, const QDate &endDate)
 {
-    QMap<QDate, double> resultData;
+    QMap<QDate, QList<PlanData>> planDataMap;
 
-    QSqlQuery query;
-    query.prepare("SELECT plan_date, COUNT(*), SUM(CASE WHEN status = 1 THEN 1 ELSE 0 END) "
-                  "FROM daily_plan "
-                  "WHERE plan_date BETWEEN :start AND :end "
-                  "GROUP BY plan_date");
-    query.bindValue(":start", startDate);
-    query.bindValue(":end", endDate);
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT plan_date, task_id, habit_id, name_id, status "
+                                                "FROM %1 "
+                                                "WHERE plan_date BETWEEN ? AND ? "
+                                                "ORDER BY plan_date, index_id, id;",
+                                                {startDate, endDate}, startDate, endDate);
 
-    if (!query.exec()) {
+    for (const QVariantList &row : rows) {
+        PlanData planData;
+        planData.name = planName(row.at(3).toInt());
+        planData.status = Utils::planStatusFromInt(row.at(4).toInt());
+
+        if (!row.at(1).isNull()) {
+            planData.type = QStringLiteral("任务");
+            planData.taskId = row.at(1).toInt();
+        } else if (!row.at(2).isNull()) {
+            planData.type = QStringLiteral("习惯");
+            planData.habitId = row.at(2).toInt();
+        } else {
+            continue;
+        }
+
+        planDataMap[row.at(0).toDate()].append(planData);
+    }
+
+    return planDataMap;
+}
+
+QMap<QDate, double> Database::getPlanNumberByDate(const QDate &startDate, const QDate &endDate, const PlanFilter &filter)
+{
+    QMap<QDate, double> resultData;
+
+    if (filter) {
+        // Rows are counted here, after the filter has picked them
+        const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                    "SELECT plan_date, IFNULL(task_id, 0), IFNULL(habit_id, 0), status "
+                                                    "FROM %1 "
+                                                    "WHERE plan_date BETWEEN ? AND ?",
+                                                    {startDate, endDate}, startDate, endDate);
+
+        QMap<QDate, QPair<int, int>> counts;
+        for (const QVariantList &row : rows) {
+            if (!filter(row.at(1).toInt(), row.at(2).toInt())) continue;
+            QPair<int, int> &count = counts[row.at(0).toDate()];
+            count.first++;
+            if (row.at(3).toInt() == static_cast<int>(PlanStatus::Completed)) {
+                count.second++;
+            }
+        }
+        for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+            resultData.insert(it.key(), static_cast<double>(it.value().second) / it.value().first);
+        }
         return resultData;
     }
 
-    while (query.next())
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT plan_date, COUNT(*), SUM(CASE WHEN status = 1 THEN 1 ELSE 0 END) "
+                                                "FROM %1 "
+                                                "WHERE plan_date BETWEEN ? AND ? "
+                                                "GROUP BY plan_date",
+                                                {startDate, endDate}, startDate, endDate);
+
+    for (const QVariantList &row : rows)
     {
-        QDate date = query.value(0).toDate();
-        int total = query.value(1).toInt();
-        int completed = query.value(2).toInt();
+        QDate date = row.at(0).toDate();
+        int total = row.at(1).toInt();
+        int completed = row.at(2).toInt();
 
         double ratio = (total > 0) ? static_cast<double>(completed) / total : 0.0;
         resultData.insert(date, ratio);
@@ -200,119 +817,91 @@ QMap<QDate, double> Database::getPlanNumberByDate(const QDate &startDate, const
     return resultData;
 }
 
-ReviewData Database::getReviewByDate(const QString& type, const QDate& startDate, const QDate& endDate)
+ReviewData Database::getReviewByKey(qint64 periodKey)
 {
     ReviewData reviewData;
 
-    QSqlQuery query("SELECT reflection, summary "
-                    "FROM daily_review "
-                    "WHERE type = ? and period_start = ? and period_end = ?;");
-    query.addBindValue(type);
-    query.addBindValue(startDate);
-    query.addBindValue(endDate);
+    QDate startDate = PeriodCalendar::startDate(periodKey);
+    const QList<QVariantList> rows = selectRows(ShardedTable::Review,
+                                                "SELECT reflection, summary "
+                                                "FROM %1 "
+                                                "WHERE period_key = ?;",
+                                                {periodKey}, startDate, startDate);
 
-    if (!query.exec() || !query.next()) {
+    if (rows.isEmpty()) {
         return reviewData;
     }
 
-    reviewData.reflection = query.value(0).toString();
-    reviewData.summary = query.value(1).toString();
+    reviewData.reflection = unpackReviewText(rows.first().at(0));
+    reviewData.summary = unpackReviewText(rows.first().at(1));
 
     return reviewData;
 }
 
-QList<ReviewData> Database::getReviewByType(const QString &type, const QDate &startDate, const QDate &endDate)
+QList<ReviewData> Database::getChildReviews(qint64 periodKey)
 {
     QList<ReviewData> reviewData;
-    QString searchType;
-    QSqlQuery query;
 
-    if(type == "日总结") {
-        return reviewData;
-    }
-    else if (type == "周总结") {
-        searchType = "日总结";
-        query.prepare("SELECT reflection, summary "
-                      "FROM daily_review "
-                      "WHERE type = ? and period_start >= ? and period_end <= ?;");
-        query.addBindValue(searchType);
-        query.addBindValue(startDate);
-        query.addBindValue(endDate);
-    }
-    else if (type == "月总结") {
-        searchType = "周总结";
-        query.prepare("SELECT reflection, summary "
-                      "FROM daily_review "
-                      "WHERE type = ? and period_start >= ? and period_end <= ?;");
-        query.addBindValue(searchType);
-        query.addBindValue(startDate);
-        query.addBindValue(endDate);
-    }
-    else if (type == "年中总结") {
-        searchType = "月总结";
-        query.prepare("SELECT reflection, summary "
-                      "FROM daily_review "
-                      "WHERE type = ? and period_start >= ? and period_end <= ?;");
-        query.addBindValue(searchType);
-        query.addBindValue(startDate);
-        query.addBindValue(endDate);
-    }
-    else if (type == "年终总结") {
-        searchType = "年中总结";
-        query.prepare("SELECT reflection, summary "
-                      "FROM daily_review "
-                      "WHERE (type = ? and period_start >= ? and period_end <= ?) "
-                      "or (type = '月总结' and period_start >= ? and period_end <= ?);");
-        query.addBindValue(searchType);
-        query.addBindValue(startDate);
-        query.addBindValue(endDate);
-        query.addBindValue(QDate(endDate.year(), 7, 1));
-        query.addBindValue(QDate(endDate.year(), 12, 31));
-    }
-
-    if (!query.exec()) {
-        return reviewData;
-    }
-
-    while (query.next()) {
-        ReviewData data;
-        data.reflection = query.value(0).toString();
-        data.summary = query.value(1).toString();
-        reviewData.append(data);
+    const QList<PeriodCalendar::KeyRange> ranges = PeriodCalendar::childRanges(periodKey);
+    for (const PeriodCalendar::KeyRange &range : ranges) {
+        const QList<QVariantList> rows = selectRows(ShardedTable::Review,
+                                                    "SELECT reflection, summary "
+                                                    "FROM %1 "
+                                                    "WHERE period_key BETWEEN ? AND ? "
+                                                    "ORDER BY period_key;",
+                                                    {range.first, range.last},
+                                                    PeriodCalendar::startDate(range.first),
+                                                    PeriodCalendar::startDate(range.last));
+        for (const QVariantList &row : rows) {
+            ReviewData data;
+            data.reflection = unpackReviewText(row.at(0));
+            data.summary = unpackReviewText(row.at(1));
+            reviewData.append(data);
+        }
     }
 
     return reviewData;
 }
 
-void Database::addTask(TaskData data)
+int Database::addTask(TaskData data, int parentId)
 {
-    QSqlQuery query;
+    m_db.transaction();
+    QSqlQuery query(m_db);
     query.prepare("INSERT INTO task (name, due_date) "
                   "VALUES (?, ?);");
     query.addBindValue(data.name);
     query.addBindValue(data.dueDate);
-    if (query.exec()) {
+    if (!query.exec()) {
+        m_db.rollback();
+        return 0;
     }
-    else {
+    int id = query.lastInsertId().toInt();
+
+    if (parentId > 0 && !linkTask(id, parentId)) {
+        m_db.rollback();
+        return 0;
     }
+    m_db.commit();
+    return id;
 }
 
-void Database::addHabit(HabitData data)
+int Database::addHabit(HabitData data)
 {
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("INSERT INTO habits (name, target_frequency) "
                   "VALUES (?, ?);");
     query.addBindValue(data.name);
     query.addBindValue(data.target_frequency);
-    if (query.exec()) {
-    }
-    else {
+    if (!query.exec()) {
+        return 0;
     }
+    return query.lastInsertId().toInt();
 }
 
 void Database::updateTaskName(int id, const QString &name)
 {
-    QSqlQuery query;
+    restoreArchivedTask(id);
+    QSqlQuery query(m_db);
     query.prepare("UPDATE task "
                   "SET name = ? "
                   "WHERE id = ?");
@@ -324,7 +913,8 @@ void Database::updateTaskName(int id, const QString &name)
 
 void Database::updateTaskDueDate(int id, const QDate &date)
 {
-    QSqlQuery query;
+    restoreArchivedTask(id);
+    QSqlQuery query(m_db);
     query.prepare("UPDATE task "
                   "SET due_date = ? "
                   "WHERE id = ?");
@@ -334,23 +924,24 @@ void Database::updateTaskDueDate(int id, const QDate &date)
     }
 }
 
-void Database::updateTaskStatus(int id, int status)
+void Database::updateTaskStatus(int id, TaskStatus status)
 {
-    QSqlQuery query;
+    restoreArchivedTask(id);
+    QSqlQuery query(m_db);
     switch (status) {
-    case 0:
-    case 2:
-    case 4:
+    case TaskStatus::InProgress:
+    case TaskStatus::Unfinished:
+    case TaskStatus::Cancelled:
         query.prepare("UPDATE task "
                       "SET status = ?, completed_date = '' "
                       "WHERE id = ?");
-        query.addBindValue(status);
+        query.addBindValue(static_cast<int>(status));
         break;
     default:
         query.prepare("UPDATE task "
                       "SET status = ?, completed_date = ? "
                       "WHERE id = ?");
-        query.addBindValue(status);
+        query.addBindValue(static_cast<int>(status));
         query.addBindValue(QDate::currentDate());
         break;
     }
@@ -360,17 +951,20 @@ void Database::updateTaskStatus(int id, int status)
         return;
     }
 
-    QSqlQuery planQuery;
-    if (status == 1 || status == 3) {
-        planQuery.prepare("UPDATE daily_plan "
-                          "SET status = 1 "
-                          "WHERE plan_date = ? AND task_id = ?");
+    const QString planTable = shardedTable(ShardedTable::Plan, QDate::currentDate());
+    QSqlQuery planQuery(m_db);
+    if (status == TaskStatus::Completed || status == TaskStatus::LateCompleted) {
+        planQuery.prepare(QString("UPDATE %1 "
+                                  "SET status = ? "
+                                  "WHERE plan_date = ? AND task_id = ?").arg(planTable));
+        planQuery.addBindValue(static_cast<int>(PlanStatus::Completed));
         planQuery.addBindValue(QDate::currentDate());
         planQuery.addBindValue(id);
-    } else if (status == 2 || status == 4) {
-        planQuery.prepare("UPDATE daily_plan "
-                          "SET status = 2 "
-                          "WHERE plan_date = ? AND task_id = ?");
+    } else if (status == TaskStatus::Unfinished || status == TaskStatus::Cancelled) {
+        planQuery.prepare(QString("UPDATE %1 "
+                                  "SET status = ? "
+                                  "WHERE plan_date = ? AND task_id = ?").arg(planTable));
+        planQuery.addBindValue(static_cast<int>(PlanStatus::Unfinished));
         planQuery.addBindValue(QDate::currentDate());
         planQuery.addBindValue(id);
     }
@@ -379,23 +973,411 @@ void Database::updateTaskStatus(int id, int status)
     }
 }
 
-void Database::updateHabitName(int id, const QString &name)
+bool Database::updateTasksStatus(const QList<int> &ids, TaskStatus status)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE habits "
-                  "SET name = ? "
-                  "WHERE id = ?");
-    query.addBindValue(name);
-    query.addBindValue(id);
-    if (!query.exec()) {
+    if (ids.isEmpty()) {
+        return true;
     }
-}
 
-void Database::updateHabitCreatedDate(int id, const QDate &date)
-{
-    QSqlQuery query;
-    query.prepare("UPDATE habits "
-                  "SET created_date = ? "
+    // Resolved before the transaction: a year file cannot be attached inside one
+    const QDate today = QDate::currentDate();
+    const QString planTable = shardedTable(ShardedTable::Plan, today);
+    const QString idList = placeholderList(ids.size());
+    const bool completed = status == TaskStatus::Completed || status == TaskStatus::LateCompleted;
+
+    m_db.transaction();
+    if (!restoreArchivedTasks(ids)) {
+        m_db.rollback();
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare(QString("UPDATE task "
+                          "SET status = ?, completed_date = ? "
+                          "WHERE id IN (%1)").arg(idList));
+    query.addBindValue(static_cast<int>(status));
+    query.addBindValue(completed ? QVariant(today) : QVariant(QString("")));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    bool ok = query.exec();
+
+    // Today's plan rows follow their task, as in updateTaskStatus
+    if (ok && status != TaskStatus::InProgress) {
+        query.prepare(QString("UPDATE %1 "
+                              "SET status = ? "
+                              "WHERE plan_date = ? AND task_id IN (%2)").arg(planTable, idList));
+        query.addBindValue(static_cast<int>(completed ? PlanStatus::Completed : PlanStatus::Unfinished));
+        query.addBindValue(today);
+        for (int id : ids) {
+            query.addBindValue(id);
+        }
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "批量更新任务状态失败:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
+}
+
+bool Database::shiftTasksDueDate(const QList<int> &ids, int days)
+{
+    if (ids.isEmpty() || days == 0) {
+        return true;
+    }
+
+    m_db.transaction();
+    if (!restoreArchivedTasks(ids)) {
+        m_db.rollback();
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare(QString("UPDATE task "
+                          "SET due_date = date(due_date, ?) "
+                          "WHERE due_date > '' AND id IN (%1)").arg(placeholderList(ids.size())));
+    query.addBindValue(QString("%1 days").arg(days));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    if (!query.exec()) {
+        qDebug() << "批量顺延截止日期失败:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
+}
+
+QList<int> Database::markOverdueTasks(const QDate &today)
+{
+    QList<int> taskIds;
+    QSqlQuery query(m_db);
+    // Range on (status, due_date); the lower bound skips tasks without a due date
+    query.prepare("UPDATE task "
+                  "SET status = ? "
+                  "WHERE status = ? AND due_date > '' AND due_date < ? "
+                  "RETURNING id");
+    query.addBindValue(static_cast<int>(TaskStatus::Unfinished));
+    query.addBindValue(static_cast<int>(TaskStatus::InProgress));
+    query.addBindValue(today);
+
+    if (!query.exec()) {
+        qDebug() << "标记逾期任务失败:" << query.lastError().text();
+        return taskIds;
+    }
+    while (query.next()) {
+        taskIds.append(query.value(0).toInt());
+    }
+    return taskIds;
+}
+
+bool Database::setTaskParent(const QList<int> &ids, int parentId)
+{
+    if (ids.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery query(m_db);
+    if (parentId > 0) {
+        // A task cannot move below itself or its own subtasks
+        if (ids.contains(parentId)) {
+            return false;
+        }
+        query.prepare(QString("SELECT 1 FROM task_closure "
+                              "WHERE descendant = ? AND ancestor IN (%1) LIMIT 1").arg(placeholderList(ids.size())));
+        query.addBindValue(parentId);
+        for (int id : ids) {
+            query.addBindValue(id);
+        }
+        if (!query.exec() || query.next()) {
+            return false;
+        }
+    }
+
+    m_db.transaction();
+    for (int id : ids) {
+        if (!linkTask(id, parentId)) {
+            m_db.rollback();
+            return false;
+        }
+    }
+    return m_db.commit();
+}
+
+bool Database::linkTask(int id, int parentId)
+{
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR IGNORE INTO task_closure (ancestor, descendant, depth) VALUES (?, ?, 0)");
+    query.addBindValue(id);
+    query.addBindValue(id);
+    bool ok = query.exec();
+
+    // Paths from the old ancestors into the subtree; paths inside it stay
+    if (ok) {
+        query.prepare("DELETE FROM task_closure "
+                      "WHERE descendant IN (SELECT descendant FROM task_closure WHERE ancestor = ?) "
+                      "AND ancestor IN (SELECT ancestor FROM task_closure WHERE descendant = ? AND depth > 0)");
+        query.addBindValue(id);
+        query.addBindValue(id);
+        ok = query.exec();
+    }
+
+    if (ok && parentId > 0) {
+        query.prepare("INSERT OR IGNORE INTO task_closure (ancestor, descendant, depth) VALUES (?, ?, 0)");
+        query.addBindValue(parentId);
+        query.addBindValue(parentId);
+        ok = query.exec();
+    }
+
+    // Every ancestor of the parent (itself included) times every node of the subtree
+    if (ok && parentId > 0) {
+        query.prepare("INSERT INTO task_closure (ancestor, descendant, depth) "
+                      "SELECT a.ancestor, d.descendant, a.depth + d.depth + 1 "
+                      "FROM task_closure a, task_closure d "
+                      "WHERE a.descendant = ? AND d.ancestor = ?");
+        query.addBindValue(parentId);
+        query.addBindValue(id);
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "移动子任务失败:" << query.lastError().text();
+    }
+    return ok;
+}
+
+QList<int> Database::getTaskAncestors(int id)
+{
+    QList<int> ancestors;
+    QSqlQuery query(m_db);
+    query.prepare("SELECT ancestor FROM task_closure "
+                  "WHERE descendant = ? AND depth > 0 "
+                  "ORDER BY depth DESC");
+    query.addBindValue(id);
+    if (!query.exec()) {
+        qDebug() << "查询上级任务失败:" << query.lastError().text();
+        return ancestors;
+    }
+    while (query.next()) {
+        ancestors.append(query.value(0).toInt());
+    }
+    return ancestors;
+}
+
+QList<int> Database::getOpenSubtasks(const QList<int> &ids)
+{
+    QList<int> subtasks;
+    if (ids.isEmpty()) {
+        return subtasks;
+    }
+
+    // Open tasks are never archived, so main.task holds all of them
+    QSqlQuery query(m_db);
+    query.prepare(QString("SELECT DISTINCT c.descendant "
+                          "FROM task_closure c JOIN main.task t ON t.id = c.descendant "
+                          "WHERE c.ancestor IN (%1) AND c.depth > 0 AND t.status IN (?, ?)").arg(placeholderList(ids.size())));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    query.addBindValue(static_cast<int>(TaskStatus::InProgress));
+    query.addBindValue(static_cast<int>(TaskStatus::Unfinished));
+    if (!query.exec()) {
+        qDebug() << "查询子任务失败:" << query.lastError().text();
+        return subtasks;
+    }
+    while (query.next()) {
+        subtasks.append(query.value(0).toInt());
+    }
+    return subtasks;
+}
+
+int Database::addTag(const QString &name)
+{
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR IGNORE INTO tag (name) VALUES (?)");
+    query.addBindValue(name);
+    query.exec();
+
+    query.prepare("SELECT id FROM tag WHERE name = ?");
+    query.addBindValue(name);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "添加标签失败:" << query.lastError().text();
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+
+QHash<int, QString> Database::getTags()
+{
+    QHash<int, QString> tags;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name FROM tag")) {
+        qDebug() << "查询标签失败:" << query.lastError().text();
+        return tags;
+    }
+    while (query.next()) {
+        tags.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    return tags;
+}
+
+QList<QPair<int, int>> Database::getTagLinks(TagKind kind)
+{
+    QList<QPair<int, int>> links;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT tag_id, %1 FROM %2").arg(tagRefColumn(kind), tagLinkTable(kind)))) {
+        qDebug() << "查询标签失败:" << query.lastError().text();
+        return links;
+    }
+    while (query.next()) {
+        links.append({query.value(0).toInt(), query.value(1).toInt()});
+    }
+    return links;
+}
+
+QList<int> Database::getTaggableIds(TagKind kind)
+{
+    QList<int> ids;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    const QString sql = kind == TagKind::Task ? QString("SELECT id FROM %1").arg(taskSource(true))
+                                              : QStringLiteral("SELECT id FROM habits");
+    if (!query.exec(sql)) {
+        qDebug() << "查询标签对象失败:" << query.lastError().text();
+        return ids;
+    }
+    while (query.next()) {
+        ids.append(query.value(0).toInt());
+    }
+    return ids;
+}
+
+bool Database::setTagged(TagKind kind, int tagId, const QList<int> &ids, bool tagged)
+{
+    if (ids.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery query(m_db);
+    if (tagged) {
+        QStringList rows;
+        rows.reserve(ids.size());
+        for (int i = 0; i < ids.size(); ++i) {
+            rows.append("(?, ?)");
+        }
+        query.prepare(QString("INSERT OR IGNORE INTO %1 (tag_id, %2) VALUES %3")
+                          .arg(tagLinkTable(kind), tagRefColumn(kind), rows.join(", ")));
+        for (int id : ids) {
+            query.addBindValue(tagId);
+            query.addBindValue(id);
+        }
+    } else {
+        query.prepare(QString("DELETE FROM %1 WHERE tag_id = ? AND %2 IN (%3)")
+                          .arg(tagLinkTable(kind), tagRefColumn(kind), placeholderList(ids.size())));
+        query.addBindValue(tagId);
+        for (int id : ids) {
+            query.addBindValue(id);
+        }
+    }
+
+    if (!query.exec()) {
+        qDebug() << "更新标签失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool Database::setTaskTagFilter(const QList<int> &ids)
+{
+    QSqlQuery query(m_db);
+    m_db.transaction();
+    bool ok = query.exec("CREATE TEMP TABLE IF NOT EXISTS task_tag_filter (id INTEGER PRIMARY KEY)");
+    ok = ok && query.exec("DELETE FROM temp.task_tag_filter");
+
+    // Ids are plain integers from the tag bitmaps, so they are written as literals
+    // in large chunks instead of one bound statement per row
+    const int chunkSize = 1000;
+    for (int first = 0; ok && first < ids.size(); first += chunkSize) {
+        QStringList values;
+        values.reserve(chunkSize);
+        for (int i = first; i < qMin(first + chunkSize, int(ids.size())); ++i) {
+            values.append(QString("(%1)").arg(ids.at(i)));
+        }
+        ok = query.exec("INSERT INTO temp.task_tag_filter (id) VALUES " + values.join(", "));
+    }
+
+    if (!ok) {
+        qDebug() << "设置标签筛选失败:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
+}
+
+QHash<int, TaskProgress> Database::getTaskProgress(const QList<int> &ids)
+{
+    QHash<int, TaskProgress> progress;
+    if (ids.isEmpty()) {
+        return progress;
+    }
+
+    // Archived subtasks still count; each one is a primary key lookup in either file
+    QString status = QStringLiteral("t.status");
+    QString archiveJoin;
+    if (m_archiveAttached) {
+        status = QStringLiteral("COALESCE(t.status, a.status)");
+        archiveJoin = QStringLiteral("LEFT JOIN archive.task a ON a.id = c.descendant ");
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT c.ancestor, SUM(c.depth = 1), SUM(%1 <> ?), SUM(%1 IN (?, ?)) "
+                          "FROM task_closure c "
+                          "LEFT JOIN main.task t ON t.id = c.descendant "
+                          "%2"
+                          "WHERE c.ancestor IN (%3) AND c.depth > 0 "
+                          "GROUP BY c.ancestor").arg(status, archiveJoin, placeholderList(ids.size())));
+    query.addBindValue(static_cast<int>(TaskStatus::Cancelled));
+    query.addBindValue(static_cast<int>(TaskStatus::Completed));
+    query.addBindValue(static_cast<int>(TaskStatus::LateCompleted));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    if (!query.exec()) {
+        qDebug() << "查询任务进度失败:" << query.lastError().text();
+        return progress;
+    }
+    while (query.next()) {
+        TaskProgress &taskProgress = progress[query.value(0).toInt()];
+        taskProgress.children = query.value(1).toInt();
+        taskProgress.total = query.value(2).toInt();
+        taskProgress.completed = query.value(3).toInt();
+    }
+    return progress;
+}
+
+void Database::updateHabitName(int id, const QString &name)
+{
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE habits "
+                  "SET name = ? "
+                  "WHERE id = ?");
+    query.addBindValue(name);
+    query.addBindValue(id);
+    if (!query.exec()) {
+    }
+}
+
+void Database::updateHabitCreatedDate(int id, const QDate &date)
+{
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE habits "
+                  "SET created_date = ? "
                   "WHERE id = ?");
     query.addBindValue(date);
     query.addBindValue(id);
@@ -405,7 +1387,7 @@ void Database::updateHabitCreatedDate(int id, const QDate &date)
 
 void Database::updateHabitFrequency(int id, QString frequency)
 {
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("UPDATE habits "
                   "SET target_frequency = ? "
                   "WHERE id = ?");
@@ -415,25 +1397,48 @@ void Database::updateHabitFrequency(int id, QString frequency)
     }
 }
 
-void Database::updateHabitStatus(int id, int status)
+void Database::updateHabitStatus(int id, HabitStatus status)
 {
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("UPDATE habits "
                   "SET status = ? "
                   "WHERE id = ?");
-    query.addBindValue(status);
+    query.addBindValue(static_cast<int>(status));
     query.addBindValue(id);
     if (!query.exec()) {
     }
 }
 
+bool Database::updateHabitsStatus(const QList<int> &ids, HabitStatus status)
+{
+    if (ids.isEmpty()) {
+        return true;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare(QString("UPDATE habits "
+                          "SET status = ? "
+                          "WHERE id IN (%1)").arg(placeholderList(ids.size())));
+    query.addBindValue(static_cast<int>(status));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    // A single statement is its own transaction
+    if (!query.exec()) {
+        qDebug() << "批量更新习惯状态失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 int Database::getHabitIdByName(QString name)
 {
     int habitId = 0;
 
-    QSqlQuery query("SELECT id "
-                    "FROM habits "
-                    "WHERE name = ?;");
+    QSqlQuery query(m_db);
+    query.prepare("SELECT id "
+                  "FROM habits "
+                  "WHERE name = ?;");
     query.addBindValue(name);
 
     if (!query.exec() || !query.next()) {
@@ -449,9 +1454,10 @@ int Database::getTaskIdByName(QString name)
 {
     int taskId = 0;
 
-    QSqlQuery query("SELECT id "
-                    "FROM task "
-                    "WHERE name = ?;");
+    QSqlQuery query(m_db);
+    query.prepare("SELECT id "
+                  "FROM task "
+                  "WHERE name = ?;");
     query.addBindValue(name);
 
     if (!query.exec() || !query.next())
@@ -464,240 +1470,246 @@ int Database::getTaskIdByName(QString name)
     return taskId;
 }
 
-void Database::updateHabitPlan(int index, QString name, int status, int habitId, QDate date)
+bool Database::saveEdits(const EditBatch &batch, QList<int> *insertedIds)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE daily_plan "
-                  "SET habit_id = ?, plan_name = ?, status = ? "
-                  "WHERE plan_date = ? AND index_id = ?");
-    query.addBindValue(habitId);
-    query.addBindValue(name);
-    query.addBindValue(status);
-    query.addBindValue(date);
-    query.addBindValue(index);
-
-    if (!query.exec())
-    {
-        return;
+    if (batch.removedIds.isEmpty() && batch.changes.isEmpty() && !batch.hasReview) {
+        return true;
     }
 
-    if (query.numRowsAffected() == 0)
-    {
-        query.prepare("INSERT INTO daily_plan (habit_id, plan_date, plan_name, index_id, status) "
-                      "VALUES (?, ?, ?, ?, ?)");
-        query.addBindValue(habitId);
-        query.addBindValue(date);
-        query.addBindValue(name);
-        query.addBindValue(index);
-        query.addBindValue(status);
+    // Resolved before the transaction: a year file cannot be attached inside one
+    const QString planTable = shardedTable(ShardedTable::Plan, batch.date);
+    if (batch.hasReview) {
+        shardedTable(ShardedTable::Review, PeriodCalendar::startDate(PeriodCalendar::key(batch.reviewType, batch.date)));
+    }
+    for (const PlanChange &change : batch.changes) {
+        planNameId(change.name);
+    }
 
-        if (!query.exec())
-        {
-        }
+    m_db.transaction();
+    bool ok = writePlanChanges(planTable, batch, insertedIds);
+    if (ok && batch.hasReview) {
+        ok = updateReview(batch.reflection, batch.summary, batch.date, batch.reviewType);
     }
+    if (!ok) {
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
 }
 
-void Database::updateTaskPlan(int index, QString name, int status, int taskId, QDate date)
+bool Database::writePlanChanges(const QString &table, const EditBatch &batch, QList<int> *insertedIds)
 {
-    QSqlQuery query;
-    query.prepare("UPDATE daily_plan "
-                  "SET task_id = ?, plan_name = ?, status = ? "
-                  "WHERE plan_date = ? AND index_id = ?");
-    query.addBindValue(taskId);
-    query.addBindValue(name);
-    query.addBindValue(status);
-    query.addBindValue(date);
-    query.addBindValue(index);
-
-    if (!query.exec())
-    {
-        return;
+    QSqlQuery query(m_db);
+    query.prepare(QString("DELETE FROM %1 WHERE id = ?").arg(table));
+    for (int id : batch.removedIds) {
+        query.addBindValue(id);
+        if (!query.exec()) {
+            qDebug() << "删除计划失败:" << query.lastError().text();
+            return false;
+        }
     }
 
-    if (query.numRowsAffected() == 0)
-    {
-        query.prepare("INSERT INTO daily_plan (task_id, plan_date, plan_name, index_id, status) "
-                      "VALUES (?, ?, ?, ?, ?)");
-        query.addBindValue(taskId);
-        query.addBindValue(date);
-        query.addBindValue(name);
-        query.addBindValue(index);
-        query.addBindValue(status);
-
-        if (!query.exec())
-        {
+    QSqlQuery update(m_db);
+    update.prepare(QString("UPDATE %1 "
+                           "SET task_id = ?, habit_id = ?, name_id = ?, index_id = ?, status = ? "
+                           "WHERE id = ?").arg(table));
+    QSqlQuery insert(m_db);
+    insert.prepare(QString("INSERT INTO %1 (task_id, habit_id, plan_date, name_id, index_id, status) "
+                           "VALUES (?, ?, ?, ?, ?, ?)").arg(table));
+    for (const PlanChange &change : batch.changes) {
+        // Exactly one of task_id and habit_id is set
+        const QVariant taskId = change.habitId > 0 ? QVariant() : QVariant(change.taskId);
+        const QVariant habitId = change.habitId > 0 ? QVariant(change.habitId) : QVariant();
+        QSqlQuery &write = change.id > 0 ? update : insert;
+        write.addBindValue(taskId);
+        write.addBindValue(habitId);
+        if (change.id <= 0) {
+            write.addBindValue(batch.date);
+        }
+        write.addBindValue(planNameId(change.name));
+        write.addBindValue(change.indexId);
+        write.addBindValue(static_cast<int>(change.status));
+        if (change.id > 0) {
+            write.addBindValue(change.id);
+        }
+        if (!write.exec()) {
+            qDebug() << "保存计划失败:" << write.lastError().text();
+            return false;
+        }
+        if (change.id <= 0 && insertedIds) {
+            insertedIds->append(write.lastInsertId().toInt());
         }
     }
+    return true;
 }
 
-void Database::updateReview(const QString& reflection, const QString& summary, const QDate& date, const QString& type)
+bool Database::updateReview(const QString& reflection, const QString& summary, const QDate& date, const QString& type)
 {
-    QDate startPeriodDate = date;
-    QDate endPeriodDate = date;
-
-    if (type == "周总结")
-    {
-        startPeriodDate = date.addDays(-date.dayOfWeek() + 1);
-        endPeriodDate = startPeriodDate.addDays(6);
-    }
-    else if (type == "月总结")
-    {
-        startPeriodDate = date.addDays(-date.day() + 1);
-        endPeriodDate = startPeriodDate.addMonths(1).addDays(-1);
-    }
-    else if (type == "年中总结")
-    {
-        startPeriodDate = QDate(date.year(), 1, 1);
-        endPeriodDate = QDate(date.year(), 6, 30);
-    }
-    else if (type == "年终总结")
-    {
-        startPeriodDate = QDate(date.year(), 1, 1);
-        endPeriodDate = QDate(date.year(), 12, 31);
-    }
-    QSqlQuery query;
-    query.prepare("UPDATE daily_review "
-                  "SET reflection = ?, summary = ?, review_date = ? "
-                  "WHERE type = ? and period_start = ? and period_end = ?");
-    query.addBindValue(reflection);
-    query.addBindValue(summary);
+    qint64 periodKey = PeriodCalendar::key(type, date);
+    QDate startPeriodDate = PeriodCalendar::startDate(periodKey);
+    QDate endPeriodDate = PeriodCalendar::endDate(periodKey);
+
+    const QString table = shardedTable(ShardedTable::Review, startPeriodDate);
+    QSqlQuery query(m_db);
+    query.prepare(QString("UPDATE %1 "
+                          "SET reflection = ?, summary = ?, review_date = ? "
+                          "WHERE period_key = ?").arg(table));
+    const QVariant packedReflection = packReviewText(reflection);
+    const QVariant packedSummary = packReviewText(summary);
+    query.addBindValue(packedReflection);
+    query.addBindValue(packedSummary);
     query.addBindValue(date);
-    query.addBindValue(type);
-    query.addBindValue(startPeriodDate);
-    query.addBindValue(endPeriodDate);
+    query.addBindValue(periodKey);
     if (!query.exec())
     {
         qDebug() << "更新总结失败:" << query.lastError().text();
-        return;
+        return false;
     }
 
     if (query.numRowsAffected() == 0)
     {
-        query.prepare("INSERT INTO daily_review (review_date, reflection, summary, type, period_start, period_end) "
-                      "VALUES (?, ?, ?, ?, ?, ?)");
+        query.prepare(QString("INSERT INTO %1 (review_date, reflection, summary, type, period_start, period_end, period_key) "
+                              "VALUES (?, ?, ?, ?, ?, ?, ?)").arg(table));
         query.addBindValue(date);
-        query.addBindValue(reflection);
-        query.addBindValue(summary);
+        query.addBindValue(packedReflection);
+        query.addBindValue(packedSummary);
         query.addBindValue(type);
         query.addBindValue(startPeriodDate);
         query.addBindValue(endPeriodDate);
+        query.addBindValue(periodKey);
 
         if (!query.exec())
         {
             qDebug() << "插入总结失败:" << query.lastError().text();
+            return false;
         }
     }
+
+    indexReview(periodKey, reflection, summary);
+    invalidateReviewDrafts(periodKey);
+    return true;
+}
+
+bool Database::completeHabit(int habitId)
+{
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE habits "
+                  "SET status = 1 "
+                  "WHERE id = ? AND status = 0");
+    query.addBindValue(habitId);
+    if (!query.exec()) {
+        qDebug() << "更新习惯状态失败:" << query.lastError().text();
+        return false;
+    }
+    return query.numRowsAffected() > 0;
 }
 
-void Database::updateHabitStatusByTimes(const HabitData &habit)
+QHash<int, QList<QDate>> Database::getHabitCompletions(const QList<int> &habitIds)
 {
-    QSqlQuery habitQuery;
-    bool shouldComplete = false;
-    int maxTimes;
-    maxTimes = getHabitMaxTimes(habit);
-    if (maxTimes >= 30) {
-        shouldComplete = true;
+    QHash<int, QList<QDate>> completions;
+
+    QString habitFilter;
+    QVariantList binds;
+    if (!habitIds.isEmpty()) {
+        habitFilter = QString("AND habit_id IN (%1) ").arg(placeholderList(habitIds.size()));
+        for (int habitId : habitIds) {
+            binds.append(habitId);
+        }
     }
-    if (shouldComplete)
-    {
-        habitQuery.prepare("UPDATE habits "
-                           "SET status = 1 "
-                           "WHERE name = ? and status = 0");
-        habitQuery.addBindValue(habit.name);
-        habitQuery.exec();
+
+    // Shards come back in year order, so each habit's dates stay sorted
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT habit_id, plan_date "
+                                                "FROM %1 "
+                                                "WHERE habit_id IS NOT NULL AND status = 1 "
+                                                + habitFilter +
+                                                "ORDER BY habit_id, plan_date",
+                                                binds, QDate(), QDate());
+
+    for (const QVariantList &row : rows) {
+        completions[row.at(0).toInt()].append(row.at(1).toDate());
     }
+
+    return completions;
 }
 
 int Database::getHabitTimes(const HabitData &habit)
 {
-    QSqlQuery query;
     int allStreak = 0;
-    query.prepare("SELECT COUNT(*) "
-                  "FROM daily_plan "
-                  "WHERE plan_name = ? and status = 1 ");
-    query.addBindValue(habit.name);
-    if (!query.exec() || !query.next()) {
-        return allStreak;
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT COUNT(*) "
+                                                "FROM %1 "
+                                                "WHERE habit_id = ? and status = 1 ",
+                                                {habit.id}, QDate(), QDate());
+
+    // One count per year file
+    for (const QVariantList &row : rows) {
+        allStreak += row.at(0).toInt();
     }
-
-    allStreak = query.value(0).toInt();
     return allStreak;
 }
 
 int Database::getHabitMaxTimes(const HabitData &habit)
 {
-    QSqlQuery planQuery;
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT plan_date "
+                                                "FROM %1 "
+                                                "WHERE habit_id = ? AND status = 1 "
+                                                "ORDER BY plan_date ASC",
+                                                {habit.id}, QDate(), QDate());
+    QList<QDate> dates;
+    dates.reserve(rows.size());
+    for (const QVariantList &row : rows) {
+        dates.append(row.at(0).toDate());
+    }
+
     int maxStreak = 0;
     if (habit.target_frequency == "每日一次")
     {
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? and status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                if (lastDate.isValid() && lastDate.addDays(1) == date) {
-                    currentStreak++;
-                } else {
-                    currentStreak = 1;
-                }
-                if (currentStreak > maxStreak) {
-                    maxStreak = currentStreak;
-                }
-                lastDate = date;
+        QDate lastDate;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            if (lastDate.isValid() && lastDate.addDays(1) == date) {
+                currentStreak++;
+            } else {
+                currentStreak = 1;
             }
+            if (currentStreak > maxStreak) {
+                maxStreak = currentStreak;
+            }
+            lastDate = date;
         }
     }
     else if (habit.target_frequency.startsWith("每二日一次"))
     {
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? AND status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                if (lastDate.isValid() && lastDate.addDays(2) == date) {
-                    currentStreak++;
-                } else {
-                    currentStreak = 1;
-                }
-                if (currentStreak > maxStreak) {
-                    maxStreak = currentStreak;
-                }
-                lastDate = date;
+        QDate lastDate;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            if (lastDate.isValid() && lastDate.addDays(2) == date) {
+                currentStreak++;
+            } else {
+                currentStreak = 1;
+            }
+            if (currentStreak > maxStreak) {
+                maxStreak = currentStreak;
             }
+            lastDate = date;
         }
     }
     else if (habit.target_frequency.startsWith("每三日一次"))
     {
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? AND status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                if (lastDate.isValid() && lastDate.addDays(3) == date) {
-                    currentStreak++;
-                } else {
-                    currentStreak = 1;
-                }
-                if (currentStreak > maxStreak) {
-                    maxStreak = currentStreak;
-                }
-                lastDate = date;
+        QDate lastDate;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            if (lastDate.isValid() && lastDate.addDays(3) == date) {
+                currentStreak++;
+            } else {
+                currentStreak = 1;
             }
+            if (currentStreak > maxStreak) {
+                maxStreak = currentStreak;
+            }
+            lastDate = date;
         }
 
     }
@@ -713,19 +1725,37 @@ int Database::getHabitMaxTimes(const HabitData &habit)
         else if (weekDayStr == "周六") targetDayOfWeek = 6;
         else if (weekDayStr == "周日") targetDayOfWeek = 7;
 
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? AND status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                if (date.dayOfWeek() != targetDayOfWeek) continue;
-                if (lastDate.isValid() && lastDate.addDays(7) == date) {
-                    currentStreak++;
+        QDate lastDate;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            if (date.dayOfWeek() != targetDayOfWeek) continue;
+            if (lastDate.isValid() && lastDate.addDays(7) == date) {
+                currentStreak++;
+            } else {
+                currentStreak = 1;
+            }
+            if (currentStreak > maxStreak) {
+                maxStreak = currentStreak;
+            }
+            lastDate = date;
+        }
+    }
+    else if (habit.target_frequency.startsWith("每周工作日"))
+    {
+        QDate lastDate;
+        int lastDayOfWeek = 0;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            int dayOfWeek = date.dayOfWeek();
+            if (dayOfWeek >= 1 && dayOfWeek <= 5) {
+                if (lastDate.isValid()) {
+                    int daysDiff = lastDate.daysTo(date);
+                    if ((lastDate.dayOfWeek() == 5 && dayOfWeek == 1 && daysDiff == 3) ||
+                        (lastDate.dayOfWeek() != 5 && daysDiff == 1)) {
+                        currentStreak++;
+                    } else {
+                        currentStreak = 1;
+                    }
                 } else {
                     currentStreak = 1;
                 }
@@ -736,68 +1766,1073 @@ int Database::getHabitMaxTimes(const HabitData &habit)
             }
         }
     }
-    else if (habit.target_frequency.startsWith("每周工作日"))
+    else if (habit.target_frequency.startsWith("每周休息日"))
     {
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? AND status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int lastDayOfWeek = 0;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                int dayOfWeek = date.dayOfWeek();
-                if (dayOfWeek >= 1 && dayOfWeek <= 5) {
-                    if (lastDate.isValid()) {
-                        int daysDiff = lastDate.daysTo(date);
-                        if ((lastDate.dayOfWeek() == 5 && dayOfWeek == 1 && daysDiff == 3) ||
-                            (lastDate.dayOfWeek() != 5 && daysDiff == 1)) {
-                            currentStreak++;
-                        } else {
-                            currentStreak = 1;
-                        }
-                    } else {
-                        currentStreak = 1;
-                    }
-                    if (currentStreak > maxStreak) {
-                        maxStreak = currentStreak;
-                    }
-                    lastDate = date;
+        QDate lastDate;
+        int currentStreak = 0;
+        for (const QDate &date : std::as_const(dates)) {
+            int dayOfWeek = date.dayOfWeek();
+            if (lastDate.isValid()) {
+                if ((dayOfWeek == 7 && lastDate.addDays(1) == date) ||
+                    (dayOfWeek == 6 && lastDate.addDays(6) == date)) {
+                    currentStreak++;
+                } else {
+                    currentStreak = 1;
                 }
+                if (currentStreak > maxStreak) {
+                    maxStreak = currentStreak;
+                }
+                lastDate = date;
             }
         }
     }
-    else if (habit.target_frequency.startsWith("每周休息日"))
-    {
-        planQuery.prepare("SELECT plan_date "
-                          "FROM daily_plan "
-                          "WHERE plan_name = ? AND status = 1 "
-                          "ORDER BY plan_date ASC");
-        planQuery.addBindValue(habit.name);
-        if (planQuery.exec()) {
-            QDate lastDate;
-            int currentStreak = 0;
-            while (planQuery.next()) {
-                QDate date = planQuery.value(0).toDate();
-                int dayOfWeek = date.dayOfWeek();
-                if (lastDate.isValid()) {
-                    if ((dayOfWeek == 7 && lastDate.addDays(1) == date) ||
-                        (dayOfWeek == 6 && lastDate.addDays(6) == date)) {
-                        currentStreak++;
-                    } else {
-                        currentStreak = 1;
-                    }
-                    if (currentStreak > maxStreak) {
-                        maxStreak = currentStreak;
-                    }
-                    lastDate = date;
-                }
+
+    return maxStreak;
+}
+
+int Database::materializeHabitPlans(const QDate &startDate, const QDate &endDate, const QList<int> &habitIds)
+{
+    if (!startDate.isValid() || startDate > endDate) {
+        return 0;
+    }
+
+    if (m_yearShards && startDate.year() != endDate.year()) {
+        int inserted = 0;
+        for (int year = startDate.year(); year <= endDate.year(); ++year) {
+            int rows = materializeHabitPlans(qMax(startDate, QDate(year, 1, 1)), qMin(endDate, QDate(year, 12, 31)), habitIds);
+            if (rows < 0) {
+                return -1;
             }
+            inserted += rows;
         }
+        return inserted;
     }
+    const QString table = shardedTable(ShardedTable::Plan, startDate);
 
-    return maxStreak;
+    QString habitFilter;
+    if (!habitIds.isEmpty()) {
+        QStringList placeholders;
+        for (int i = 0; i < habitIds.size(); ++i) {
+            placeholders << "?";
+        }
+        habitFilter = QString("AND h.id IN (%1) ").arg(placeholders.join(", "));
+    }
+
+    QSqlQuery query(m_db);
+    if (!query.exec("INSERT OR IGNORE INTO name_dict (name) SELECT name FROM habits WHERE status = 0")) {
+        qDebug() << "生成习惯计划失败:" << query.lastError().text();
+        return -1;
+    }
+
+    // Frequency rules mirror Utils::isHabitDue; strftime('%w') is 0 for Sunday
+    query.prepare(QString("WITH RECURSIVE days(d) AS ("
+                  "SELECT date(?) "
+                  "UNION ALL SELECT date(d, '+1 day') FROM days WHERE d < date(?)) "
+                  "INSERT INTO %1 (habit_id, plan_date, name_id, index_id, status) "
+                  "SELECT h.id, days.d, (SELECT n.id FROM name_dict n WHERE n.name = h.name), "
+                  "COALESCE((SELECT MAX(p.index_id) FROM %1 p WHERE p.plan_date = days.d), 0) "
+                  "+ ROW_NUMBER() OVER (PARTITION BY days.d ORDER BY h.id) * %2, 0 "
+                  "FROM days JOIN habits h ON h.status = 0 AND date(h.created_date) <= days.d "
+                  "WHERE (CASE h.target_frequency "
+                  "WHEN '每日一次' THEN 1 "
+                  "WHEN '每二日一次' THEN CAST(julianday(days.d) - julianday(date(h.created_date)) AS INTEGER) % 2 = 0 "
+                  "WHEN '每三日一次' THEN CAST(julianday(days.d) - julianday(date(h.created_date)) AS INTEGER) % 3 = 0 "
+                  "WHEN '每周周一' THEN strftime('%w', days.d) = '1' "
+                  "WHEN '每周周二' THEN strftime('%w', days.d) = '2' "
+                  "WHEN '每周周三' THEN strftime('%w', days.d) = '3' "
+                  "WHEN '每周周四' THEN strftime('%w', days.d) = '4' "
+                  "WHEN '每周周五' THEN strftime('%w', days.d) = '5' "
+                  "WHEN '每周周六' THEN strftime('%w', days.d) = '6' "
+                  "WHEN '每周周日' THEN strftime('%w', days.d) = '0' "
+                  "WHEN '每周工作日' THEN strftime('%w', days.d) BETWEEN '1' AND '5' "
+                  "WHEN '每周休息日' THEN strftime('%w', days.d) IN ('0', '6') "
+                  "ELSE 0 END) "
+                  + habitFilter +
+                  "AND NOT EXISTS (SELECT 1 FROM %1 p WHERE p.habit_id = h.id AND p.plan_date = days.d)").arg(table).arg(PlanRankStep));
+    query.addBindValue(startDate);
+    query.addBindValue(endDate);
+    for (int habitId : habitIds) {
+        query.addBindValue(habitId);
+    }
+
+    if (!query.exec()) {
+        qDebug() << "生成习惯计划失败:" << query.lastError().text();
+        return -1;
+    }
+
+    return query.numRowsAffected();
+}
+
+int Database::materializeThrough(const QDate &today, const QDate &endDate)
+{
+    // Days up to the watermark were materialized before; a habit row missing there
+    // was deleted on purpose. Habits added or rescheduled go through materializeHabitPlans.
+    QDate startDate = today;
+    QSqlQuery query(m_db);
+    if (query.exec("SELECT value FROM storage_meta WHERE key = 'materialized_through'") && query.next()) {
+        QDate lastDate = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+        if (lastDate.isValid()) {
+            startDate = qMax(startDate, lastDate.addDays(1));
+        }
+    }
+    if (startDate > endDate) {
+        return 0;
+    }
+
+    int inserted = materializeHabitPlans(startDate, endDate);
+    if (inserted < 0) {
+        return inserted;
+    }
+
+    query.prepare("INSERT OR REPLACE INTO storage_meta (key, value) VALUES ('materialized_through', ?)");
+    query.addBindValue(endDate.toString(Qt::ISODate));
+    if (!query.exec()) {
+        qDebug() << "记录习惯计划生成日期失败:" << query.lastError().text();
+    }
+    return inserted;
+}
+
+int Database::rollForwardPlans(const QDate &startDate, const QDate &endDate, const QDate &targetDate)
+{
+    if (!startDate.isValid() || startDate > endDate || !targetDate.isValid()) {
+        return 0;
+    }
+
+    if (m_yearShards && startDate.year() != endDate.year()) {
+        // Earlier years first, so their rows rank ahead on the target day
+        int inserted = 0;
+        for (int year = startDate.year(); year <= endDate.year(); ++year) {
+            int rows = rollForwardPlans(qMax(startDate, QDate(year, 1, 1)), qMin(endDate, QDate(year, 12, 31)), targetDate);
+            if (rows < 0) {
+                return -1;
+            }
+            inserted += rows;
+        }
+        return inserted;
+    }
+
+    QString source;
+    if (m_yearShards) {
+        if (!attachShard(startDate.year(), false)) {
+            return 0;
+        }
+        source = shardSchema(startDate.year()) + QStringLiteral(".daily_plan");
+    } else {
+        source = planSource(startDate);
+    }
+    const QString target = shardedTable(ShardedTable::Plan, targetDate);
+
+    // The latest row of each task decides its name and its place in the order
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT INTO %1 (task_id, plan_date, name_id, index_id, status) "
+                          "SELECT task_id, ?, name_id, "
+                          "COALESCE((SELECT MAX(q.index_id) FROM %1 q WHERE q.plan_date = ?), 0) "
+                          "+ ROW_NUMBER() OVER (ORDER BY plan_date, index_id, id) * %3, ? "
+                          "FROM (SELECT p.id, p.task_id, p.name_id, p.plan_date, p.index_id, "
+                          "ROW_NUMBER() OVER (PARTITION BY p.task_id "
+                          "ORDER BY p.plan_date DESC, p.index_id DESC, p.id DESC) AS pick "
+                          "FROM %2 p JOIN main.task t ON t.id = p.task_id "
+                          "WHERE p.plan_date BETWEEN ? AND ? AND p.status <> ? AND t.status IN (?, ?)) latest "
+                          "WHERE pick = 1 "
+                          "AND NOT EXISTS (SELECT 1 FROM %1 q WHERE q.plan_date = ? AND q.task_id = latest.task_id)")
+                      .arg(target, source).arg(PlanRankStep));
+    query.addBindValue(targetDate);
+    query.addBindValue(targetDate);
+    query.addBindValue(static_cast<int>(PlanStatus::InProgress));
+    query.addBindValue(startDate);
+    query.addBindValue(endDate);
+    query.addBindValue(static_cast<int>(PlanStatus::Completed));
+    query.addBindValue(static_cast<int>(TaskStatus::InProgress));
+    query.addBindValue(static_cast<int>(TaskStatus::Unfinished));
+    query.addBindValue(targetDate);
+
+    if (!query.exec()) {
+        qDebug() << "顺延计划失败:" << query.lastError().text();
+        return -1;
+    }
+    return query.numRowsAffected();
+}
+
+int Database::rollForwardToToday(const QDate &today, int maxDays)
+{
+    // Picks up from the last day rolled onto, so days missed while closed are caught up
+    QDate startDate = today.addDays(-1);
+    QSqlQuery query(m_db);
+    if (query.exec("SELECT value FROM storage_meta WHERE key = 'rolled_forward_to'") && query.next()) {
+        QDate lastDate = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+        if (lastDate.isValid()) {
+            startDate = lastDate;
+        }
+    }
+    startDate = qMax(startDate, today.addDays(-qMax(1, maxDays)));
+    if (startDate >= today) {
+        return 0;
+    }
+
+    int inserted = rollForwardPlans(startDate, today.addDays(-1), today);
+    if (inserted < 0) {
+        return inserted;
+    }
+
+    query.prepare("INSERT OR REPLACE INTO storage_meta (key, value) VALUES ('rolled_forward_to', ?)");
+    query.addBindValue(today.toString(Qt::ISODate));
+    if (!query.exec()) {
+        qDebug() << "记录顺延日期失败:" << query.lastError().text();
+    }
+    return inserted;
+}
+
+int Database::clearHabitPlans(int habitId, const QDate &startDate)
+{
+    QStringList tables;
+    if (m_yearShards) {
+        for (int year : shardYears(QDate(), QDate())) {
+            if (year >= startDate.year() && attachShard(year, false)) {
+                tables << shardSchema(year) + ".daily_plan";
+            }
+        }
+    } else {
+        tables << "daily_plan";
+    }
+
+    int removed = 0;
+    QSqlQuery query(m_db);
+    for (const QString &table : std::as_const(tables)) {
+        query.prepare(QString("DELETE FROM %1 "
+                              "WHERE habit_id = ? AND plan_date >= ? AND status = 0").arg(table));
+        query.addBindValue(habitId);
+        query.addBindValue(startDate);
+
+        if (!query.exec()) {
+            qDebug() << "清理习惯计划失败:" << query.lastError().text();
+            continue;
+        }
+        removed += query.numRowsAffected();
+    }
+
+    return removed;
+}
+
+QString Database::archivePath() const
+{
+    QFileInfo info(m_filePath);
+    return info.dir().filePath(info.completeBaseName() + ".archive.db");
+}
+
+bool Database::attachArchive()
+{
+    if (m_archiveAttached) {
+        return true;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("ATTACH DATABASE ? AS archive");
+    query.addBindValue(archivePath());
+    if (!query.exec()) {
+        qDebug() << "附加归档数据库失败:" << query.lastError().text();
+        return false;
+    }
+
+    // Plain copies of the hot tables: ids are kept, constraints are not needed
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS archive.task ("
+        "id INTEGER PRIMARY KEY, "
+        "name TEXT NOT NULL, "
+        "created_date DATE, "
+        "due_date DATE, "
+        "completed_date DATE, "
+        "status INTEGER"
+        ")"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS archive.daily_plan ("
+        "id INTEGER PRIMARY KEY, "
+        "task_id INTEGER, "
+        "habit_id INTEGER, "
+        "plan_date DATE NOT NULL, "
+        "plan_name TEXT, "
+        "name_id INTEGER, "
+        "index_id INTEGER, "
+        "status INTEGER"
+        ")"
+    );
+
+    query.exec(
+        "CREATE TABLE IF NOT EXISTS archive.archive_meta ("
+        "key TEXT PRIMARY KEY, "
+        "value TEXT"
+        ")"
+    );
+
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_daily_plan_date ON daily_plan (plan_date, index_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_daily_plan_habit ON daily_plan (habit_id, plan_date)");
+    query.exec("CREATE INDEX IF NOT EXISTS archive.idx_daily_plan_name ON daily_plan (name_id, plan_date)");
+
+    m_archiveAttached = true;
+    refreshArchiveState();
+
+    // Tasks archived before the search index existed; archiving itself never drops entries
+    if (m_searchIndex
+        && query.exec("SELECT 1 FROM archive.archive_meta WHERE key = 'search_indexed'") && !query.next()) {
+        m_db.transaction();
+        bool ok = query.exec(QString("INSERT OR REPLACE INTO main.search_index (rowid, body, kind, ref_id) "
+                                     "SELECT (%1 << %2) | id, name, %1, id FROM archive.task")
+                                 .arg(static_cast<int>(SearchKind::Task)).arg(kSearchKindShift));
+        ok = ok && query.exec("INSERT INTO archive.archive_meta (key, value) VALUES ('search_indexed', '1')");
+        if (!ok) {
+            qDebug() << "索引归档任务失败:" << query.lastError().text();
+            m_db.rollback();
+        } else {
+            m_db.commit();
+        }
+    }
+    return true;
+}
+
+void Database::refreshArchiveState()
+{
+    if (!m_archiveAttached) {
+        return;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("SELECT value FROM archive.archive_meta WHERE key = 'plans_before'");
+    if (query.exec() && query.next()) {
+        m_plansArchivedBefore = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+    }
+}
+
+QString Database::planSource(const QDate &startDate) const
+{
+    if (!m_archiveAttached
+        || (startDate.isValid() && (!m_plansArchivedBefore.isValid() || startDate >= m_plansArchivedBefore))) {
+        return QStringLiteral("main.daily_plan");
+    }
+    return QString("(SELECT %1 FROM main.daily_plan UNION ALL SELECT %1 FROM archive.daily_plan)").arg(kPlanColumns);
+}
+
+QString Database::taskSource(bool includeArchive) const
+{
+    if (!m_archiveAttached || !includeArchive) {
+        return QStringLiteral("main.task");
+    }
+    return QString("(SELECT %1 FROM main.task UNION ALL SELECT %1 FROM archive.task)").arg(kTaskColumns);
+}
+
+int Database::archivePlansBefore(const QDate &cutoff, int batchSize)
+{
+    // Year shards already keep old plan history out of the core file
+    if (!m_archiveAttached || m_yearShards || !cutoff.isValid()) {
+        return 0;
+    }
+
+    // Both statements pick the same batch: lowest ids first, inside one transaction
+    const QString batch = QString("SELECT id FROM main.daily_plan WHERE plan_date < ? ORDER BY id LIMIT %1").arg(batchSize);
+
+    m_db.transaction();
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT OR REPLACE INTO archive.daily_plan (%1) "
+                          "SELECT %1 FROM main.daily_plan WHERE id IN (%2)").arg(kPlanColumns, batch));
+    query.addBindValue(cutoff);
+    bool ok = query.exec();
+
+    if (ok) {
+        query.prepare(QString("DELETE FROM main.daily_plan WHERE id IN (%1)").arg(batch));
+        query.addBindValue(cutoff);
+        ok = query.exec();
+    }
+    int moved = ok ? query.numRowsAffected() : 0;
+
+    // The boundary moves with the first batch, so readers union both tables as soon
+    // as any row is archived, also when a run is cut short
+    if (ok && moved > 0) {
+        query.prepare("INSERT INTO archive.archive_meta (key, value) VALUES ('plans_before', ?) "
+                      "ON CONFLICT(key) DO UPDATE SET value = MAX(value, excluded.value)");
+        query.addBindValue(cutoff.toString(Qt::ISODate));
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "归档计划失败:" << query.lastError().text();
+        m_db.rollback();
+        return 0;
+    }
+    m_db.commit();
+    return moved;
+}
+
+int Database::archiveTasksBefore(const QDate &cutoff, int batchSize)
+{
+    if (!m_archiveAttached || !cutoff.isValid()) {
+        return 0;
+    }
+
+    const QString batch = QString("SELECT id FROM main.task WHERE %1 ORDER BY id LIMIT %2").arg(kArchivableTask).arg(batchSize);
+
+    m_db.transaction();
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT OR REPLACE INTO archive.task (%1) "
+                          "SELECT %1 FROM main.task WHERE id IN (%2)").arg(kTaskColumns, batch));
+    query.addBindValue(cutoff);
+    bool ok = query.exec();
+
+    if (ok) {
+        query.prepare(QString("DELETE FROM main.task WHERE id IN (%1)").arg(batch));
+        query.addBindValue(cutoff);
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "归档任务失败:" << query.lastError().text();
+        m_db.rollback();
+        return 0;
+    }
+    int moved = query.numRowsAffected();
+    m_db.commit();
+    return moved;
+}
+
+void Database::restoreArchivedPlans(const QDate &date)
+{
+    if (!m_archiveAttached || m_yearShards || !m_plansArchivedBefore.isValid() || date >= m_plansArchivedBefore) {
+        return;
+    }
+
+    m_db.transaction();
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT OR IGNORE INTO main.daily_plan (%1) "
+                          "SELECT %1 FROM archive.daily_plan WHERE plan_date = ?").arg(kPlanColumns));
+    query.addBindValue(date);
+    bool ok = query.exec();
+
+    if (ok) {
+        query.prepare("DELETE FROM archive.daily_plan WHERE plan_date = ?");
+        query.addBindValue(date);
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qDebug() << "恢复归档计划失败:" << query.lastError().text();
+        m_db.rollback();
+        return;
+    }
+    m_db.commit();
+}
+
+void Database::restoreArchivedTask(int id)
+{
+    if (!m_archiveAttached) {
+        return;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT OR IGNORE INTO main.task (%1) "
+                          "SELECT %1 FROM archive.task WHERE id = ?").arg(kTaskColumns));
+    query.addBindValue(id);
+    if (query.exec() && query.numRowsAffected() > 0) {
+        query.prepare("DELETE FROM archive.task WHERE id = ?");
+        query.addBindValue(id);
+        query.exec();
+    }
+}
+
+bool Database::restoreArchivedTasks(const QList<int> &ids)
+{
+    if (!m_archiveAttached) {
+        return true;
+    }
+
+    const QString idList = placeholderList(ids.size());
+    QSqlQuery query(m_db);
+    query.prepare(QString("INSERT OR IGNORE INTO main.task (%1) "
+                          "SELECT %1 FROM archive.task WHERE id IN (%2)").arg(kTaskColumns, idList));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    if (!query.exec()) {
+        qDebug() << "恢复归档任务失败:" << query.lastError().text();
+        return false;
+    }
+    if (query.numRowsAffected() == 0) {
+        return true;
+    }
+
+    query.prepare(QString("DELETE FROM archive.task WHERE id IN (%1)").arg(idList));
+    for (int id : ids) {
+        query.addBindValue(id);
+    }
+    return query.exec();
+}
+
+void Database::enableYearShards()
+{
+    if (!m_yearShards) {
+        QSqlQuery query(m_db);
+        if (!query.exec("INSERT OR REPLACE INTO storage_meta (key, value) VALUES ('year_shards', '1')")) {
+            qDebug() << "启用年度分片失败:" << query.lastError().text();
+            return;
+        }
+        m_yearShards = true;
+    }
+
+    // Rows left in the core file (or archived before sharding) move to their year
+    migrateIntoShards(QStringLiteral("main.daily_plan"), ShardedTable::Plan);
+    migrateIntoShards(QStringLiteral("main.daily_review"), ShardedTable::Review);
+    if (m_archiveAttached) {
+        migrateIntoShards(QStringLiteral("archive.daily_plan"), ShardedTable::Plan);
+    }
+}
+
+void Database::migrateIntoShards(const QString &source, ShardedTable table)
+{
+    const bool plan = table == ShardedTable::Plan;
+    const QLatin1String tableName(plan ? "daily_plan" : "daily_review");
+    const QLatin1String columns = plan ? kPlanColumns : kReviewColumns;
+    const QLatin1String yearOf(plan ? "CAST(strftime('%Y', plan_date) AS INTEGER)"
+                                    : "CAST(strftime('%Y', COALESCE(period_start, review_date)) AS INTEGER)");
+
+    QList<int> years;
+    QSqlQuery query(m_db);
+    if (!query.exec(QString("SELECT DISTINCT %1 FROM %2").arg(yearOf, source))) {
+        return;
+    }
+    while (query.next()) {
+        if (!query.value(0).isNull()) {
+            years.append(query.value(0).toInt());
+        }
+    }
+
+    for (int year : std::as_const(years)) {
+        if (!attachShard(year, true)) {
+            continue;
+        }
+
+        m_db.transaction();
+        query.prepare(QString("INSERT INTO %1.%2 (%3) SELECT %3 FROM %4 WHERE %5 = ?")
+                          .arg(shardSchema(year), tableName, columns, source, yearOf));
+        query.addBindValue(year);
+        bool ok = query.exec();
+
+        if (ok) {
+            query.prepare(QString("DELETE FROM %1 WHERE %2 = ?").arg(source, yearOf));
+            query.addBindValue(year);
+            ok = query.exec();
+        }
+
+        if (!ok) {
+            qDebug() << "迁移年度分片失败:" << query.lastError().text();
+            m_db.rollback();
+            continue;
+        }
+        m_db.commit();
+    }
+}
+
+QString Database::shardPath(int year) const
+{
+    QFileInfo info(m_filePath);
+    return info.dir().filePath(QString("%1.%2.db").arg(info.completeBaseName()).arg(year));
+}
+
+QList<int> Database::shardYears(const QDate &startDate, const QDate &endDate) const
+{
+    QList<int> years;
+    if (startDate.isValid()) {
+        int lastYear = endDate.isValid() ? endDate.year() : startDate.year();
+        for (int year = startDate.year(); year <= lastYear; ++year) {
+            if (m_attachedShards.contains(year) || QFileInfo::exists(shardPath(year))) {
+                years.append(year);
+            }
+        }
+        return years;
+    }
+
+    QFileInfo info(m_filePath);
+    const QString baseName = info.completeBaseName();
+    const QStringList files = info.dir().entryList({baseName + ".????.db"}, QDir::Files, QDir::Name);
+    for (const QString &file : files) {
+        bool ok = false;
+        int year = file.mid(baseName.size() + 1, 4).toInt(&ok);
+        if (ok) {
+            years.append(year);
+        }
+    }
+    return years;
+}
+
+bool Database::attachShard(int year, bool create)
+{
+    int pos = m_attachedShards.indexOf(year);
+    if (pos >= 0) {
+        m_attachedShards.move(pos, m_attachedShards.size() - 1);
+        return true;
+    }
+
+    const QString path = shardPath(year);
+    if (!create && !QFileInfo::exists(path)) {
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    if (m_attachedShards.size() >= kMaxAttachedShards
+        && query.exec(QString("DETACH DATABASE %1").arg(shardSchema(m_attachedShards.first())))) {
+        m_attachedShards.removeFirst();
+    }
+
+    const QString schema = shardSchema(year);
+    query.prepare(QString("ATTACH DATABASE ? AS %1").arg(schema));
+    query.addBindValue(path);
+    if (!query.exec()) {
+        qDebug() << "附加年度分片失败:" << query.lastError().text();
+        return false;
+    }
+
+    // Same layout as the core tables; foreign keys cannot cross files
+    query.exec(QString(
+        "CREATE TABLE IF NOT EXISTS %1.daily_plan ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "task_id INTEGER, "
+        "habit_id INTEGER, "
+        "plan_date DATE NOT NULL, "
+        "plan_name TEXT, "
+        "name_id INTEGER, "
+        "index_id INTEGER, "
+        "status INTEGER DEFAULT 0, "
+        "CHECK ( (task_id IS NOT NULL AND habit_id IS NULL) OR (task_id IS NULL AND habit_id IS NOT NULL) )"
+        ")").arg(schema));
+
+    query.exec(QString(
+        "CREATE TABLE IF NOT EXISTS %1.daily_review ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "type TEXT, "
+        "review_date DATE NOT NULL, "
+        "period_start DATE, "
+        "period_end DATE, "
+        "period_key INTEGER, "
+        "reflection TEXT, "
+        "summary TEXT"
+        ")").arg(schema));
+
+    query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_daily_plan_date ON daily_plan (plan_date, index_id)").arg(schema));
+    query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_daily_plan_habit ON daily_plan (habit_id, plan_date)").arg(schema));
+    query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_daily_plan_name ON daily_plan (name_id, plan_date)").arg(schema));
+    ensurePeriodKeys(schema);
+
+    m_attachedShards.append(year);
+    return true;
+}
+
+QString Database::shardedTable(ShardedTable table, const QDate &date)
+{
+    const QLatin1String tableName(table == ShardedTable::Plan ? "daily_plan" : "daily_review");
+    if (m_yearShards && attachShard(date.year(), true)) {
+        return shardSchema(date.year()) + '.' + tableName;
+    }
+    return tableName;
+}
+
+QList<QVariantList> Database::selectRows(ShardedTable table, const QString &sql, const QVariantList &binds,
+                                         const QDate &startDate, const QDate &endDate)
+{
+    QList<QVariantList> rows;
+    const QLatin1String tableName(table == ShardedTable::Plan ? "daily_plan" : "daily_review");
+
+    QString source;
+    if (!m_yearShards) {
+        source = table == ShardedTable::Plan ? planSource(startDate) : QString(tableName);
+    } else {
+        const QList<int> years = shardYears(startDate, endDate);
+        if (years.isEmpty()) {
+            return rows;
+        }
+        if (years.size() > 1) {
+            return queryShards(years, sql.arg(tableName), binds);
+        }
+        if (!attachShard(years.first(), false)) {
+            return rows;
+        }
+        source = shardSchema(years.first()) + '.' + tableName;
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    query.prepare(sql.arg(source));
+    for (const QVariant &value : binds) {
+        query.addBindValue(value);
+    }
+    if (!query.exec()) {
+        qDebug() << "查询失败:" << query.lastError().text();
+        return rows;
+    }
+
+    readRows(query, rows);
+    return rows;
+}
+
+QList<QVariantList> Database::queryShards(const QList<int> &years, const QString &sql, const QVariantList &binds) const
+{
+    QList<ShardQuery> queries;
+    queries.reserve(years.size());
+    for (int year : years) {
+        queries.append({shardPath(year), sql, binds});
+    }
+
+    // One reader per year file in parallel, merged back in year order
+    const QList<QList<QVariantList>> results = QtConcurrent::blockingMapped(queries, runShardQuery);
+
+    QList<QVariantList> rows;
+    for (const QList<QVariantList> &shardRows : results) {
+        rows.append(shardRows);
+    }
+    return rows;
+}
+
+QString Database::memoryName(const QString &filePath)
+{
+    return QString("file:%1?mode=memory&cache=shared").arg(filePath);
+}
+
+bool Database::isInMemory() const
+{
+    return m_inMemory;
+}
+
+void Database::loadFromDisk()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT COUNT(*) FROM sqlite_master") || !query.next() || query.value(0).toInt() > 0) {
+        return; // another connection already loaded the shared memory database
+    }
+    recoverInterruptedFlush(m_filePath);
+    if (!QFileInfo::exists(m_filePath)) {
+        return;
+    }
+
+    query.prepare("ATTACH DATABASE ? AS disk");
+    query.addBindValue(m_filePath);
+    if (!query.exec()) {
+        qDebug() << "加载数据库失败:" << query.lastError().text();
+        return;
+    }
+
+    QList<QPair<QString, QString>> objects;
+    QStringList virtualTables;
+    query.exec("SELECT type, name, sql FROM disk.sqlite_master "
+               "WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite_%' "
+               "ORDER BY CASE type WHEN 'table' THEN 0 ELSE 1 END");
+    while (query.next()) {
+        if (query.value(0).toString() == "table") {
+            objects.append({query.value(1).toString(), query.value(2).toString()});
+            if (query.value(2).toString().startsWith("CREATE VIRTUAL TABLE", Qt::CaseInsensitive)) {
+                virtualTables.append(query.value(1).toString());
+            }
+        } else {
+            objects.append({QString(), query.value(2).toString()});
+        }
+    }
+
+    // Shadow tables are created and filled through their virtual table
+    objects.removeIf([&virtualTables](const QPair<QString, QString> &object) {
+        for (const QString &table : std::as_const(virtualTables)) {
+            if (object.first.startsWith(table + '_')) return true;
+        }
+        return false;
+    });
+
+    m_db.transaction();
+    bool ok = true;
+    for (const auto &object : std::as_const(objects)) {
+        ok = ok && query.exec(object.second);
+        if (ok && virtualTables.contains(object.first)) {
+            // SELECT * leaves out the rowid, which search entries are keyed by
+            ok = query.exec(QString("SELECT * FROM disk.\"%1\" LIMIT 0").arg(object.first));
+            QStringList columns;
+            for (int i = 0; ok && i < query.record().count(); ++i) {
+                columns.append(query.record().fieldName(i));
+            }
+            ok = ok && query.exec(QString("INSERT INTO main.\"%1\" (rowid, %2) SELECT rowid, %2 FROM disk.\"%1\"")
+                                      .arg(object.first, columns.join(", ")));
+        } else if (ok && !object.first.isEmpty()) {
+            ok = query.exec(QString("INSERT INTO main.\"%1\" SELECT * FROM disk.\"%1\"").arg(object.first));
+        }
+    }
+
+    // AUTOINCREMENT counters and the schema version travel with the data
+    if (ok && query.exec("SELECT 1 FROM disk.sqlite_master WHERE name = 'sqlite_sequence'") && query.next()) {
+        ok = query.exec("INSERT INTO main.sqlite_sequence SELECT * FROM disk.sqlite_sequence");
+    }
+    if (ok && query.exec("PRAGMA disk.user_version") && query.next()) {
+        ok = query.exec(QString("PRAGMA main.user_version = %1").arg(query.value(0).toInt()));
+    }
+
+    if (!ok) {
+        qDebug() << "加载数据库失败:" << query.lastError().text();
+        m_db.rollback();
+    } else {
+        m_db.commit();
+    }
+    query.exec("DETACH DATABASE disk");
+}
+
+bool Database::flushToDisk()
+{
+    if (!m_inMemory) {
+        return false;
+    }
+
+    const QString tempPath = m_filePath + ".flush";
+    const QString backupPath = m_filePath + ".bak";
+    recoverInterruptedFlush(m_filePath);
+    QFile::remove(tempPath);
+
+    QSqlQuery query(m_db);
+    query.prepare("VACUUM main INTO ?");
+    query.addBindValue(tempPath);
+    if (!query.exec()) {
+        qDebug() << "写回磁盘失败:" << query.lastError().text();
+        return false;
+    }
+    if (!isIntactDatabase(tempPath)) {
+        qDebug() << "写回磁盘失败: 快照校验未通过" << tempPath;
+        QFile::remove(tempPath);
+        return false;
+    }
+
+    // The previous file becomes the backup; the older backup only goes once there is
+    // a newer copy to replace it, and the new backup only once the snapshot is in place
+    if (QFileInfo::exists(m_filePath)) {
+        QFile::remove(backupPath);
+        if (!QFile::rename(m_filePath, backupPath)) {
+            qDebug() << "写回磁盘失败: 无法替换" << m_filePath;
+            return false;
+        }
+    }
+    if (!QFile::rename(tempPath, m_filePath)) {
+        qDebug() << "写回磁盘失败: 无法替换" << m_filePath;
+        QFile::rename(backupPath, m_filePath);
+        return false;
+    }
+    if (!isIntactDatabase(m_filePath)) {
+        qDebug() << "写回磁盘失败: 校验未通过, 保留备份" << backupPath;
+        return false;
+    }
+    QFile::remove(backupPath);
+    return true;
+}
+
+bool Database::getReviewDraft(qint64 periodKey, ReviewData &draft)
+{
+    QSqlQuery query(m_db);
+    query.prepare("SELECT reflection, summary "
+                  "FROM review_draft "
+                  "WHERE period_key = ?");
+    query.addBindValue(periodKey);
+
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+
+    draft.reflection = unpackReviewText(query.value(0));
+    draft.summary = unpackReviewText(query.value(1));
+    return true;
+}
+
+ReviewData Database::buildReviewDraft(qint64 periodKey)
+{
+    // Every invalidation bumps the epoch; the draft is only cached when none happened
+    // since the children were read. Year shards are read on other connections, so a
+    // transaction alone would not cover them.
+    QString epoch = QStringLiteral("0");
+    QSqlQuery query(m_db);
+    if (query.exec("SELECT value FROM storage_meta WHERE key = 'review_epoch'") && query.next()) {
+        epoch = query.value(0).toString();
+    }
+
+    ReviewData draft;
+    const QList<ReviewData> children = getChildReviews(periodKey);
+    for (const ReviewData &child : children) {
+        draft.reflection += child.reflection + "\n";
+        draft.summary += child.summary + "\n";
+    }
+    draft.reflection = draft.reflection.trimmed();
+    draft.summary = draft.summary.trimmed();
+
+    query.prepare("INSERT OR REPLACE INTO review_draft (period_key, reflection, summary) "
+                  "SELECT ?, ?, ? "
+                  "WHERE COALESCE((SELECT value FROM storage_meta WHERE key = 'review_epoch'), '0') = ?");
+    query.addBindValue(periodKey);
+    query.addBindValue(packReviewText(draft.reflection));
+    query.addBindValue(packReviewText(draft.summary));
+    query.addBindValue(epoch);
+    if (!query.exec()) {
+        qDebug() << "保存总结草稿失败:" << query.lastError().text();
+    }
+    return draft;
+}
+
+void Database::invalidateReviewDrafts(qint64 periodKey)
+{
+    QSqlQuery query(m_db);
+    query.prepare("DELETE FROM review_draft WHERE period_key = ?");
+    for (qint64 parentKey : PeriodCalendar::parentKeys(periodKey)) {
+        query.addBindValue(parentKey);
+        if (!query.exec()) {
+            qDebug() << "清理总结草稿失败:" << query.lastError().text();
+        }
+    }
+
+    // Drafts built from children read before this point are no longer cached
+    if (!query.exec("INSERT INTO storage_meta (key, value) VALUES ('review_epoch', '1') "
+                    "ON CONFLICT(key) DO UPDATE SET value = value + 1")) {
+        qDebug() << "清理总结草稿失败:" << query.lastError().text();
+    }
+}
+
+bool Database::ensurePeriodKeys(const QString &schema)
+{
+    QSqlQuery query(m_db);
+    bool hasKey = false;
+    if (!query.exec(QString("PRAGMA %1.table_info(daily_review)").arg(schema))) {
+        return false;
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == "period_key") hasKey = true;
+    }
+    if (!hasKey && !query.exec(QString("ALTER TABLE %1.daily_review ADD COLUMN period_key INTEGER").arg(schema))) {
+        return false;
+    }
+
+    // Rows written before keys existed: derive the key from type and period start
+    QSqlQuery update(m_db);
+    update.prepare(QString("UPDATE %1.daily_review SET period_key = ? WHERE id = ?").arg(schema));
+    if (!query.exec(QString("SELECT id, type, period_start FROM %1.daily_review WHERE period_key IS NULL").arg(schema))) {
+        return false;
+    }
+    while (query.next()) {
+        bool ok = false;
+        PeriodCalendar::Type type = PeriodCalendar::typeFromString(query.value(1).toString(), &ok);
+        if (!ok) continue;
+        update.addBindValue(PeriodCalendar::key(type, query.value(2).toDate()));
+        update.addBindValue(query.value(0));
+        if (!update.exec()) {
+            return false;
+        }
+    }
+
+    return query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_daily_review_key ON daily_review (period_key)").arg(schema));
+}
+
+bool Database::createSearchIndex()
+{
+    QSqlQuery query(m_db);
+
+    // Trigram tokens match any substring of three or more characters, Chinese included
+    if (!query.exec("CREATE VIRTUAL TABLE IF NOT EXISTS search_index "
+                    "USING fts5(body, kind UNINDEXED, ref_id UNINDEXED, tokenize = 'trigram')")) {
+        return false;
+    }
+
+    // Plan rows share their name through name_dict, so a plan is searched by name once
+    const QStringList statements = {
+        searchTrigger("task", "INSERT", SearchKind::Task),
+        searchTrigger("task", "UPDATE OF name", SearchKind::Task),
+        searchTrigger("habits", "INSERT", SearchKind::Habit),
+        searchTrigger("habits", "UPDATE OF name", SearchKind::Habit),
+        searchTrigger("name_dict", "INSERT", SearchKind::Plan),
+        QString("INSERT OR REPLACE INTO search_index (rowid, body, kind, ref_id) "
+                "SELECT (%1 << %2) | id, name, %1, id FROM task").arg(static_cast<int>(SearchKind::Task)).arg(kSearchKindShift),
+        QString("INSERT OR REPLACE INTO search_index (rowid, body, kind, ref_id) "
+                "SELECT (%1 << %2) | id, name, %1, id FROM habits").arg(static_cast<int>(SearchKind::Habit)).arg(kSearchKindShift),
+        QString("INSERT OR REPLACE INTO search_index (rowid, body, kind, ref_id) "
+                "SELECT (%1 << %2) | id, name, %1, id FROM name_dict").arg(static_cast<int>(SearchKind::Plan)).arg(kSearchKindShift),
+    };
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Database::indexReview(qint64 periodKey, const QString &reflection, const QString &summary)
+{
+    if (!m_searchIndex) {
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR REPLACE INTO search_index (rowid, body, kind, ref_id) "
+                  "VALUES (?, ?, ?, ?)");
+    query.addBindValue((qint64(SearchKind::Review) << kSearchKindShift) | periodKey);
+    query.addBindValue(QString(reflection + '\n' + summary).trimmed());
+    query.addBindValue(static_cast<int>(SearchKind::Review));
+    query.addBindValue(periodKey);
+
+    if (!query.exec()) {
+        qDebug() << "索引总结失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QList<SearchHit> Database::search(const QString &text, int limit)
+{
+    QList<SearchHit> hits;
+    const QString needle = text.trimmed();
+    if (!m_searchIndex || needle.isEmpty()) {
+        return hits;
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (needle.size() >= 3) {
+        query.prepare("SELECT kind, ref_id, body "
+                      "FROM search_index "
+                      "WHERE search_index MATCH ? "
+                      "ORDER BY rank "
+                      "LIMIT ?");
+        query.addBindValue(ftsPhrase(needle));
+    } else {
+        // Too short for a trigram; scan the indexed text, shortest entries first
+        query.prepare("SELECT kind, ref_id, body "
+                      "FROM search_index "
+                      "WHERE instr(lower(body), lower(?)) > 0 "
+                      "ORDER BY length(body) "
+                      "LIMIT ?");
+        query.addBindValue(needle);
+    }
+    query.addBindValue(limit);
+
+    if (!query.exec()) {
+        qDebug() << "搜索失败:" << query.lastError().text();
+        return hits;
+    }
+
+    while (query.next()) {
+        SearchHit hit;
+        hit.kind = static_cast<SearchKind>(query.value(0).toInt());
+        hit.refId = query.value(1).toLongLong();
+        hit.text = query.value(2).toString();
+        hits.append(hit);
+    }
+    return hits;
+}
+
+QDate Database::getLastPlanDate(int nameId)
+{
+    QDate lastDate;
+    const QList<QVariantList> rows = selectRows(ShardedTable::Plan,
+                                                "SELECT MAX(plan_date) "
+                                                "FROM %1 "
+                                                "WHERE name_id = ?;",
+                                                {nameId}, QDate(), QDate());
+    // One row per year file when sharded
+    for (const QVariantList &row : rows) {
+        QDate date = row.at(0).toDate();
+        if (date.isValid() && (!lastDate.isValid() || date > lastDate)) {
+            lastDate = date;
+        }
+    }
+    return lastDate;
 }
@@ -1,8 +1,15 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include "utils.h"
+
 #include <QSqlDatabase>
 #include <QDate>
+#include <QHash>
+#include <QMetaType>
+#include <QVariant>
+
+#include <functional>
 
 struct TaskData {
     int id; // Primary key
@@ -10,7 +17,43 @@ struct TaskData {
     QDate createdDate; // Created date
     QDate dueDate; // Due date
     QDate completedDate; // Completed date
-    int status; // Task status
+    TaskStatus status; // Task status
+};
+
+/**
+ * @brief TaskQuery Filter, order and page of a task read. Empty filters match every
+ *        task; a page continues after the sort value and id of the previous page's last row.
+ */
+struct TaskQuery {
+    enum class SortKey { Id, Name, CreatedDate, DueDate };
+
+    QList<TaskStatus> statuses; // Any status when empty
+    QList<int> ids; // Only these tasks when not empty
+    QDate dueFrom; // Inclusive, open when invalid
+    QDate dueTo; // Inclusive, open when invalid
+    QString nameContains;
+    SortKey sortKey = SortKey::Id;
+    bool descending = false;
+    int limit = 0; // Every row when 0
+    QVariant afterValue; // Keyset cursor, see continueAfter()
+    int afterId = 0;
+    int parentId = 0; // Only direct subtasks of this task when set
+    bool rootsOnly = false; // Leaves out subtasks whose parent the filter lists too
+    bool tagFiltered = false; // Only tasks in the tag filter, see Database::setTaskTagFilter()
+
+    /**
+     * @brief continueAfter Moves the cursor past task, the last row already read
+     */
+    void continueAfter(const TaskData &task);
+};
+
+/**
+ * @brief TaskProgress Rollup of a task's subtree; cancelled subtasks are left out of total
+ */
+struct TaskProgress {
+    int children = 0; // Direct subtasks
+    int total = 0; // Subtasks at any depth
+    int completed = 0; // Of total, completed on time or late
 };
 
 struct HabitData {
@@ -18,7 +61,7 @@ struct HabitData {
     QString name; // Habit name
     QDate createdDate; // Created date
     QString target_frequency; // Habit Frequency
-    int status; // Habit status
+    HabitStatus status; // Habit status
 };
 
 struct PlanData {
@@ -26,49 +69,423 @@ struct PlanData {
     QString type;
     QString name; // Plan name
     QString target_frequency; // Habit Frequency
-    int status; // Habit status
+    PlanStatus status; // Plan status
+    int indexId; // Sparse rank within the day, see Database::PlanRankStep
+    int taskId = 0; // Set for task rows
+    int habitId = 0; // Set for habit rows
 };
 
+struct PlanChange {
+    int id; // Primary key, 0 for a row not saved yet
+    int taskId; // Set for task rows
+    int habitId; // Set for habit rows
+    QString name; // Plan name
+    int indexId; // Rank within the day
+    PlanStatus status; // Plan status
+};
+
+/**
+ * @brief EditBatch Plan and review edits of one day, saved in one transaction
+ */
+struct EditBatch {
+    QDate date; // Day of the plan rows, also the review's date
+    QList<int> removedIds; // Saved plan rows to delete
+    QList<PlanChange> changes;
+    bool hasReview = false;
+    QString reviewType;
+    QString reflection;
+    QString summary;
+};
+Q_DECLARE_METATYPE(EditBatch)
+
 struct ReviewData {
     QString reflection;
     QString summary;
 };
+
+enum class TagKind : int {
+    Task = 1,
+    Habit,
+};
+
+// Picks the plan rows a chart counts, by the task or habit (0 when unset) of the row
+using PlanFilter = std::function<bool(int taskId, int habitId)>;
+
+enum class SearchKind : int {
+    Task = 1,
+    Habit,
+    Plan,    // refId is the name_dict id
+    Review,  // refId is the period key
+};
+
+struct SearchHit {
+    SearchKind kind;
+    qint64 refId;
+    QString text; // indexed text the hit matched in
+};
+Q_DECLARE_METATYPE(SearchHit)
+
 class Database
 {
 public:
-    Database(const QString& dbName);
+    // Gap left between the ranks (index_id) of neighbouring plan rows, so a row
+    // inserted or moved between two others takes a rank without renumbering them
+    static constexpr int PlanRankStep = 1024;
+
+    Database(const QString& dbName, const QString& connectionName = QLatin1String(QSqlDatabase::defaultConnection));
+
+    /**
+     * @brief memoryName Connection name of the process-wide in-memory copy of filePath;
+     *        the first connection loads the file, flushToDisk() writes it back
+     */
+    static QString memoryName(const QString &filePath);
+    bool isInMemory() const;
+
+    /**
+     * @brief flushToDisk Snapshots the in-memory database with VACUUM INTO and
+     *        swaps it in for the disk file
+     */
+    bool flushToDisk();
 
     QList<TaskData> getTaskByStatus(int status);
+
+    /**
+     * @brief queryTasks Filters, sorts and pages tasks in SQLite; archived tasks are
+     *        only read when the status filter can match them
+     */
+    QList<TaskData> queryTasks(const TaskQuery &taskQuery);
     QList<HabitData> getHabitByStatus(int status);
     QList<PlanData> getPlanByDate(const QDate& date);
-    QMap<QDate,double> getPlanNumberByDate(const QDate& startDate, const QDate& endDate);
-    ReviewData getReviewByDate(const QString& type, const QDate& startDate, const QDate& endDate);
-    QList<ReviewData> getReviewByType(const QString& type, const QDate& startDate, const QDate& endDate);
-    void addTask(TaskData data);
-    void addHabit(HabitData data);
+    QMap<QDate, QList<PlanData>> getPlanByRange(const QDate& startDate, const QDate& endDate);
+    QMap<QDate,double> getPlanNumberByDate(const QDate& startDate, const QDate& endDate, const PlanFilter &filter = PlanFilter());
+    ReviewData getReviewByKey(qint64 periodKey);
+
+    /**
+     * @brief getChildReviews Reviews a rollup of periodKey is drafted from, in period order
+     */
+    QList<ReviewData> getChildReviews(qint64 periodKey);
+    int addTask(TaskData data, int parentId = 0);
+    int addHabit(HabitData data);
     void updateTaskName(int id, const QString& name);
     void updateTaskDueDate(int id, const QDate& date);
-    void updateTaskStatus(int id, int status);
+    void updateTaskStatus(int id, TaskStatus status);
+
+    /**
+     * @brief updateTasksStatus Batch form of updateTaskStatus: every task in ids and
+     *        their plan rows today change in one transaction of set-based UPDATEs
+     */
+    bool updateTasksStatus(const QList<int> &ids, TaskStatus status);
+
+    /**
+     * @brief shiftTasksDueDate Moves the due date of every task in ids by days;
+     *        tasks without a due date are left alone
+     */
+    bool shiftTasksDueDate(const QList<int> &ids, int days);
+
+    /**
+     * @brief markOverdueTasks Sets in-progress tasks due before today to 未完成 with
+     *        one UPDATE over the status/due-date index
+     * @return Ids of the tasks that changed
+     */
+    QList<int> markOverdueTasks(const QDate &today);
+
+    /**
+     * @brief setTaskParent Moves every task in ids, subtree included, under parentId;
+     *        0 makes them top-level tasks. Refused when parentId lies inside a moved subtree.
+     */
+    bool setTaskParent(const QList<int> &ids, int parentId);
+
+    /**
+     * @brief getTaskAncestors Ids from the top-level task down to the parent of id
+     */
+    QList<int> getTaskAncestors(int id);
+
+    /**
+     * @brief getOpenSubtasks In progress and unfinished tasks below any task in ids
+     */
+    QList<int> getOpenSubtasks(const QList<int> &ids);
+
+    /**
+     * @brief addTag Id of the tag called name, created on first use
+     */
+    int addTag(const QString &name);
+    QHash<int, QString> getTags();
+
+    /**
+     * @brief getTagLinks Every (tag id, row id) pair of one kind, grouped by tag
+     */
+    QList<QPair<int, int>> getTagLinks(TagKind kind);
+
+    /**
+     * @brief getTaggableIds Ids of every task, archived ones included, or every habit
+     */
+    QList<int> getTaggableIds(TagKind kind);
+
+    /**
+     * @brief setTagged Adds or removes one tag on every row in ids with one statement
+     */
+    bool setTagged(TagKind kind, int tagId, const QList<int> &ids, bool tagged);
+
+    /**
+     * @brief setTaskTagFilter Stores the task ids a tag expression matched in a temporary
+     *        table of this connection, which queries with TaskQuery::tagFiltered join
+     */
+    bool setTaskTagFilter(const QList<int> &ids);
+
+    /**
+     * @brief getTaskProgress Subtree rollups of the tasks in ids with one grouped read;
+     *        tasks without subtasks are left out
+     */
+    QHash<int, TaskProgress> getTaskProgress(const QList<int> &ids);
     void updateHabitName(int id, const QString& name);
     void updateHabitCreatedDate(int id, const QDate& date);
     void updateHabitFrequency(int id, QString frequency);
-    void updateHabitStatus(int id, int status);
+    void updateHabitStatus(int id, HabitStatus status);
+    bool updateHabitsStatus(const QList<int> &ids, HabitStatus status);
     int getHabitIdByName(QString name);
     int getTaskIdByName(QString name);
-    void updateHabitPlan(int index, QString name, int status, int habitId, QDate date);
-    void updateTaskPlan(int index, QString name, int status, int taskId, QDate date);
-    void updateReview(const QString& reflection, const QString& summary, const QDate& date, const QString& type);
-    void updateHabitStatusByTimes(const HabitData &habit);
+
+    /**
+     * @brief saveEdits Writes an edit batch in one transaction: removed plan rows are
+     *        deleted, rows with an id are updated in place, the rest are inserted
+     * @param insertedIds Receives the ids of the inserted rows in change order
+     */
+    bool saveEdits(const EditBatch &batch, QList<int> *insertedIds = nullptr);
+    bool updateReview(const QString& reflection, const QString& summary, const QDate& date, const QString& type);
+
+    /**
+     * @brief getReviewDraft Cached rollup of a period's child reviews
+     * @return false when no draft is cached for the period
+     */
+    bool getReviewDraft(qint64 periodKey, ReviewData &draft);
+
+    /**
+     * @brief buildReviewDraft Rolls up the child reviews of a period and caches the
+     *        result, unless a child review was saved in between by another connection
+     */
+    ReviewData buildReviewDraft(qint64 periodKey);
+
+    /**
+     * @brief search Full-text search over task, habit and plan names and review text,
+     *        best matches first
+     */
+    QList<SearchHit> search(const QString &text, int limit);
+
+    /**
+     * @brief getLastPlanDate Latest day a plan with this name_dict id was scheduled
+     */
+    QDate getLastPlanDate(int nameId);
+    /**
+     * @brief completeHabit Moves an in-progress habit to 已完成
+     * @return Whether the habit's status changed
+     */
+    bool completeHabit(int habitId);
     int getHabitTimes(const HabitData &habit);
+
+    /**
+     * @brief getHabitCompletions Completed days of each habit in ascending order
+     * @param habitIds Restricts the read to these habits, every habit if empty
+     */
+    QHash<int, QList<QDate>> getHabitCompletions(const QList<int> &habitIds = QList<int>());
+
+    /**
+     * @brief getHabitMaxTimes Longest run of consecutive calendar days (periods for
+     *        every-n-days habits) completed; superseded by HabitStats::longestStreak
+     *        and kept as the baseline of the habit statistics benchmark
+     */
     int getHabitMaxTimes(const HabitData &habit);
 
+    /**
+     * @brief materializeHabitPlans Inserts due habit rows into daily_plan for every day
+     *        in [startDate, endDate] with one INSERT ... SELECT; existing rows are kept
+     * @param habitIds Restricts the run to these habits, all active habits if empty
+     * @return Number of inserted rows, -1 on error
+     */
+    int materializeHabitPlans(const QDate &startDate, const QDate &endDate, const QList<int> &habitIds = QList<int>());
+
+    /**
+     * @brief materializeThrough Scheduled run: materializes only the days after the
+     *        last one already done, so occurrences deleted since are not recreated
+     */
+    int materializeThrough(const QDate &today, const QDate &endDate);
+
+    /**
+     * @brief rollForwardPlans Copies the unfinished task rows of [startDate, endDate] onto
+     *        targetDate with one INSERT ... SELECT. A task planned on several days is
+     *        copied once, tasks already on targetDate are skipped, and the copies are
+     *        ranked after targetDate's rows in the order they were last planned.
+     * @return Number of inserted rows, -1 on error
+     */
+    int rollForwardPlans(const QDate &startDate, const QDate &endDate, const QDate &targetDate);
+
+    /**
+     * @brief rollForwardToToday Nightly roll-forward: every day since the previous run,
+     *        at most maxDays back, is rolled onto today
+     */
+    int rollForwardToToday(const QDate &today, int maxDays);
+
+    /**
+     * @brief clearHabitPlans Removes untouched (in progress) rows of a habit from startDate on
+     */
+    int clearHabitPlans(int habitId, const QDate &startDate);
+
+    /**
+     * @brief attachArchive Attaches the cold archive file next to the database as
+     *        schema "archive", creating its tables on first use
+     */
+    bool attachArchive();
+
+    /**
+     * @brief refreshArchiveState Rereads the archived date boundary after another
+     *        connection moved rows
+     */
+    void refreshArchiveState();
+
+    /**
+     * @brief archivePlansBefore Moves one batch of plan rows dated before cutoff into
+     *        the archive, together with the archived date boundary, in a single transaction
+     * @return Number of moved rows; fewer than batchSize means the cutoff is reached
+     */
+    int archivePlansBefore(const QDate &cutoff, int batchSize);
+
+    /**
+     * @brief archiveTasksBefore Moves one batch of completed or cancelled tasks that
+     *        finished before cutoff into the archive
+     */
+    int archiveTasksBefore(const QDate &cutoff, int batchSize);
+
+    /**
+     * @brief restoreArchivedPlans Moves an archived day back into the hot table so
+     *        it can be edited in place
+     */
+    void restoreArchivedPlans(const QDate &date);
+
+    /**
+     * @brief enableYearShards Stores daily_plan and daily_review in one file per year
+     *        (<db>.<year>.db) attached on demand; tasks, habits and names stay in the core file.
+     *        The choice is recorded in the core file so every connection follows it.
+     */
+    void enableYearShards();
+
 private:
+    enum class ShardedTable { Plan, Review };
+
     QSqlDatabase m_db;
+    QString m_filePath;  // disk file, also the base name of archive and year files
+    bool m_inMemory;
+    QHash<int, QString> m_names;   // interned plan names by name_dict id
+    QHash<QString, int> m_nameIds;
+    bool m_archiveAttached;
+    QDate m_plansArchivedBefore;  // every plan row before this date lives in the archive
+    bool m_yearShards;
+    QList<int> m_attachedShards;  // least recently used first
+    bool m_searchIndex;
 
     /**
      * @brief createTables Creates core database tables if they don't exist
      */
     void createTables();
+
+    /**
+     * @brief migrateSchema Upgrades existing files step by step using PRAGMA user_version
+     */
+    void migrateSchema();
+
+    /**
+     * @brief planName Interned plan name for a name_dict id; rows share one QString
+     */
+    const QString &planName(int nameId);
+
+    /**
+     * @brief planNameId Looks up or creates the name_dict id of a plan name
+     */
+    int planNameId(const QString &name);
+
+    /**
+     * @brief loadFromDisk Copies schema and rows of the disk file into a fresh
+     *        in-memory database
+     */
+    void loadFromDisk();
+
+    QString archivePath() const;
+
+    /**
+     * @brief planSource FROM source for daily_plan reads starting at startDate; the
+     *        archive is only unioned in when the range reaches into it. An invalid
+     *        date means full history.
+     */
+    QString planSource(const QDate &startDate) const;
+
+    /**
+     * @brief taskSource FROM source for task reads, unioned with the archive on request
+     */
+    QString taskSource(bool includeArchive) const;
+
+    /**
+     * @brief restoreArchivedTask Moves an archived task back before it is modified
+     */
+    void restoreArchivedTask(int id);
+    bool restoreArchivedTasks(const QList<int> &ids);
+
+    /**
+     * @brief linkTask Detaches the subtree of id from its old ancestors and, when
+     *        parentId is set, hangs it below parentId; runs in the caller's transaction
+     */
+    bool linkTask(int id, int parentId);
+
+    QString shardPath(int year) const;
+
+    /**
+     * @brief shardYears Existing year files overlapping [startDate, endDate]; all of
+     *        them when startDate is invalid
+     */
+    QList<int> shardYears(const QDate &startDate, const QDate &endDate) const;
+
+    /**
+     * @brief attachShard Attaches a year file as schema y<year>, detaching the least
+     *        recently used one when the attach limit is near
+     */
+    bool attachShard(int year, bool create);
+
+    /**
+     * @brief shardedTable Write target for a row dated date
+     */
+    QString shardedTable(ShardedTable table, const QDate &date);
+
+    /**
+     * @brief selectRows Runs sql with %1 replaced by the table source covering
+     *        [startDate, endDate]: one attached file when the range stays in a year,
+     *        a parallel fan-out over the year files otherwise
+     */
+    QList<QVariantList> selectRows(ShardedTable table, const QString &sql, const QVariantList &binds,
+                                   const QDate &startDate, const QDate &endDate);
+
+    QList<QVariantList> queryShards(const QList<int> &years, const QString &sql, const QVariantList &binds) const;
+    void migrateIntoShards(const QString &source, ShardedTable table);
+
+    /**
+     * @brief invalidateReviewDrafts Drops the drafts of the periods that roll up periodKey
+     */
+    void invalidateReviewDrafts(qint64 periodKey);
+
+    /**
+     * @brief ensurePeriodKeys Adds and backfills daily_review.period_key in schema
+     */
+    bool ensurePeriodKeys(const QString &schema);
+
+    bool writePlanChanges(const QString &table, const EditBatch &batch, QList<int> *insertedIds);
+
+    /**
+     * @brief createSearchIndex Creates the FTS5 table with its sync triggers and
+     *        indexes the existing names
+     */
+    bool createSearchIndex();
+
+    /**
+     * @brief indexReview Review bodies may be stored compressed, so the plain text
+     *        is indexed here instead of by a trigger
+     */
+    bool indexReview(qint64 periodKey, const QString &reflection, const QString &summary);
 };
 
 #endif // DATABASE_H
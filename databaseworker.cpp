@@ -0,0 +1,32 @@
+#include "databaseworker.h"
+#include "database.h"
+
+DatabaseWorker::DatabaseWorker(const QString &dbName, const QString &connectionName, QObject *parent)
+    : QObject{parent}
+    , m_dbName(dbName)
+    , m_connectionName(connectionName)
+    , m_dbManager(nullptr)
+{}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    if (m_dbManager) {
+        delete m_dbManager;
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+Database *DatabaseWorker::database()
+{
+    // The connection must be created in the thread that uses it
+    if (!m_dbManager) {
+        m_dbManager = new Database(m_dbName, m_connectionName);
+        prepare(m_dbManager);
+    }
+    return m_dbManager;
+}
+
+void DatabaseWorker::prepare(Database *database)
+{
+    Q_UNUSED(database);
+}
@@ -0,0 +1,35 @@
+#ifndef DATABASEWORKER_H
+#define DATABASEWORKER_H
+
+#include <QObject>
+#include <QString>
+
+class Database;
+
+/**
+ * @brief DatabaseWorker Base of the objects that do database work in a background
+ *        thread. Owns one named connection, opened on first use so it belongs to
+ *        the worker's thread, and removed again with the worker.
+ */
+class DatabaseWorker : public QObject
+{
+    Q_OBJECT
+public:
+    DatabaseWorker(const QString &dbName, const QString &connectionName, QObject *parent = nullptr);
+    ~DatabaseWorker();
+
+protected:
+    Database *database();
+
+    /**
+     * @brief prepare Runs once on the new connection, in the worker thread
+     */
+    virtual void prepare(Database *database);
+
+private:
+    QString m_dbName;
+    QString m_connectionName;
+    Database *m_dbManager;
+};
+
+#endif // DATABASEWORKER_H
@@ -0,0 +1,62 @@
+#include "plancelldelegate.h"
+#include "../models/planrangemodel.h"
+
+#include <QPainter>
+
+PlanCellDelegate::PlanCellDelegate(QObject *parent)
+    : QStyledItemDelegate{parent}
+{}
+
+void PlanCellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const PlanRangeModel *model = qobject_cast<const PlanRangeModel*>(index.model());
+    if (!model) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    painter->save();
+    if (option.state & QStyle::State_Selected) {
+        painter->fillRect(option.rect, option.palette.highlight());
+    }
+
+    QRect rect = option.rect.adjusted(2, 2, -2, -2);
+    QFontMetrics metrics(option.font);
+    int lineHeight = metrics.height() + 2;
+
+    QDate date = model->dateAt(index);
+    QColor dayColor = option.palette.text().color();
+    if (!model->isInPeriod(index)) {
+        dayColor.setAlpha(100);
+    }
+    painter->setPen(dayColor);
+    QFont dayFont = option.font;
+    dayFont.setBold(date == QDate::currentDate());
+    painter->setFont(dayFont);
+    painter->drawText(QRect(rect.left(), rect.top(), rect.width(), lineHeight), Qt::AlignLeft | Qt::AlignVCenter, QString::number(date.day()));
+    painter->setFont(option.font);
+
+    // Only the lines that fit are drawn; the rest collapse into a "+N" marker
+    const QList<PlanData> &plans = model->plansAt(index);
+    int y = rect.top() + lineHeight;
+    for (int i = 0; i < plans.size(); ++i) {
+        int remaining = plans.size() - i;
+        if (remaining > 1 && y + 2 * lineHeight > rect.bottom()) {
+            painter->setPen(dayColor);
+            painter->drawText(QRect(rect.left(), y, rect.width(), lineHeight), Qt::AlignLeft | Qt::AlignVCenter, QString("+%1").arg(remaining));
+            break;
+        }
+        if (y + lineHeight > rect.bottom() + 1) {
+            break;
+        }
+
+        QRect itemRect(rect.left(), y, rect.width(), lineHeight - 1);
+        painter->fillRect(itemRect, Utils::statusBrush(plans.at(i).status));
+        painter->setPen(Qt::black);
+        painter->drawText(itemRect.adjusted(3, 0, -3, 0), Qt::AlignLeft | Qt::AlignVCenter,
+                          metrics.elidedText(plans.at(i).name, Qt::ElideRight, itemRect.width() - 6));
+        y += lineHeight;
+    }
+
+    painter->restore();
+}
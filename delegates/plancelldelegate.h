@@ -0,0 +1,14 @@
+#ifndef PLANCELLDELEGATE_H
+#define PLANCELLDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+class PlanCellDelegate : public QStyledItemDelegate
+{
+public:
+    explicit PlanCellDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // PLANCELLDELEGATE_H
@@ -1,14 +1,16 @@
 #include "plannamedelegate.h"
+#include "../models/planmodel.h"
+#include "../models/tasknamematchmodel.h"
 
-#include <QComboBox>
+#include <QCompleter>
+#include <QLineEdit>
+#include <QTimer>
 
-PlanNameDelegate::PlanNameDelegate(Database* dbManager, QTableView *tableView, QObject *parent)
+PlanNameDelegate::PlanNameDelegate(const TaskNameIndex *taskNameIndex, QTableView *tableView, QObject *parent)
     : QStyledItemDelegate{parent}
-    , m_dbManager(dbManager)
+    , m_taskNameIndex(taskNameIndex)
     , m_tableView(tableView)
-{
-    refreshTaskNames();
-}
+{}
 
 QWidget *PlanNameDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
@@ -19,8 +21,20 @@ QWidget *PlanNameDelegate::createEditor(QWidget *parent, const QStyleOptionViewI
         return nullptr;
     }
     else {
-        QComboBox *editor = new QComboBox(parent);
-        editor->addItems(m_taskNames);
+        QLineEdit *editor = new QLineEdit(parent);
+        editor->setPlaceholderText("输入任务名称或拼音首字母");
+
+        TaskNameMatchModel *matchModel = new TaskNameMatchModel(m_taskNameIndex, editor);
+        QCompleter *completer = new QCompleter(matchModel, editor);
+        completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+        completer->setMaxVisibleItems(15);
+        editor->setCompleter(completer);
+
+        connect(editor, &QLineEdit::textEdited, matchModel, &TaskNameMatchModel::setQuery);
+        QTimer::singleShot(0, editor, [matchModel, completer]() {
+            matchModel->setQuery(QString());
+            completer->complete();
+        });
         return editor;
     }
 }
@@ -28,17 +42,27 @@ QWidget *PlanNameDelegate::createEditor(QWidget *parent, const QStyleOptionViewI
 void PlanNameDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
 {
     QString value = index.model()->data(index, Qt::EditRole).toString();
-    QComboBox *comboBox = static_cast<QComboBox*>(editor);
-    int idx = comboBox->findText(value);
-    if (idx >= 0) {
-        comboBox->setCurrentIndex(idx);
-    }
+    QLineEdit *lineEdit = static_cast<QLineEdit*>(editor);
+    lineEdit->setText(value);
+    lineEdit->selectAll();
 }
 
 void PlanNameDelegate::setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const
 {
-    QComboBox *comboBox = static_cast<QComboBox*>(editor);
-    model->setData(index, comboBox->currentText(), Qt::EditRole);
+    QLineEdit *lineEdit = static_cast<QLineEdit*>(editor);
+    QString text = lineEdit->text().trimmed();
+    if (!m_taskNameIndex->containsName(text)) {
+        return;
+    }
+    // The row is saved against the task's id, set before the name marks it edited
+    const QList<int> ids = m_taskNameIndex->match(text);
+    for (int id : ids) {
+        if (m_taskNameIndex->name(id) == text) {
+            model->setData(index.sibling(index.row(), 0), id, PlanModel::RefIdRole);
+            break;
+        }
+    }
+    model->setData(index, text, Qt::EditRole);
 }
 
 void PlanNameDelegate::updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &index) const
@@ -46,12 +70,3 @@ void PlanNameDelegate::updateEditorGeometry(QWidget *editor, const QStyleOptionV
     Q_UNUSED(index);
     editor->setGeometry(option.rect);
 }
-
-void PlanNameDelegate::refreshTaskNames()
-{
-    m_taskNames.clear();
-    QList<TaskData> tasks = m_dbManager->getTaskByStatus(1);
-    for (const TaskData &task : std::as_const(tasks)) {
-        m_taskNames << task.name;
-    }
-}
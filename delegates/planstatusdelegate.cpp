@@ -17,18 +17,19 @@ QWidget *PlanStatusDelegate::createEditor(QWidget *parent, const QStyleOptionVie
 
 void PlanStatusDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
 {
-    QString value = index.model()->data(index, Qt::EditRole).toString();
+    QVariant value = index.model()->data(index, Utils::StatusRole);
     QComboBox *comboBox = static_cast<QComboBox*>(editor);
-    int idx = comboBox->findText(value);
-    if (idx >= 0) {
-        comboBox->setCurrentIndex(idx);
+    if (value.isValid()) {
+        comboBox->setCurrentIndex(value.toInt());
     }
 }
 
 void PlanStatusDelegate::setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const
 {
     QComboBox *comboBox = static_cast<QComboBox*>(editor);
-    model->setData(index, comboBox->currentText(), Qt::EditRole);
+    PlanStatus status = Utils::planStatusFromInt(comboBox->currentIndex());
+    model->setData(index, static_cast<int>(status), Utils::StatusRole);
+    model->setData(index, Utils::planStatusToString(status), Qt::EditRole);
 }
 
 void PlanStatusDelegate::updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &index) const
@@ -38,11 +39,12 @@ void PlanStatusDelegate::updateEditorGeometry(QWidget *editor, const QStyleOptio
 
 void PlanStatusDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
-    const QMap<QString, QColor>& colorMap = Utils::statusColorMap();
-    QString status = index.data(Qt::DisplayRole).toString();
-    QColor bgColor = colorMap.value(status, option.palette.base().color());
-
-    painter->fillRect(option.rect, bgColor);
+    QVariant status = index.data(Utils::StatusRole);
+    if (status.isValid()) {
+        painter->fillRect(option.rect, Utils::statusBrush(Utils::planStatusFromInt(status.toInt())));
+    } else {
+        painter->fillRect(option.rect, option.palette.base());
+    }
     painter->setPen(Qt::black);
-    painter->drawText(option.rect, Qt::AlignCenter, status);
+    painter->drawText(option.rect, Qt::AlignCenter, index.data(Qt::DisplayRole).toString());
 }
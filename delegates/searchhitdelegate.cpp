@@ -0,0 +1,51 @@
+#include "searchhitdelegate.h"
+
+#include <QPainter>
+
+SearchHitDelegate::SearchHitDelegate(QObject *parent)
+    : QStyledItemDelegate{parent}
+{}
+
+void SearchHitDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+    if (option.state & QStyle::State_Selected) {
+        painter->fillRect(option.rect, option.palette.highlight());
+    }
+
+    const QColor textColor = (option.state & QStyle::State_Selected)
+                                 ? option.palette.highlightedText().color()
+                                 : option.palette.text().color();
+    QColor kindColor = textColor;
+    kindColor.setAlpha(140);
+
+    QRect rect = option.rect.adjusted(4, 0, -4, 0);
+    QFont boldFont = option.font;
+    boldFont.setBold(true);
+    QFontMetrics metrics(option.font);
+    QFontMetrics boldMetrics(boldFont);
+
+    const QString kind = index.data(KindRole).toString();
+    painter->setFont(option.font);
+    painter->setPen(kindColor);
+    painter->drawText(rect, Qt::AlignLeft | Qt::AlignVCenter, kind);
+    rect.setLeft(rect.left() + metrics.horizontalAdvance(kind) + metrics.horizontalAdvance(' ') * 2);
+
+    // Before, match and after are drawn in turn; whatever no longer fits is elided
+    const QString text = index.data(Qt::DisplayRole).toString();
+    const int start = index.data(MatchStartRole).toInt();
+    const int length = index.data(MatchLengthRole).toInt();
+    const QStringList parts = {text.left(start), text.mid(start, length), text.mid(start + length)};
+
+    painter->setPen(textColor);
+    for (int i = 0; i < parts.size() && rect.width() > 0; ++i) {
+        if (parts.at(i).isEmpty()) continue;
+        const QFontMetrics &partMetrics = (i == 1) ? boldMetrics : metrics;
+        painter->setFont(i == 1 ? boldFont : option.font);
+        const QString part = partMetrics.elidedText(parts.at(i), Qt::ElideRight, rect.width());
+        painter->drawText(rect, Qt::AlignLeft | Qt::AlignVCenter, part);
+        rect.setLeft(rect.left() + partMetrics.horizontalAdvance(part));
+    }
+
+    painter->restore();
+}
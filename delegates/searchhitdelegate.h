@@ -0,0 +1,22 @@
+#ifndef SEARCHHITDELEGATE_H
+#define SEARCHHITDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+/**
+ * @brief SearchHitDelegate Draws a search result as a grey kind label followed by
+ *        its snippet, with the matched characters in bold
+ */
+class SearchHitDelegate : public QStyledItemDelegate
+{
+public:
+    static constexpr int KindRole = Qt::UserRole + 2;
+    static constexpr int MatchStartRole = Qt::UserRole + 3;
+    static constexpr int MatchLengthRole = Qt::UserRole + 4;
+
+    explicit SearchHitDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // SEARCHHITDELEGATE_H
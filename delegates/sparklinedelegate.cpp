@@ -0,0 +1,40 @@
+#include "sparklinedelegate.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+SparklineDelegate::SparklineDelegate(int role, QObject *parent)
+    : QStyledItemDelegate{parent}
+    , m_role(role)
+{}
+
+void SparklineDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    if (option.state & QStyle::State_Selected) {
+        painter->fillRect(option.rect, option.palette.highlight());
+    }
+
+    const QList<double> values = index.data(m_role).value<QList<double>>();
+    if (values.size() < 2) {
+        return;
+    }
+
+    // Values are rates in [0, 1]; x spreads the points evenly across the cell
+    QRectF rect = QRectF(option.rect).adjusted(4, 4, -4, -4);
+    QPainterPath path;
+    for (int i = 0; i < values.size(); ++i) {
+        qreal x = rect.left() + rect.width() * i / (values.size() - 1);
+        qreal y = rect.bottom() - rect.height() * qBound(0.0, values.at(i), 1.0);
+        if (i == 0) {
+            path.moveTo(x, y);
+        } else {
+            path.lineTo(x, y);
+        }
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(QPen(option.palette.text().color(), 1.5));
+    painter->drawPath(path);
+    painter->restore();
+}
@@ -0,0 +1,17 @@
+#ifndef SPARKLINEDELEGATE_H
+#define SPARKLINEDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+class SparklineDelegate : public QStyledItemDelegate
+{
+public:
+    explicit SparklineDelegate(int role, QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    int m_role;
+};
+
+#endif // SPARKLINEDELEGATE_H
@@ -0,0 +1,69 @@
+#include "habitevaluator.h"
+#include "database.h"
+#include "habitstats.h"
+
+static const char *kEvaluatorConnection = "habit_evaluator";
+
+// Longest due-day streak that completes a habit
+static const int kCompletionStreak = 30;
+
+HabitEvaluatorWorker::HabitEvaluatorWorker(const QString &dbName, QObject *parent)
+    : DatabaseWorker(dbName, kEvaluatorConnection, parent)
+{}
+
+void HabitEvaluatorWorker::evaluate(const QList<int> &habitIds)
+{
+    const QSet<int> wanted(habitIds.begin(), habitIds.end());
+    QList<HabitData> habits;
+    const QList<HabitData> activeHabits = database()->getHabitByStatus(1);
+    for (const HabitData &habit : activeHabits) {
+        if (wanted.isEmpty() || wanted.contains(habit.id)) {
+            habits.append(habit);
+        }
+    }
+    if (habits.isEmpty()) {
+        return;
+    }
+
+    // Streaks come from the same bitsets as the habit table, so the threshold
+    // matches the streak shown to the user
+    HabitStats stats;
+    stats.rebuild(habits, database()->getHabitCompletions(habitIds));
+    for (const HabitData &habit : std::as_const(habits)) {
+        if (stats.longestStreak(habit.id) >= kCompletionStreak && database()->completeHabit(habit.id)) {
+            emit habitCompleted(habit.id);
+        }
+    }
+}
+
+HabitEvaluator::HabitEvaluator(const QString &dbName, QObject *parent)
+    : QObject{parent}
+{
+    HabitEvaluatorWorker *worker = new HabitEvaluatorWorker(dbName);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &HabitEvaluator::evaluateRequested, worker, &HabitEvaluatorWorker::evaluate);
+    connect(worker, &HabitEvaluatorWorker::habitCompleted, this, &HabitEvaluator::habitCompleted);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+HabitEvaluator::~HabitEvaluator()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void HabitEvaluator::habitHistoryChanged(const QList<int> &habitIds)
+{
+    if (habitIds.isEmpty()) {
+        return;
+    }
+    emit evaluateRequested(habitIds);
+}
+
+void HabitEvaluator::evaluateAll()
+{
+    emit evaluateRequested(QList<int>());
+}
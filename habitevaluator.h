@@ -0,0 +1,49 @@
+#ifndef HABITEVALUATOR_H
+#define HABITEVALUATOR_H
+
+#include "databaseworker.h"
+
+#include <QObject>
+#include <QSet>
+#include <QThread>
+
+/**
+ * @brief HabitEvaluatorWorker Runs habit auto-completion checks on its own
+ *        database connection inside the evaluator thread
+ */
+class HabitEvaluatorWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit HabitEvaluatorWorker(const QString &dbName, QObject *parent = nullptr);
+
+public slots:
+    void evaluate(const QList<int> &habitIds);
+
+signals:
+    void habitCompleted(int habitId);
+};
+
+/**
+ * @brief HabitEvaluator Moves habit auto-completion off the GUI thread; checks
+ *        run when a habit's history changes or as one low-priority full pass
+ */
+class HabitEvaluator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HabitEvaluator(const QString &dbName, QObject *parent = nullptr);
+    ~HabitEvaluator();
+
+    void habitHistoryChanged(const QList<int> &habitIds);
+    void evaluateAll();
+
+signals:
+    void habitCompleted(int habitId);
+    void evaluateRequested(const QList<int> &habitIds);
+
+private:
+    QThread m_thread;
+};
+
+#endif // HABITEVALUATOR_H
@@ -0,0 +1,389 @@
+#include "habitstats.h"
+
+#include <QtAlgorithms>
+
+namespace {
+
+constexpr qsizetype wordsFor(qsizetype days)
+{
+    return (days + 63) >> 6;
+}
+
+constexpr quint64 lowMask(int bits)
+{
+    return bits >= 64 ? ~quint64(0) : (quint64(1) << bits) - 1;
+}
+
+// Bit i of pattern[s] is set when (i + s) % 7 == 0
+std::array<quint64, 7> weekdayPatterns()
+{
+    std::array<quint64, 7> patterns{};
+    for (int s = 0; s < 7; ++s) {
+        for (int i = 0; i < 64; ++i) {
+            if ((i + s) % 7 == 0) {
+                patterns[s] |= quint64(1) << i;
+            }
+        }
+    }
+    return patterns;
+}
+
+} // namespace
+
+HabitStats::HabitStats()
+    : m_lastDate(QDate::currentDate())
+{}
+
+void HabitStats::rebuild(const QList<HabitData> &habits, const QHash<int, QList<QDate>> &completions)
+{
+    m_series.clear();
+    m_lastDate = qMax(m_lastDate, QDate::currentDate());
+
+    for (const HabitData &habit : habits) {
+        Series series;
+        series.createdDate = habit.createdDate.isValid() ? habit.createdDate : m_lastDate;
+        series.schedule = Utils::habitSchedule(habit.target_frequency);
+
+        const QList<QDate> dates = completions.value(habit.id);
+        series.origin = series.createdDate;
+        if (!dates.isEmpty() && dates.first() < series.origin) {
+            series.origin = dates.first();
+        }
+
+        resize(series, qMax<qint64>(0, series.origin.daysTo(m_lastDate) + 1));
+        for (const QDate &date : dates) {
+            qint64 day = series.origin.daysTo(date);
+            if (day < 0 || day >= series.days) continue;
+            quint64 bit = quint64(1) << (day & 63);
+            if (!(series.completed[day >> 6] & bit)) {
+                series.completed[day >> 6] |= bit;
+                series.total++;
+            }
+        }
+
+        recomputeDue(series, 0);
+        m_series.insert(habit.id, std::move(series));
+    }
+}
+
+void HabitStats::addHabit(const HabitData &habit)
+{
+    Series series;
+    series.createdDate = habit.createdDate.isValid() ? habit.createdDate : QDate::currentDate();
+    series.origin = series.createdDate;
+    series.schedule = Utils::habitSchedule(habit.target_frequency);
+    resize(series, qMax<qint64>(0, series.origin.daysTo(m_lastDate) + 1));
+    recomputeDue(series, 0);
+    m_series.insert(habit.id, std::move(series));
+}
+
+void HabitStats::updateHabit(const HabitData &habit)
+{
+    auto it = m_series.find(habit.id);
+    if (it == m_series.end()) {
+        addHabit(habit);
+        return;
+    }
+
+    Series &series = it.value();
+    series.schedule = Utils::habitSchedule(habit.target_frequency);
+    if (habit.createdDate.isValid()) {
+        series.createdDate = habit.createdDate;
+        if (habit.createdDate < series.origin) {
+            rebase(series, habit.createdDate);
+        }
+    }
+    recomputeDue(series, 0);
+}
+
+void HabitStats::removeHabit(int habitId)
+{
+    m_series.remove(habitId);
+}
+
+void HabitStats::setCompleted(int habitId, const QDate &date, bool completed)
+{
+    auto it = m_series.find(habitId);
+    if (it == m_series.end() || !date.isValid()) {
+        return;
+    }
+
+    if (date > m_lastDate) {
+        extendTo(date);
+    }
+    Series &series = it.value();
+    if (date < series.origin) {
+        rebase(series, date);
+        recomputeDue(series, 0);
+    }
+
+    qsizetype day = series.origin.daysTo(date);
+    quint64 bit = quint64(1) << (day & 63);
+    quint64 &word = series.completed[day >> 6];
+    if (bool(word & bit) == completed) {
+        return;
+    }
+    word ^= bit;
+    series.total += completed ? 1 : -1;
+
+    // Only the running counts after the changed word shift; today's edit is O(1)
+    recomputeRanks(series, day >> 6);
+}
+
+void HabitStats::extendTo(const QDate &date)
+{
+    if (!date.isValid() || date <= m_lastDate) {
+        return;
+    }
+    m_lastDate = date;
+    for (Series &series : m_series) {
+        qsizetype oldDays = series.days;
+        qint64 newDays = series.origin.daysTo(date) + 1;
+        if (newDays <= oldDays) continue;
+        resize(series, newDays);
+        recomputeDue(series, oldDays);
+    }
+}
+
+bool HabitStats::contains(int habitId) const
+{
+    return m_series.contains(habitId);
+}
+
+int HabitStats::totalCompletions(int habitId) const
+{
+    auto it = m_series.constFind(habitId);
+    return it != m_series.constEnd() ? it.value().total : 0;
+}
+
+int HabitStats::dueDays(int habitId, const QDate &startDate, const QDate &endDate) const
+{
+    auto it = m_series.constFind(habitId);
+    qsizetype first, last;
+    if (it == m_series.constEnd() || !window(it.value(), startDate, endDate, first, last)) {
+        return 0;
+    }
+    return dueBefore(it.value(), last + 1) - dueBefore(it.value(), first);
+}
+
+int HabitStats::completedDays(int habitId, const QDate &startDate, const QDate &endDate) const
+{
+    auto it = m_series.constFind(habitId);
+    qsizetype first, last;
+    if (it == m_series.constEnd() || !window(it.value(), startDate, endDate, first, last)) {
+        return 0;
+    }
+    return doneBefore(it.value(), last + 1) - doneBefore(it.value(), first);
+}
+
+double HabitStats::completionRate(int habitId, const QDate &startDate, const QDate &endDate) const
+{
+    int due = dueDays(habitId, startDate, endDate);
+    return due > 0 ? static_cast<double>(completedDays(habitId, startDate, endDate)) / due : 0.0;
+}
+
+double HabitStats::completionRate(int habitId, int days) const
+{
+    return completionRate(habitId, m_lastDate.addDays(1 - days), m_lastDate);
+}
+
+QList<double> HabitStats::rollingRates(int habitId, int window, int points) const
+{
+    QList<double> rates;
+    if (!m_series.contains(habitId) || window <= 0 || points <= 0) {
+        return rates;
+    }
+
+    rates.reserve(points);
+    for (int i = points - 1; i >= 0; --i) {
+        QDate endDate = m_lastDate.addDays(-i);
+        rates.append(completionRate(habitId, endDate.addDays(1 - window), endDate));
+    }
+    return rates;
+}
+
+int HabitStats::longestStreak(int habitId) const
+{
+    auto it = m_series.constFind(habitId);
+    if (it == m_series.constEnd()) {
+        return 0;
+    }
+
+    // Between two consecutive misses every due day was completed
+    const Series &series = it.value();
+    const qsizetype words = wordsFor(series.days);
+    qsizetype previousMiss = -1;
+    int longest = 0;
+    for (qsizetype w = 0; w < words; ++w) {
+        for (quint64 misses = missWord(series, w); misses; misses &= misses - 1) {
+            qsizetype miss = (w << 6) + qCountTrailingZeroBits(misses);
+            longest = qMax(longest, dueBefore(series, miss) - dueBefore(series, previousMiss + 1));
+            previousMiss = miss;
+        }
+    }
+    // An open last day is not a miss, but not yet part of the streak either
+    return qMax(longest, doneBefore(series, series.days) - doneBefore(series, previousMiss + 1));
+}
+
+int HabitStats::currentStreak(int habitId) const
+{
+    auto it = m_series.constFind(habitId);
+    if (it == m_series.constEnd()) {
+        return 0;
+    }
+
+    const Series &series = it.value();
+    qsizetype lastMiss = -1;
+    for (qsizetype w = wordsFor(series.days) - 1; w >= 0; --w) {
+        quint64 misses = missWord(series, w);
+        if (misses) {
+            lastMiss = (w << 6) + 63 - qCountLeadingZeroBits(misses);
+            break;
+        }
+    }
+    return doneBefore(series, series.days) - doneBefore(series, lastMiss + 1);
+}
+
+int HabitStats::longestGap(int habitId) const
+{
+    auto it = m_series.constFind(habitId);
+    if (it == m_series.constEnd()) {
+        return 0;
+    }
+
+    const Series &series = it.value();
+    const qsizetype words = wordsFor(series.days);
+    qsizetype previous = -1;
+    qsizetype longest = 0;
+    for (qsizetype w = 0; w < words; ++w) {
+        for (quint64 bits = series.completed[w]; bits; bits &= bits - 1) {
+            qsizetype day = (w << 6) + qCountTrailingZeroBits(bits);
+            if (previous >= 0) {
+                longest = qMax(longest, day - previous - 1);
+            }
+            previous = day;
+        }
+    }
+    if (previous < 0) {
+        return static_cast<int>(series.days);
+    }
+    return static_cast<int>(qMax(longest, series.days - 1 - previous));
+}
+
+std::array<int, 7> HabitStats::weekdayCompletions(int habitId) const
+{
+    std::array<int, 7> counts{};
+    auto it = m_series.constFind(habitId);
+    if (it == m_series.constEnd()) {
+        return counts;
+    }
+
+    static const std::array<quint64, 7> patterns = weekdayPatterns();
+    const Series &series = it.value();
+    const int originWeekday = series.origin.dayOfWeek() - 1;
+    const qsizetype words = wordsFor(series.days);
+    for (qsizetype w = 0; w < words; ++w) {
+        const quint64 bits = series.completed[w];
+        if (!bits) continue;
+        // Day (w * 64 + i) falls on weekday d when (originWeekday + w * 64 + i - d) % 7 == 0
+        const int phase = static_cast<int>((originWeekday + (w << 6)) % 7);
+        for (int d = 0; d < 7; ++d) {
+            counts[d] += qPopulationCount(bits & patterns[(phase - d + 7) % 7]);
+        }
+    }
+    return counts;
+}
+
+void HabitStats::resize(Series &series, qsizetype days)
+{
+    const qsizetype words = wordsFor(days);
+    series.days = days;
+    series.completed.resize(words, 0);
+    series.due.resize(words, 0);
+    series.dueRank.resize(words + 1, 0);
+    series.doneRank.resize(words + 1, 0);
+
+    // Keep bits past the last day clear so whole-word popcounts stay exact
+    if (days & 63) {
+        series.completed[words - 1] &= lowMask(days & 63);
+    }
+}
+
+void HabitStats::rebase(Series &series, const QDate &origin)
+{
+    const qsizetype shift = origin.daysTo(series.origin);
+    std::vector<quint64> completed = std::move(series.completed);
+    const qsizetype oldWords = wordsFor(series.days);
+
+    series.completed.clear();
+    series.due.clear();
+    series.origin = origin;
+    resize(series, series.days + shift);
+    for (qsizetype w = 0; w < oldWords; ++w) {
+        for (quint64 bits = completed[w]; bits; bits &= bits - 1) {
+            qsizetype day = (w << 6) + qCountTrailingZeroBits(bits) + shift;
+            series.completed[day >> 6] |= quint64(1) << (day & 63);
+        }
+    }
+}
+
+void HabitStats::recomputeDue(Series &series, qsizetype fromDay)
+{
+    QDate date = series.origin.addDays(fromDay);
+    for (qsizetype day = fromDay; day < series.days; ++day, date = date.addDays(1)) {
+        quint64 bit = quint64(1) << (day & 63);
+        if (series.schedule.isDue(series.createdDate, date)) {
+            series.due[day >> 6] |= bit;
+        } else {
+            series.due[day >> 6] &= ~bit;
+        }
+    }
+    recomputeRanks(series, fromDay >> 6);
+}
+
+void HabitStats::recomputeRanks(Series &series, qsizetype fromWord)
+{
+    const qsizetype words = wordsFor(series.days);
+    for (qsizetype w = fromWord; w < words; ++w) {
+        series.dueRank[w + 1] = series.dueRank[w] + qPopulationCount(series.due[w]);
+        series.doneRank[w + 1] = series.doneRank[w] + qPopulationCount(series.due[w] & series.completed[w]);
+    }
+}
+
+int HabitStats::dueBefore(const Series &series, qsizetype day)
+{
+    const qsizetype w = day >> 6;
+    int count = series.dueRank[w];
+    if (day & 63) {
+        count += qPopulationCount(series.due[w] & lowMask(day & 63));
+    }
+    return count;
+}
+
+int HabitStats::doneBefore(const Series &series, qsizetype day)
+{
+    const qsizetype w = day >> 6;
+    int count = series.doneRank[w];
+    if (day & 63) {
+        count += qPopulationCount(series.due[w] & series.completed[w] & lowMask(day & 63));
+    }
+    return count;
+}
+
+quint64 HabitStats::missWord(const Series &series, qsizetype word)
+{
+    quint64 misses = series.due[word] & ~series.completed[word];
+    // The last day is still open, so it never counts as a miss
+    const qsizetype lastDay = series.days - 1;
+    if (lastDay >= 0 && (lastDay >> 6) == word) {
+        misses &= ~(quint64(1) << (lastDay & 63));
+    }
+    return misses;
+}
+
+bool HabitStats::window(const Series &series, const QDate &startDate, const QDate &endDate, qsizetype &first, qsizetype &last) const
+{
+    first = qMax<qint64>(0, series.origin.daysTo(startDate));
+    last = qMin<qint64>(series.days - 1, series.origin.daysTo(endDate));
+    return series.days > 0 && first <= last;
+}
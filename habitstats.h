@@ -0,0 +1,89 @@
+#ifndef HABITSTATS_H
+#define HABITSTATS_H
+
+#include "database.h"
+
+#include <QHash>
+#include <array>
+#include <vector>
+
+/**
+ * @brief HabitStats Columnar in-memory store of habit history
+ *
+ * Each habit keeps one packed bitset of completed days and one of due days,
+ * starting at the habit's first day, plus per-word running counts. Window
+ * counts are a rank lookup and one popcount; streaks and gaps walk only the
+ * set bits with count-trailing/leading-zeros. Built once from the completion
+ * history and extended day by day, so the habit dashboard never goes back
+ * to SQL.
+ */
+class HabitStats
+{
+public:
+    HabitStats();
+
+    void rebuild(const QList<HabitData> &habits, const QHash<int, QList<QDate>> &completions);
+    void addHabit(const HabitData &habit);
+    void updateHabit(const HabitData &habit);
+    void removeHabit(int habitId);
+    void setCompleted(int habitId, const QDate &date, bool completed);
+    void extendTo(const QDate &date);
+
+    bool contains(int habitId) const;
+    int totalCompletions(int habitId) const;
+    int dueDays(int habitId, const QDate &startDate, const QDate &endDate) const;
+    int completedDays(int habitId, const QDate &startDate, const QDate &endDate) const;
+    double completionRate(int habitId, const QDate &startDate, const QDate &endDate) const;
+    double completionRate(int habitId, int days) const;
+
+    /**
+     * @brief rollingRates Completion rate of the trailing `window` days, for each
+     *        of the last `points` days ending at the last extended day
+     */
+    QList<double> rollingRates(int habitId, int window, int points) const;
+
+    /**
+     * @brief longestStreak Most consecutive due days completed; an unfinished
+     *        last day (today) neither breaks the streak nor counts towards it
+     */
+    int longestStreak(int habitId) const;
+    int currentStreak(int habitId) const;
+
+    /**
+     * @brief longestGap Most consecutive days without a completion, counted from
+     *        the first completion through the last extended day
+     */
+    int longestGap(int habitId) const;
+
+    /**
+     * @brief weekdayCompletions Completed days per weekday, index 0 = Monday
+     */
+    std::array<int, 7> weekdayCompletions(int habitId) const;
+
+private:
+    struct Series {
+        QDate origin;
+        QDate createdDate;
+        HabitSchedule schedule;
+        qsizetype days = 0;
+        std::vector<quint64> completed; // bit per day since origin
+        std::vector<quint64> due;       // bit per day since origin
+        std::vector<int> dueRank;       // due days before each word
+        std::vector<int> doneRank;      // completed due days before each word
+        int total = 0;
+    };
+
+    QHash<int, Series> m_series;
+    QDate m_lastDate;
+
+    static void resize(Series &series, qsizetype days);
+    static void rebase(Series &series, const QDate &origin);
+    static void recomputeDue(Series &series, qsizetype fromDay);
+    static void recomputeRanks(Series &series, qsizetype fromWord);
+    static int dueBefore(const Series &series, qsizetype day);
+    static int doneBefore(const Series &series, qsizetype day);
+    static quint64 missWord(const Series &series, qsizetype word);
+    bool window(const Series &series, const QDate &startDate, const QDate &endDate, qsizetype &first, qsizetype &last) const;
+};
+
+#endif // HABITSTATS_H
@@ -1,11 +1,30 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QSettings>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
-    MainWindow w;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("计划管理软件");
+    parser.addHelpOption();
+    QCommandLineOption databaseOption({"d", "database"}, "数据库文件路径", "path");
+    QCommandLineOption memoryOption({"m", "in-memory"}, "在内存中运行，定时写回磁盘");
+    parser.addOption(databaseOption);
+    parser.addOption(memoryOption);
+    parser.process(a);
+
+    // Command line wins over config.ini
+    QSettings settings("config.ini", QSettings::IniFormat);
+    QString dbPath = parser.isSet(databaseOption)
+                         ? parser.value(databaseOption)
+                         : settings.value("storage/path", "D:/Collection/Sqlite/PlanManage.db").toString();
+    bool inMemory = parser.isSet(memoryOption) || settings.value("storage/in_memory", false).toBool();
+
+    MainWindow w(dbPath, inMemory);
     w.show();
     return a.exec();
 }
@@ -2,6 +2,10 @@
 #include "ui_mainwindow.h"
 #include "addtaskdialog.h"
 #include "addhabitdialog.h"
+#include "plannerdialog.h"
+#include "searchdialog.h"
+#include "rollforwarddialog.h"
+#include "periodcalendar.h"
 #include "utils.h"
 #include "delegates/datedelegate.h"
 #include "delegates/habitfrequencydelegate.h"
@@ -9,6 +13,7 @@
 #include "delegates/habitstatusdelegate.h"
 #include "delegates/planstatusdelegate.h"
 #include "delegates/plannamedelegate.h"
+#include "delegates/sparklinedelegate.h"
 
 #include <QDate>
 #include <QFile>
@@ -22,16 +27,43 @@
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QtMath>
+#include <algorithm>
 #include <limits>
 #include <QActionGroup>
 #include <QDir>
 #include <QFileInfoList>
 #include <QSettings>
+#include <QSignalBlocker>
+#include <QCloseEvent>
+#include <QStatusBar>
+#include <QMenu>
+#include <QInputDialog>
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(const QString &dbPath, bool inMemory, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_dbManager("D:/Collection/Sqlite/PlanManage.db")
+    , m_dbPath(inMemory ? Database::memoryName(dbPath) : dbPath)
+    , m_journalPath(AutoSaver::journalPath(dbPath))
+    , m_dbManager(m_dbPath)
+    , m_habitEvaluator(nullptr)
+    , m_planScheduler(nullptr)
+    , m_taskSweeper(nullptr)
+    , m_midnightTimer(nullptr)
+    , m_reminderScheduler(nullptr)
+    , m_trayIcon(nullptr)
+    , m_archiver(nullptr)
+    , m_storageFlusher(nullptr)
+    , m_reviewLoader(nullptr)
+    , m_searcher(nullptr)
+    , m_autoSaver(nullptr)
+    , m_autoSaveTimer(nullptr)
+    , m_journalTimer(nullptr)
+    , m_saveStateLabel(nullptr)
+    , m_saveQueued(false)
+    , m_saveFailed(false)
+    , m_loadingEditors(false)
+    , m_reviewRequest(0)
+    , m_tagFilterLabel(nullptr)
     , m_tooltip(nullptr)
 {
     ui->setupUi(this);
@@ -43,6 +75,9 @@ MainWindow::MainWindow(QWidget *parent)
     initChart();
     init();
     createThemeMenu();
+    createViewMenu();
+    createPlanMenu();
+    createTagMenu();
     QSettings settings("config.ini", QSettings::IniFormat);
     QString lastTheme = settings.value("theme").toString();
     bool found = false;
@@ -67,44 +102,219 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    commitEdits();
+    if (m_dbManager.isInMemory()) {
+        // Stop every background writer first so the final snapshot is complete
+        delete m_autoSaver;
+        delete m_storageFlusher;
+        delete m_searcher;
+        delete m_reviewLoader;
+        delete m_archiver;
+        delete m_taskSweeper;
+        delete m_planScheduler;
+        delete m_habitEvaluator;
+        m_dbManager.flushToDisk();
+    }
     delete ui;
 }
 
 void MainWindow::init()
 {
-    m_modelTask = new TaskModel(this);
+    m_modelTask = new TaskModel(&m_dbManager, this);
     m_modelHabit = new HabitModel(this);
     m_modelPlan = new PlanModel(this);
 
-    m_modelTask->setHorizontalHeaderLabels({"ID", "任务名称", "创建日期", "截止日期", "完成日期", "完成状态"});
-    m_modelHabit->setHorizontalHeaderLabels({"ID", "习惯名称", "创建日期", "习惯频率", "总次数", "连续次数", "完成状态"});
+    m_modelTask->setHorizontalHeaderLabels({"ID", "任务名称", "创建日期", "截止日期", "完成日期", "完成状态", "进度"});
+    m_modelHabit->setHorizontalHeaderLabels({"ID", "习惯名称", "创建日期", "习惯频率", "总次数", "连续次数", "完成状态", "近7日", "近30日", "近一年", "趋势"});
     m_modelPlan->setHorizontalHeaderLabels({"类型", "计划名称", "完成状态"});
 
-    ui->tableView_task->setModel(m_modelTask);
+    ui->treeView_task->setModel(m_modelTask);
     ui->tableView_habit->setModel(m_modelHabit);
     ui->tableView_plan->setModel(m_modelPlan);
 
 
-    ui->tableView_task->setWordWrap(true);
+    ui->treeView_task->setWordWrap(true);
     ui->tableView_habit->setWordWrap(true);
     ui->tableView_plan->setWordWrap(true);
 
-    ui->tableView_task->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
     ui->tableView_habit->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
     ui->tableView_plan->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
 
-    ui->tableView_task->setItemDelegateForColumn(3, new DateDelegate(ui->tableView_task));
-    ui->tableView_task->setItemDelegateForColumn(5, new TaskStatusDelegate(ui->tableView_task));
+    ui->treeView_task->setItemDelegateForColumn(3, new DateDelegate(ui->treeView_task));
+    ui->treeView_task->setItemDelegateForColumn(5, new TaskStatusDelegate(ui->treeView_task));
     ui->tableView_habit->setItemDelegateForColumn(2, new DateDelegate(ui->tableView_habit));
     ui->tableView_habit->setItemDelegateForColumn(3, new HabitFrequencyDelegate(ui->tableView_habit));
     ui->tableView_habit->setItemDelegateForColumn(6, new HabitStatusDelegate(ui->tableView_habit));
-    PlanNameDelegate *planNameDelegate = new PlanNameDelegate(&m_dbManager, ui->tableView_plan, this);
+    ui->tableView_habit->setItemDelegateForColumn(HabitModel::TrendColumn, new SparklineDelegate(HabitModel::TrendRole, ui->tableView_habit));
+
+    // Attach before the first history read so streaks see archived rows too
+    QSettings settings("config.ini", QSettings::IniFormat);
+    int archiveCutoffDays = settings.value("archive/cutoff_days", 365).toInt();
+    if (archiveCutoffDays > 0) {
+        m_dbManager.attachArchive();
+    }
+    if (settings.value("storage/shard_by_year", false).toBool()) {
+        m_dbManager.enableYearShards();
+    }
+    // Edits journaled by a session that ended before saving them
+    AutoSaver::recover(m_dbManager, m_journalPath);
+    m_habitStats.rebuild(m_dbManager.getHabitByStatus(0), m_dbManager.getHabitCompletions());
+
+    const QList<TaskData> openTasks = m_dbManager.getTaskByStatus(1);
+    for (const TaskData &task : openTasks) {
+        m_taskNameIndex.insert(task.id, task.name);
+    }
+
+    // Tag bitmaps: every task and habit, then one bit per tag link
+    const QHash<int, QString> tags = m_dbManager.getTags();
+    for (auto it = tags.cbegin(); it != tags.cend(); ++it) {
+        m_tagIndex.addTag(it.key(), it.value());
+    }
+    for (TagKind kind : {TagKind::Task, TagKind::Habit}) {
+        const QList<int> ids = m_dbManager.getTaggableIds(kind);
+        for (int id : ids) {
+            m_tagIndex.addRow(kind, id);
+        }
+        const QList<QPair<int, int>> links = m_dbManager.getTagLinks(kind);
+        for (const QPair<int, int> &link : links) {
+            m_tagIndex.tag(kind, link.first, link.second);
+        }
+    }
+    PlanNameDelegate *planNameDelegate = new PlanNameDelegate(&m_taskNameIndex, ui->tableView_plan, this);
     ui->tableView_plan->setItemDelegateForColumn(1, planNameDelegate);
     ui->tableView_plan->setItemDelegateForColumn(2, new PlanStatusDelegate(ui->tableView_plan));
+    ui->tableView_plan->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui->tableView_plan->setDragDropMode(QAbstractItemView::InternalMove);
+    ui->tableView_plan->setDefaultDropAction(Qt::MoveAction);
+    ui->tableView_plan->setDragDropOverwriteMode(false);
+    ui->tableView_plan->setDropIndicatorShown(true);
+
+    m_habitEvaluator = new HabitEvaluator(m_dbPath, this);
+    connect(m_habitEvaluator, &HabitEvaluator::habitCompleted, this, [this](int habitId) {
+        m_modelHabit->setHabitStatus(habitId, HabitStatus::Completed);
+        m_reminderScheduler->removeHabits({habitId});
+    });
+
+    m_planScheduler = new PlanScheduler(m_dbPath, settings.value("plan/materialize_days", 14).toInt(), this);
+    m_planScheduler->setRollForwardDays(settings.value("plan/roll_forward_days", 0).toInt());
+    connect(m_planScheduler, &PlanScheduler::plansMaterialized, this, [this](const QDate &startDate, const QDate &endDate) {
+        QDate selectedDate = ui->calendarWidget->selectedDate();
+        if (selectedDate >= startDate && selectedDate <= endDate) {
+            on_calendarWidget_clicked(selectedDate);
+        }
+    });
+
+    m_taskSweeper = new TaskSweeper(m_dbPath, this);
+    connect(m_taskSweeper, &TaskSweeper::tasksOverdue, this, [this](const QList<int> &taskIds) {
+        for (int taskId : taskIds) {
+            m_taskNameIndex.remove(taskId);
+        }
+        m_modelTask->setTaskStatus(taskIds, TaskStatus::Unfinished, QDate());
+        m_reminderScheduler->removeTasks(taskIds);
+    });
+
+    // Both jobs run again each new day, the scheduler first so today's habit rows exist
+    m_midnightTimer = new MidnightTimer(this);
+    connect(m_midnightTimer, &MidnightTimer::dayStarted, m_planScheduler, &PlanScheduler::start);
+    connect(m_midnightTimer, &MidnightTimer::dayStarted, m_taskSweeper, &TaskSweeper::start);
+
+    // Reminders are scheduled from the rows loaded here and kept current by every
+    // later edit; nothing is polled
+    if (QSystemTrayIcon::isSystemTrayAvailable()) {
+        m_trayIcon = new QSystemTrayIcon(windowIcon(), this);
+        m_trayIcon->setToolTip(windowTitle());
+        connect(m_trayIcon, &QSystemTrayIcon::activated, this, [this](QSystemTrayIcon::ActivationReason reason) {
+            if (reason != QSystemTrayIcon::Trigger) return;
+            showMaximized();
+            raise();
+            activateWindow();
+        });
+        m_trayIcon->show();
+    }
+    QTime taskReminderTime = QTime::fromString(settings.value("reminder/task_time", "09:00").toString(), "HH:mm");
+    QTime habitReminderTime = QTime::fromString(settings.value("reminder/habit_time", "20:00").toString(), "HH:mm");
+    m_reminderScheduler = new ReminderScheduler(settings.value("reminder/task_lead_days", 1).toInt(),
+                                                taskReminderTime.isValid() ? taskReminderTime : QTime(9, 0),
+                                                habitReminderTime.isValid() ? habitReminderTime : QTime(20, 0),
+                                                this);
+    connect(m_reminderScheduler, &ReminderScheduler::remindersDue, this, &MainWindow::showReminders);
+    m_reminderScheduler->updateTasks(openTasks);
+    m_reminderScheduler->updateHabits(m_dbManager.getHabitByStatus(1));
+
+    m_reviewLoader = new ReviewLoader(m_dbPath, this);
+    connect(m_reviewLoader, &ReviewLoader::loaded, this, [this](int requestId, const QString &reflection, const QString &summary) {
+        if (requestId != m_reviewRequest) return;
+        m_loadingEditors = true;
+        ui->textEdit_reflection->setText(reflection);
+        ui->textEdit_summary->setText(summary);
+        m_loadingEditors = false;
+        ui->textEdit_reflection->document()->setModified(false);
+        ui->textEdit_summary->document()->setModified(false);
+        ui->textEdit_reflection->setReadOnly(false);
+        ui->textEdit_summary->setReadOnly(false);
+        m_reviewRequest = 0;
+    });
+
+    m_searcher = new Searcher(m_dbPath, this);
+
+    m_autoSaver = new AutoSaver(m_dbPath, m_journalPath, this);
+    connect(m_autoSaver, &AutoSaver::saved, this, &MainWindow::onEditsSaved);
+
+    // Bursts of edits are coalesced into one save once input pauses; 0 saves only on request
+    m_autoSaveTimer = new QTimer(this);
+    m_autoSaveTimer->setSingleShot(true);
+    m_autoSaveTimer->setInterval(settings.value("autosave/idle_ms", 2000).toInt());
+    connect(m_autoSaveTimer, &QTimer::timeout, this, &MainWindow::saveData);
+
+    m_journalTimer = new QTimer(this);
+    m_journalTimer->setSingleShot(true);
+    m_journalTimer->setInterval(500);
+    connect(m_journalTimer, &QTimer::timeout, this, &MainWindow::journalEdits);
+
+    m_saveStateLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_saveStateLabel);
+    m_tagFilterLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_tagFilterLabel);
+
+    connect(m_modelPlan, &PlanModel::dataChanged, this, &MainWindow::onEditsChanged);
+    connect(ui->textEdit_reflection, &QTextEdit::textChanged, this, &MainWindow::onEditsChanged);
+    connect(ui->textEdit_summary, &QTextEdit::textChanged, this, &MainWindow::onEditsChanged);
+
+    m_archiver = new Archiver(m_dbPath, archiveCutoffDays, this);
+    connect(m_archiver, &Archiver::plansArchiving, this, [this] {
+        m_dbManager.refreshArchiveState();
+    });
+    connect(m_archiver, &Archiver::archived, this, [this](int plans, int tasks) {
+        Q_UNUSED(tasks);
+        if (plans > 0) {
+            m_dbManager.refreshArchiveState();
+        }
+    });
 
     connect(m_modelTask, &TaskModel::dataChanged, this, &MainWindow::onTableViewTaskDataChanged);
+    connect(m_modelTask, &TaskModel::parentChangeRequested, this, &MainWindow::moveTasks);
+    ui->treeView_task->header()->setSectionsClickable(true);
+    ui->treeView_task->header()->setSortIndicatorShown(true);
+    ui->treeView_task->header()->setSortIndicator(0, Qt::AscendingOrder);
+    connect(ui->treeView_task->header(), &QHeaderView::sectionClicked, this, &MainWindow::onTableViewTaskHeaderClicked);
+
+    // The id column is hidden, so the branches are drawn next to the name.
+    // Rows dropped onto a task become its subtasks.
+    ui->treeView_task->setTreePosition(1);
+    ui->treeView_task->setDragDropMode(QAbstractItemView::InternalMove);
+    ui->treeView_task->setDefaultDropAction(Qt::MoveAction);
     connect(m_modelHabit, &HabitModel::dataChanged, this, &MainWindow::onTableViewHabitDataChanged);
 
+    // Rows are selected whole; the context menu acts on every selected row at once
+    const QList<QAbstractItemView*> listViews = {ui->treeView_task, ui->tableView_habit};
+    for (QAbstractItemView *view : listViews) {
+        view->setSelectionBehavior(QAbstractItemView::SelectRows);
+        view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        view->setContextMenuPolicy(Qt::CustomContextMenu);
+    }
+    connect(ui->treeView_task, &QTreeView::customContextMenuRequested, this, &MainWindow::onTableViewTaskContextMenu);
+    connect(ui->tableView_habit, &QTableView::customContextMenuRequested, this, &MainWindow::onTableViewHabitContextMenu);
+
     QStringList taskStatuses = Utils::taskStatusList();
     taskStatuses.insert(0, "全部");
     ui->comboBox_task->addItems(taskStatuses);
@@ -117,18 +327,29 @@ void MainWindow::init()
     ui->calendarWidget->clicked(QDate::currentDate());
 
     adjustTableWidth(ui->tableView_plan);
-    adjustTableWidth(ui->tableView_task);
+    adjustTableWidth(ui->treeView_task);
     adjustTableWidth(ui->tableView_habit);
 
     ui->tableView_plan->viewport()->installEventFilter(this);
-    ui->tableView_task->viewport()->installEventFilter(this);
+    ui->treeView_task->viewport()->installEventFilter(this);
     ui->tableView_habit->viewport()->installEventFilter(this);
 
     ui->tableView_habit->setColumnHidden(0, true);
-    ui->tableView_task->setColumnHidden(0, true);
+    ui->treeView_task->setColumnHidden(0, true);
 
     ui->dateEdit_period_start->setDate(QDate::currentDate());
     ui->dateEdit_period_end->setDate(QDate::currentDate());
+
+    m_habitEvaluator->evaluateAll();
+    m_planScheduler->start();
+    m_taskSweeper->start();
+    m_midnightTimer->start();
+    m_archiver->start();
+
+    if (m_dbManager.isInMemory()) {
+        m_storageFlusher = new StorageFlusher(m_dbPath, settings.value("storage/flush_seconds", 60).toInt(), this);
+        m_storageFlusher->start();
+    }
 }
 
 void MainWindow::initChart()
@@ -217,6 +438,281 @@ void MainWindow::createThemeMenu()
 }
 
 
+void MainWindow::createViewMenu()
+{
+    QMenu *viewMenu = menuBar()->addMenu(tr("视图"));
+
+    QAction *weekAction = viewMenu->addAction(tr("周视图"));
+    connect(weekAction, &QAction::triggered, this, [this]() {
+        openPlanner(PlanRangeModel::Week);
+    });
+
+    QAction *monthAction = viewMenu->addAction(tr("月视图"));
+    connect(monthAction, &QAction::triggered, this, [this]() {
+        openPlanner(PlanRangeModel::Month);
+    });
+
+    viewMenu->addSeparator();
+    QAction *searchAction = viewMenu->addAction(tr("搜索"));
+    searchAction->setShortcut(QKeySequence::Find);
+    connect(searchAction, &QAction::triggered, this, &MainWindow::openSearch);
+}
+
+
+void MainWindow::createPlanMenu()
+{
+    QMenu *planMenu = menuBar()->addMenu(tr("计划"));
+
+    QAction *previousDayAction = planMenu->addAction(tr("顺延前一日未完成任务"));
+    connect(previousDayAction, &QAction::triggered, this, [this]() {
+        QDate date = ui->calendarWidget->selectedDate();
+        rollForwardPlans(date.addDays(-1), date.addDays(-1), date);
+    });
+
+    QAction *rangeAction = planMenu->addAction(tr("顺延区间未完成任务..."));
+    connect(rangeAction, &QAction::triggered, this, [this]() {
+        RollForwardDialog dialog(ui->calendarWidget->selectedDate(), this);
+        if (dialog.exec() == QDialog::Accepted) {
+            rollForwardPlans(dialog.getStartDate(), dialog.getEndDate(), dialog.getTargetDate());
+        }
+    });
+}
+
+
+void MainWindow::createTagMenu()
+{
+    QMenu *tagMenu = menuBar()->addMenu(tr("标签"));
+
+    QAction *filterAction = tagMenu->addAction(tr("按标签筛选..."));
+    connect(filterAction, &QAction::triggered, this, [this]() {
+        bool ok = false;
+        QString expression = QInputDialog::getText(this, "按标签筛选",
+                                                   "标签表达式（空格为且，| 为或，! 为非，可用括号）:",
+                                                   QLineEdit::Normal, m_tagFilter, &ok);
+        if (ok) {
+            setTagFilter(expression);
+        }
+    });
+
+    QAction *clearAction = tagMenu->addAction(tr("清除标签筛选"));
+    connect(clearAction, &QAction::triggered, this, [this]() {
+        setTagFilter(QString());
+    });
+}
+
+
+bool MainWindow::evaluateTagFilter(const QString &expression)
+{
+    const QString filter = expression.trimmed();
+    if (!filter.isEmpty()) {
+        QString error;
+        TagBitmap tasks = m_tagIndex.evaluate(TagKind::Task, filter, &error);
+        TagBitmap habits = m_tagIndex.evaluate(TagKind::Habit, filter, &error);
+        if (!error.isEmpty()) {
+            statusBar()->showMessage(QString("标签筛选无效: %1").arg(error), 5000);
+            return false;
+        }
+        // Task pages are read in SQLite, so the matched ids are handed to the connection
+        if (!m_dbManager.setTaskTagFilter(tasks.toList())) {
+            statusBar()->showMessage("设置标签筛选失败", 5000);
+            return false;
+        }
+        m_taskTagFilter = tasks;
+        m_habitTagFilter = habits;
+    }
+
+    m_tagFilter = filter;
+    m_tagFilterLabel->setText(filter.isEmpty() ? QString() : QString("标签: %1").arg(filter));
+    return true;
+}
+
+
+void MainWindow::setTagFilter(const QString &expression)
+{
+    if (!evaluateTagFilter(expression)) return;
+
+    on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
+    on_comboBox_habit_currentIndexChanged(ui->comboBox_habit->currentIndex());
+    updatePlanChart(ui->calendarWidget->selectedDate());
+}
+
+
+PlanFilter MainWindow::tagPlanFilter() const
+{
+    if (m_tagFilter.isEmpty()) {
+        return PlanFilter();
+    }
+    // Plan rows carry the tags of their task or habit
+    return [this](int taskId, int habitId) {
+        return taskId > 0 ? m_taskTagFilter.contains(taskId) : m_habitTagFilter.contains(habitId);
+    };
+}
+
+
+void MainWindow::addTagMenu(QMenu *menu, TagKind kind, const QList<int> &ids)
+{
+    QMenu *tagMenu = menu->addMenu("标签");
+    const QStringList names = m_tagIndex.tagNames();
+    for (const QString &name : names) {
+        int tagId = m_tagIndex.tagId(name);
+        // Checked when every selected row has the tag; triggering sets or clears it on all of them
+        bool tagged = std::all_of(ids.cbegin(), ids.cend(), [this, kind, tagId](int id) {
+            return m_tagIndex.hasTag(kind, tagId, id);
+        });
+        QAction *action = tagMenu->addAction(name);
+        action->setCheckable(true);
+        action->setChecked(tagged);
+        connect(action, &QAction::triggered, this, [this, kind, tagId, ids, tagged]() {
+            setTagged(kind, tagId, ids, !tagged);
+        });
+    }
+
+    if (!names.isEmpty()) {
+        tagMenu->addSeparator();
+    }
+    connect(tagMenu->addAction("新建标签..."), &QAction::triggered, this, [this, kind, ids]() {
+        bool ok = false;
+        QString name = QInputDialog::getText(this, "新建标签", "标签名称:", QLineEdit::Normal, QString(), &ok).trimmed();
+        if (!ok || name.isEmpty()) return;
+        if (!TagIndex::isValidName(name)) {
+            statusBar()->showMessage("标签名称不能包含空格、| , & ! ( )，也不能以 - 开头", 5000);
+            return;
+        }
+
+        int tagId = m_dbManager.addTag(name);
+        if (tagId <= 0) {
+            statusBar()->showMessage("添加标签失败", 5000);
+            return;
+        }
+        m_tagIndex.addTag(tagId, name);
+        setTagged(kind, tagId, ids, true);
+    });
+}
+
+
+void MainWindow::setTagged(TagKind kind, int tagId, const QList<int> &ids, bool tagged)
+{
+    if (!m_dbManager.setTagged(kind, tagId, ids, tagged)) {
+        statusBar()->showMessage("更新标签失败", 5000);
+        return;
+    }
+    for (int id : ids) {
+        if (tagged) {
+            m_tagIndex.tag(kind, tagId, id);
+        } else {
+            m_tagIndex.untag(kind, tagId, id);
+        }
+    }
+
+    if (!m_tagFilter.isEmpty()) {
+        setTagFilter(m_tagFilter);
+    }
+}
+
+
+void MainWindow::rollForwardPlans(const QDate &startDate, const QDate &endDate, const QDate &targetDate)
+{
+    // Pending edits of the shown day are written first so the copies rank after them
+    saveData();
+    runAfterSaves([this, startDate, endDate, targetDate] {
+        int inserted = m_dbManager.rollForwardPlans(startDate, endDate, targetDate);
+        if (inserted < 0) {
+            statusBar()->showMessage("顺延未完成任务失败", 5000);
+            return;
+        }
+
+        statusBar()->showMessage(QString("已顺延 %1 项任务").arg(inserted), 5000);
+        if (inserted > 0 && ui->calendarWidget->selectedDate() == targetDate) {
+            on_calendarWidget_clicked(targetDate);
+        }
+    });
+}
+
+
+void MainWindow::openPlanner(PlanRangeModel::Mode mode)
+{
+    PlannerDialog *dialog = new PlannerDialog(&m_dbManager, mode, ui->calendarWidget->selectedDate(), this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, &PlannerDialog::dateActivated, this, [this](const QDate &date) {
+        ui->calendarWidget->setSelectedDate(date);
+        on_calendarWidget_clicked(date);
+    });
+    dialog->show();
+}
+
+
+void MainWindow::openSearch()
+{
+    SearchDialog *dialog = new SearchDialog(m_searcher, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, &SearchDialog::hitActivated, this, &MainWindow::showSearchHit);
+    dialog->show();
+}
+
+
+void MainWindow::showSearchHit(const SearchHit &hit)
+{
+    switch (hit.kind) {
+    case SearchKind::Task:
+        // 全部 also lists archived tasks
+        ui->lineEdit_task_filter->clear();
+        ui->comboBox_task->setCurrentIndex(0);
+        {
+            QModelIndex index = m_modelTask->revealTask(hit.refId);
+            if (!index.isValid()) break;
+            for (QModelIndex parent = index.parent(); parent.isValid(); parent = parent.parent()) {
+                ui->treeView_task->expand(parent);
+            }
+            ui->treeView_task->setCurrentIndex(index);
+            ui->treeView_task->scrollTo(index);
+        }
+        break;
+    case SearchKind::Habit:
+        ui->comboBox_habit->setCurrentIndex(0);
+        selectRowByText(ui->tableView_habit, 0, QString::number(hit.refId));
+        break;
+    case SearchKind::Plan: {
+        QDate date = m_dbManager.getLastPlanDate(hit.refId);
+        if (!date.isValid()) break;
+        ui->calendarWidget->setSelectedDate(date);
+        on_calendarWidget_clicked(date);
+        selectRowByText(ui->tableView_plan, 1, hit.text);
+        break;
+    }
+    case SearchKind::Review: {
+        QDate date = PeriodCalendar::startDate(hit.refId);
+        {
+            QSignalBlocker blocker(ui->comboBox_type);
+            ui->comboBox_type->setCurrentText(PeriodCalendar::typeToString(PeriodCalendar::typeOf(hit.refId)));
+        }
+        ui->calendarWidget->setSelectedDate(date);
+        on_calendarWidget_clicked(date);
+        break;
+    }
+    }
+}
+
+
+void MainWindow::selectRowByText(QTableView *tableView, int column, const QString &text)
+{
+    QAbstractItemModel *model = tableView->model();
+    for (int row = 0; ; ++row) {
+        // Paged models load further rows until the target shows up
+        if (row >= model->rowCount()) {
+            if (!model->canFetchMore(QModelIndex())) return;
+            model->fetchMore(QModelIndex());
+            if (row >= model->rowCount()) return;
+        }
+        QModelIndex index = model->index(row, column);
+        if (index.data().toString() == text) {
+            tableView->selectRow(row);
+            tableView->scrollTo(index);
+            return;
+        }
+    }
+}
+
+
 void MainWindow::changeTheme(const QString &themeName)
 {
     QString qssPath = QString(":/assets/resources/%1.qss").arg(themeName);
@@ -239,9 +735,9 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
         {
             adjustTableWidth(ui->tableView_plan);
         }
-        else if (obj == ui->tableView_task->viewport())
+        else if (obj == ui->treeView_task->viewport())
         {
-            adjustTableWidth(ui->tableView_task);
+            adjustTableWidth(ui->treeView_task);
         }
         else if (obj == ui->tableView_habit->viewport())
         {
@@ -253,64 +749,384 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 
 void MainWindow::saveData()
 {
-    QAbstractItemModel* model = ui->tableView_plan->model();
-    if (!model) {
-        qDebug() << "Model is not set!";
+    // Rows still waiting for the id of their insert go out with the next save,
+    // once a save in flight reports back
+    m_saveQueued = !m_pendingSaves.isEmpty();
+    m_autoSaveTimer->stop();
+    if (!m_planDate.isValid()) return;
+    m_dbManager.restoreArchivedPlans(m_planDate);
+
+    EditBatch batch;
+    PendingSave pending;
+    collectEdits(batch, &pending);
+    if (batch.removedIds.isEmpty() && batch.changes.isEmpty() && !batch.hasReview) {
+        updateSaveState();
         return;
     }
 
-    QDate selectedDate = ui->calendarWidget->selectedDate();
+    pending.saveId = m_autoSaver->save(batch);
+    m_pendingSaves.insert(pending.saveId, pending);
+    updateSaveState();
+}
+
+void MainWindow::commitEdits()
+{
+    if (!m_autoSaver) return;
+    m_autoSaveTimer->stop();
+
+    // Waits on the saver thread, so this only runs on close. A row edited or removed
+    // while its insert was in flight leaves one more write behind, so this takes at
+    // most a result, that write and a queued save
+    for (int round = 0; round < 3; ++round) {
+        if (m_pendingSaves.isEmpty()) {
+            if (!hasPendingEdits()) break;
+            saveData();
+        }
+        m_autoSaver->waitForIdle();
+        if (m_saveFailed) break;
+    }
+    m_autoSaveTimer->stop();
+}
 
-    int rowCount = model->rowCount();
+void MainWindow::leavePlanDay()
+{
+    // Handed to the saver, not waited for; rows still waiting for the id of their
+    // insert are written by onEditsSaved once it arrives
+    saveData();
+    for (int row = 0; row < m_modelPlan->rowCount(); ++row) {
+        PlanChange change;
+        if (!m_modelPlan->isAwaitingId(row) || !planChange(row, change)) continue;
+        m_awaitingRows.insert(m_modelPlan->rowKey(row), AwaitingRow{m_planDate, change, false});
+    }
+    for (int rowKey : m_modelPlan->removedInsertKeys()) {
+        m_awaitingRows.insert(rowKey, AwaitingRow{m_planDate, PlanChange(), true});
+    }
+}
 
-    for (int row = 1; row <= rowCount; ++row) {
-        QString type = model->index(row - 1, 0).data(Qt::DisplayRole).toString();
-        int indexId = row;
-        QString name = model->index(row - 1, 1).data(Qt::DisplayRole).toString();
-        int status = Utils::planStatusFromString(model->index(row - 1, 2).data(Qt::DisplayRole).toString());
-        if (type == "习惯")
-        {
-            int habitId = m_dbManager.getHabitIdByName(name);
-            m_dbManager.updateHabitPlan(indexId, name, status, habitId, selectedDate);
+void MainWindow::runAfterSaves(const std::function<void()> &run)
+{
+    if (m_pendingSaves.isEmpty()) {
+        run();
+        return;
+    }
+    m_afterSaves.append(run);
+}
+
+bool MainWindow::planChange(int row, PlanChange &change) const
+{
+    change.id = m_modelPlan->planId(row);
+    change.indexId = m_modelPlan->rank(row);
+    change.name = m_modelPlan->item(row, 1)->text();
+    change.status = Utils::planStatusFromInt(m_modelPlan->item(row, 2)->data(Utils::StatusRole).toInt());
+    change.taskId = 0;
+    change.habitId = 0;
+    // A freshly inserted row is written once it points at a task; the id, not the
+    // shown name, identifies the task or habit, which may have been renamed since
+    const int refId = m_modelPlan->refId(row);
+    if (change.name.isEmpty() || refId <= 0) return false;
+
+    QString type = m_modelPlan->item(row, 0)->text();
+    if (type == "习惯")
+    {
+        change.habitId = refId;
+    }
+    else if (type == "任务")
+    {
+        change.taskId = refId;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::collectEdits(EditBatch &batch, PendingSave *pending)
+{
+    batch.date = m_planDate;
+
+    // Habit rows drafted for an unplanned day are written with the day's first real edit
+    bool dayEdited = !m_modelPlan->removedPlans().isEmpty();
+    for (int row = 0; row < m_modelPlan->rowCount() && !dayEdited; ++row) {
+        dayEdited = m_modelPlan->isRowChanged(row)
+                    && (m_modelPlan->planId(row) != 0 || m_modelPlan->item(row, 0)->data(PlanModel::DirtyRole).toBool());
+    }
+
+    // Only new, edited and moved rows are written; removed saved rows are deleted
+    for (int row = 0; row < m_modelPlan->rowCount() && dayEdited; ++row) {
+        if (!m_modelPlan->isRowChanged(row)) continue;
+
+        PlanChange change;
+        if (!planChange(row, change)) continue;
+        batch.changes.append(change);
+
+        if (pending) {
+            if (change.habitId > 0) {
+                pending->habitCompletions.insert(change.habitId, change.status == PlanStatus::Completed);
+            }
+            pending->changedKeys.append(m_modelPlan->rowKey(row));
+            if (change.id == 0) {
+                pending->insertKeys.append(m_modelPlan->rowKey(row));
+            }
+            m_modelPlan->markSaved(row);
         }
-        else if (type == "任务")
-        {
-            int taskId = m_dbManager.getTaskIdByName(name);
-            m_dbManager.updateTaskPlan(indexId, name, status, taskId, selectedDate);
+    }
+
+    for (const PlanData &plan : m_modelPlan->removedPlans()) {
+        batch.removedIds.append(plan.id);
+        if (pending && plan.type == "习惯" && plan.status == PlanStatus::Completed) {
+            // A row of the same habit still on the day decides on its own
+            if (!pending->habitCompletions.contains(plan.habitId)) {
+                pending->habitCompletions.insert(plan.habitId, false);
+            }
         }
-        else
-        {
-            continue;
+    }
+    if (pending) {
+        pending->date = m_planDate;
+        pending->removedPlans = m_modelPlan->removedPlans();
+        m_modelPlan->clearRemovedPlans();
+    }
+
+    collectReview(batch, pending);
+}
+
+void MainWindow::collectReview(EditBatch &batch, PendingSave *pending)
+{
+    // The review is skipped while it is still loading or when neither field was edited
+    if (m_reviewRequest == 0
+        && (ui->textEdit_reflection->document()->isModified() || ui->textEdit_summary->document()->isModified())) {
+        batch.hasReview = true;
+        batch.reviewType = m_reviewType;
+        batch.reflection = ui->textEdit_reflection->toPlainText();
+        batch.summary = ui->textEdit_summary->toPlainText();
+        if (pending) {
+            pending->review = true;
+            pending->reviewKey = PeriodCalendar::key(m_reviewType, m_planDate);
+            ui->textEdit_reflection->document()->setModified(false);
+            ui->textEdit_summary->document()->setModified(false);
+        }
+    }
+}
+
+void MainWindow::saveReview()
+{
+    if (!m_planDate.isValid()) return;
+
+    EditBatch batch;
+    PendingSave pending;
+    batch.date = m_planDate;
+    pending.date = m_planDate;
+    collectReview(batch, &pending);
+    if (!batch.hasReview) return;
+
+    pending.saveId = m_autoSaver->save(batch);
+    m_pendingSaves.insert(pending.saveId, pending);
+    updateSaveState();
+}
+
+void MainWindow::loadReview()
+{
+    m_reviewType = ui->comboBox_type->currentText();
+    m_loadingEditors = true;
+    ui->textEdit_reflection->clear();
+    ui->textEdit_summary->clear();
+    m_loadingEditors = false;
+    qint64 periodKey = PeriodCalendar::key(m_reviewType, m_planDate);
+    ui->dateEdit_period_start->setDate(PeriodCalendar::startDate(periodKey));
+    ui->dateEdit_period_end->setDate(PeriodCalendar::endDate(periodKey));
+
+    // Bodies are read and decompressed off the GUI thread; edits wait for them
+    ui->textEdit_reflection->setReadOnly(true);
+    ui->textEdit_summary->setReadOnly(true);
+
+    // A review still being written may roll up into this one, so it is read once written
+    bool inFlight = false;
+    for (const PendingSave &pending : std::as_const(m_pendingSaves)) {
+        inFlight |= pending.review;
+    }
+    if (!inFlight) {
+        m_reviewRequest = m_reviewLoader->load(periodKey);
+        return;
+    }
+    m_reviewRequest = -1;
+    runAfterSaves([this, periodKey] {
+        if (m_reviewRequest == -1 && PeriodCalendar::key(m_reviewType, m_planDate) == periodKey) {
+            m_reviewRequest = m_reviewLoader->load(periodKey);
         }
+    });
+}
+
+bool MainWindow::hasPendingEdits()
+{
+    EditBatch batch;
+    collectEdits(batch, nullptr);
+    return !batch.removedIds.isEmpty() || !batch.changes.isEmpty() || batch.hasReview;
+}
+
+void MainWindow::journalEdits()
+{
+    EditBatch batch;
+    collectEdits(batch, nullptr);
+    if (!batch.removedIds.isEmpty() || !batch.changes.isEmpty() || batch.hasReview) {
+        m_autoSaver->journal(batch);
     }
+}
 
-    QString reflection = ui->textEdit_reflection->toPlainText();
-    QString summary = ui->textEdit_summary->toPlainText();
+void MainWindow::onEditsChanged()
+{
+    if (m_loadingEditors || !m_autoSaver) return;
 
-    QString currentText = ui->comboBox_type->currentText();
+    m_journalTimer->start();
+    if (m_autoSaveTimer->interval() > 0) {
+        m_autoSaveTimer->start();
+    }
+    updateSaveState();
+}
 
-    m_dbManager.updateReview(reflection, summary, selectedDate, currentText);
-    on_calendarWidget_clicked(ui->calendarWidget->selectedDate());
+void MainWindow::onEditsSaved(int saveId, bool ok, const QList<int> &insertedIds)
+{
+    auto found = m_pendingSaves.find(saveId);
+    if (found == m_pendingSaves.end()) return;
+    const PendingSave pending = found.value();
+    m_pendingSaves.erase(found);
+    m_saveFailed = !ok;
+    // A day left since the hand-off has no rows in the table any more; its
+    // results only reach the statistics
+    const bool shown = pending.date == m_planDate;
+
+    if (ok) {
+        EditBatch followUp;
+        followUp.date = pending.date;
+        for (int i = 0; i < pending.insertKeys.size() && i < insertedIds.size(); ++i) {
+            auto awaiting = m_awaitingRows.find(pending.insertKeys.at(i));
+            if (awaiting == m_awaitingRows.end()) {
+                m_modelPlan->setSavedId(pending.insertKeys.at(i), insertedIds.at(i));
+                continue;
+            }
+            if (awaiting->removed) {
+                followUp.removedIds.append(insertedIds.at(i));
+            } else {
+                PlanChange change = awaiting->change;
+                change.id = insertedIds.at(i);
+                followUp.changes.append(change);
+            }
+            m_awaitingRows.erase(awaiting);
+        }
+        if (!followUp.removedIds.isEmpty() || !followUp.changes.isEmpty()) {
+            PendingSave followUpSave;
+            followUpSave.date = followUp.date;
+            for (const PlanChange &change : std::as_const(followUp.changes)) {
+                if (change.habitId > 0) {
+                    followUpSave.habitCompletions.insert(change.habitId, change.status == PlanStatus::Completed);
+                }
+            }
+            followUpSave.saveId = m_autoSaver->save(followUp);
+            m_pendingSaves.insert(followUpSave.saveId, followUpSave);
+        }
+        // Habit history only changes once the rows are written
+        for (auto it = pending.habitCompletions.cbegin(); it != pending.habitCompletions.cend(); ++it) {
+            m_habitStats.setCompleted(it.key(), pending.date, it.value());
+        }
+        const QList<int> habitIds = pending.habitCompletions.keys();
+        if (!habitIds.isEmpty()) {
+            m_habitEvaluator->habitHistoryChanged(habitIds);
+            updateHabitStats(habitIds);
+        }
+        updatePlanChartDay(pending.date);
+    } else {
+        // Rows never inserted leave nothing for their later edits to update
+        for (int rowKey : pending.insertKeys) {
+            m_awaitingRows.remove(rowKey);
+        }
+        if (shown) {
+            // Everything the batch carried counts as unsaved again
+            for (int rowKey : pending.changedKeys) {
+                m_modelPlan->markUnsaved(rowKey);
+            }
+            m_modelPlan->restoreRemovedPlans(pending.removedPlans);
+            // The editors may hold another period by now
+            if (pending.review && m_reviewRequest == 0
+                && pending.reviewKey == PeriodCalendar::key(m_reviewType, m_planDate)) {
+                ui->textEdit_reflection->document()->setModified(true);
+                ui->textEdit_summary->document()->setModified(true);
+            }
+            m_journalTimer->start();
+        }
+    }
+
+    if (ok && m_saveQueued && m_pendingSaves.isEmpty()) {
+        m_saveQueued = false;
+        saveData();
+    } else if (m_autoSaveTimer->interval() > 0 && hasPendingEdits()) {
+        m_autoSaveTimer->start();
+    }
+    updateSaveState();
+
+    if (m_pendingSaves.isEmpty() && !m_afterSaves.isEmpty()) {
+        const QList<std::function<void()>> runs = m_afterSaves;
+        m_afterSaves.clear();
+        for (const std::function<void()> &run : runs) {
+            run();
+        }
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    // The one place edits are waited for: nothing may be left in flight on exit
+    commitEdits();
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::updateSaveState()
+{
+    if (!m_pendingSaves.isEmpty()) {
+        m_saveStateLabel->setText("保存中…");
+    } else if (m_saveFailed) {
+        m_saveStateLabel->setText("保存失败");
+    } else if (hasPendingEdits()) {
+        m_saveStateLabel->setText("未保存");
+    } else {
+        m_saveStateLabel->setText("已保存");
+    }
+}
 
-    on_comboBox_habit_currentIndexChanged(1);
+HabitData MainWindow::habitFromRow(int row) const
+{
+    HabitData habitData;
+    habitData.id = m_modelHabit->item(row, HabitModel::IdColumn)->text().toInt();
+    habitData.name = m_modelHabit->item(row, HabitModel::NameColumn)->text();
+    habitData.createdDate = QDate::fromString(m_modelHabit->item(row, HabitModel::CreatedDateColumn)->text(), "yyyy年MM月dd日");
+    habitData.target_frequency = m_modelHabit->item(row, HabitModel::FrequencyColumn)->text();
+    habitData.status = Utils::habitStatusFromInt(m_modelHabit->item(row, HabitModel::StatusColumn)->data(Utils::StatusRole).toInt());
+    return habitData;
 }
 
-void MainWindow::adjustTableWidth(QTableView *tableView)
+void MainWindow::adjustTableWidth(QAbstractItemView *view)
 {
-    if (!tableView || !tableView->model())
+    if (!view || !view->model())
         return;
 
-    tableView->resizeColumnsToContents();
+    // Table and tree views are sized the same way through their column header
+    QHeaderView *header = nullptr;
+    if (QTableView *tableView = qobject_cast<QTableView*>(view))
+        header = tableView->horizontalHeader();
+    else if (QTreeView *treeView = qobject_cast<QTreeView*>(view))
+        header = treeView->header();
+    if (!header)
+        return;
+
+    header->resizeSections(QHeaderView::ResizeToContents);
 
     int totalWidth = 0;
-    int columnCount = tableView->horizontalHeader()->count();
+    int columnCount = header->count();
 
     for (int i = 0; i < columnCount; ++i)
     {
-        totalWidth += tableView->horizontalHeader()->sectionSize(i);
+        totalWidth += header->sectionSize(i);
     }
 
-    int viewportWidth = tableView->viewport()->width();
+    int viewportWidth = view->viewport()->width();
 
     if (totalWidth > 0 && totalWidth != viewportWidth)
     {
@@ -318,9 +1134,9 @@ void MainWindow::adjustTableWidth(QTableView *tableView)
 
         for (int i = 0; i < columnCount; ++i)
         {
-            int originalWidth = tableView->horizontalHeader()->sectionSize(i);
+            int originalWidth = header->sectionSize(i);
             int newWidth = static_cast<int>(originalWidth * factor);
-            tableView->setColumnWidth(i, newWidth);
+            header->resizeSection(i, newWidth);
         }
     }
     else
@@ -331,19 +1147,24 @@ void MainWindow::adjustTableWidth(QTableView *tableView)
     int adjustedTotalWidth = 0;
     for (int i = 0; i < columnCount; ++i)
     {
-        adjustedTotalWidth += tableView->columnWidth(i);
+        adjustedTotalWidth += header->sectionSize(i);
     }
 
     int delta = viewportWidth - adjustedTotalWidth;
     if (delta != 0 && columnCount > 0)
     {
         int lastColumnIndex = columnCount - 1;
-        tableView->setColumnWidth(lastColumnIndex, tableView->columnWidth(lastColumnIndex) + delta);
+        header->resizeSection(lastColumnIndex, header->sectionSize(lastColumnIndex) + delta);
     }
 }
 
 
 void MainWindow::on_pushButton_add_task_clicked()
+{
+    addTask(0);
+}
+
+void MainWindow::addTask(int parentId)
 {
     AddTaskDialog dialog(this);
 
@@ -353,7 +1174,17 @@ void MainWindow::on_pushButton_add_task_clicked()
         taskData.name = dialog.getTaskName();
         taskData.dueDate = dialog.getDueDate();
 
-        m_dbManager.addTask(taskData);
+        int taskId = m_dbManager.addTask(taskData, parentId);
+        if (taskId > 0) {
+            m_taskNameIndex.insert(taskId, taskData.name);
+            m_tagIndex.addRow(TagKind::Task, taskId);
+            taskData.id = taskId;
+            taskData.status = TaskStatus::InProgress;
+            m_reminderScheduler->updateTasks({taskData});
+            if (!m_tagFilter.isEmpty()) {
+                evaluateTagFilter(m_tagFilter);
+            }
+        }
 
         on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
     }
@@ -368,7 +1199,8 @@ void MainWindow::onTableViewTaskDataChanged(const QModelIndex &topLeft, const QM
 
     const QAbstractItemModel *model = topLeft.model();
 
-    QModelIndex idIndex = model->index(row, 0);
+    // Subtask rows sit under their parent, so cells are looked up beside the edit
+    QModelIndex idIndex = topLeft.siblingAtColumn(0);
     QString taskIdStr = model->data(idIndex, Qt::DisplayRole).toString();
     bool ok;
     int taskId = taskIdStr.toInt(&ok);
@@ -383,17 +1215,39 @@ void MainWindow::onTableViewTaskDataChanged(const QModelIndex &topLeft, const QM
     switch (col) {
     case 1:
         m_dbManager.updateTaskName(taskId, newValue.toString());
+        if (m_taskNameIndex.contains(taskId)) {
+            m_taskNameIndex.insert(taskId, newValue.toString());
+        }
         break;
     case 3:
         m_dbManager.updateTaskDueDate(taskId, QDate::fromString(newValue.toString(), "yyyy年MM月dd日"));
         break;
-    case 5:
-        m_dbManager.updateTaskStatus(taskId, Utils::taskStatusFromString(newValue.toString()));
+    case 5: {
+        TaskStatus status = Utils::taskStatusFromInt(model->data(topLeft, Utils::StatusRole).toInt());
+        m_dbManager.updateTaskStatus(taskId, status);
+        if (status == TaskStatus::InProgress) {
+            m_taskNameIndex.insert(taskId, model->data(topLeft.siblingAtColumn(1), Qt::DisplayRole).toString());
+        } else {
+            m_taskNameIndex.remove(taskId);
+        }
+
+        // Finishing or cancelling a task closes its open subtasks with it
+        if (status != TaskStatus::InProgress && status != TaskStatus::Unfinished) {
+            const QList<int> subtasks = m_dbManager.getOpenSubtasks({taskId});
+            if (m_dbManager.updateTasksStatus(subtasks, status)) {
+                for (int subtaskId : subtasks) {
+                    m_taskNameIndex.remove(subtaskId);
+                }
+                m_reminderScheduler->removeTasks(subtasks);
+            }
+        }
         break;
+    }
     default:
         qDebug() << "Uneditable column modified.";
         break;
     }
+    updateTaskReminders({taskId});
     on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
     on_calendarWidget_clicked(ui->calendarWidget->selectedDate());
 }
@@ -422,51 +1276,295 @@ void MainWindow::onTableViewHabitDataChanged(const QModelIndex &topLeft, const Q
     switch (col) {
     case 1:
         m_dbManager.updateHabitName(habitId, newValue.toString());
+        // Rows materialized ahead still carry the old name
+        m_planScheduler->habitScheduleChanged(habitId);
         break;
     case 2:
         m_dbManager.updateHabitCreatedDate(habitId, QDate::fromString(newValue.toString(), "yyyy年MM月dd日"));
+        m_habitStats.updateHabit(habitFromRow(row));
+        m_planScheduler->habitScheduleChanged(habitId);
         break;
     case 3:
         m_dbManager.updateHabitFrequency(habitId, newValue.toString());
+        m_habitStats.updateHabit(habitFromRow(row));
+        m_planScheduler->habitScheduleChanged(habitId);
         break;
-    case 4:
-        m_dbManager.updateHabitStatus(habitId, Utils::habitStatusFromString(newValue.toString()));
+    case 6:
+        m_dbManager.updateHabitStatus(habitId, Utils::habitStatusFromInt(model->data(topLeft, Utils::StatusRole).toInt()));
+        m_planScheduler->habitScheduleChanged(habitId);
         break;
     default:
         qDebug() << "Uneditable column modified.";
         break;
     }
+    m_reminderScheduler->updateHabits({habitFromRow(row)});
     on_comboBox_habit_currentIndexChanged(ui->comboBox_task->currentIndex());
 }
 
 void MainWindow::on_comboBox_task_currentIndexChanged(int index)
 {
-    m_modelTask->removeRows(0, m_modelTask->rowCount());
+    TaskQuery taskQuery;
+    if (index > 0) {
+        taskQuery.statuses.append(Utils::taskStatusFromInt(index - 1));
+    }
+    taskQuery.nameContains = ui->lineEdit_task_filter->text();
+    taskQuery.tagFiltered = !m_tagFilter.isEmpty();
+    // Name and tag matches are listed flat; otherwise subtasks wait under their parent
+    taskQuery.rootsOnly = taskQuery.nameContains.trimmed().isEmpty() && !taskQuery.tagFiltered;
+    taskQuery.sortKey = m_modelTask->query().sortKey;
+    taskQuery.descending = m_modelTask->query().descending;
+    m_modelTask->setQuery(taskQuery);
+
+    adjustTableWidth(ui->treeView_task);
+}
 
-    QList<TaskData> taskDataList = m_dbManager.getTaskByStatus(index);
 
-    for (const TaskData &taskData : std::as_const(taskDataList)) {
-        QList<QStandardItem*> items;
-        items.append(new QStandardItem(QString::number(taskData.id)));
-        items.append(new QStandardItem(taskData.name));
-        items.append(new QStandardItem(taskData.createdDate.toString("yyyy年MM月dd日")));
-        items.append(new QStandardItem(taskData.dueDate.toString("yyyy年MM月dd日")));
-        items.append(new QStandardItem(taskData.completedDate.toString("yyyy年MM月dd日")));
-        items.append(new QStandardItem(Utils::taskStatusToString(taskData.status)));
+void MainWindow::on_lineEdit_task_filter_textChanged(const QString &text)
+{
+    Q_UNUSED(text);
+    on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
+}
 
-        for (int i = 0; i < items.size(); ++i) {
-            if (i == 1) continue;
-            items[i]->setTextAlignment(Qt::AlignCenter);
+
+void MainWindow::onTableViewTaskHeaderClicked(int column)
+{
+    TaskQuery::SortKey sortKey;
+    switch (column) {
+    case 1:
+        sortKey = TaskQuery::SortKey::Name;
+        break;
+    case 2:
+        sortKey = TaskQuery::SortKey::CreatedDate;
+        break;
+    case 3:
+        sortKey = TaskQuery::SortKey::DueDate;
+        break;
+    default:
+        sortKey = TaskQuery::SortKey::Id;
+        column = 0;
+        break;
+    }
+
+    // Clicking the sorted column again flips the order
+    TaskQuery taskQuery = m_modelTask->query();
+    taskQuery.descending = taskQuery.sortKey == sortKey && !taskQuery.descending;
+    taskQuery.sortKey = sortKey;
+    m_modelTask->setQuery(taskQuery);
+
+    ui->treeView_task->header()->setSortIndicator(column, taskQuery.descending ? Qt::DescendingOrder : Qt::AscendingOrder);
+}
+
+
+void MainWindow::onTableViewTaskContextMenu(const QPoint &pos)
+{
+    const QList<int> taskIds = selectedIds(ui->treeView_task);
+    if (taskIds.isEmpty()) return;
+
+    QMenu menu(this);
+    QMenu *statusMenu = menu.addMenu(QString("设置状态 (%1项)").arg(taskIds.size()));
+    const QStringList statuses = Utils::taskStatusList();
+    for (int i = 0; i < statuses.size(); ++i) {
+        connect(statusMenu->addAction(statuses.at(i)), &QAction::triggered, this, [this, taskIds, i]() {
+            setTasksStatus(taskIds, Utils::taskStatusFromInt(i));
+        });
+    }
+
+    QMenu *shiftMenu = menu.addMenu("顺延截止日期");
+    for (int days : {1, 7}) {
+        connect(shiftMenu->addAction(QString("%1天").arg(days)), &QAction::triggered, this, [this, taskIds, days]() {
+            shiftTasksDueDate(taskIds, days);
+        });
+    }
+    connect(shiftMenu->addAction("自定义..."), &QAction::triggered, this, [this, taskIds]() {
+        bool ok = false;
+        int days = QInputDialog::getInt(this, "顺延截止日期", "顺延天数（负数提前）:", 1, -365, 365, 1, &ok);
+        if (ok) {
+            shiftTasksDueDate(taskIds, days);
         }
+    });
 
-        m_modelTask->appendRow(items);
+    addTagMenu(&menu, TagKind::Task, taskIds);
+
+    menu.addSeparator();
+    if (taskIds.size() == 1) {
+        connect(menu.addAction("添加子任务..."), &QAction::triggered, this, [this, taskIds]() {
+            addTask(taskIds.first());
+        });
     }
+    connect(menu.addAction("设为顶层任务"), &QAction::triggered, this, [this, taskIds]() {
+        moveTasks(taskIds, 0);
+    });
 
-    PlanNameDelegate* planNameDelegate = qobject_cast<PlanNameDelegate*>(ui->tableView_plan->itemDelegateForColumn(1));
-    if (planNameDelegate) {
-        planNameDelegate->refreshTaskNames();
+    menu.addSeparator();
+    connect(menu.addAction("取消任务"), &QAction::triggered, this, [this, taskIds]() {
+        setTasksStatus(taskIds, TaskStatus::Cancelled);
+    });
+
+    menu.exec(ui->treeView_task->viewport()->mapToGlobal(pos));
+}
+
+
+void MainWindow::onTableViewHabitContextMenu(const QPoint &pos)
+{
+    const QList<int> habitIds = selectedIds(ui->tableView_habit);
+    if (habitIds.isEmpty()) return;
+
+    QMenu menu(this);
+    QMenu *statusMenu = menu.addMenu(QString("设置状态 (%1项)").arg(habitIds.size()));
+    const QStringList statuses = Utils::habitStatusList();
+    for (int i = 0; i < statuses.size(); ++i) {
+        connect(statusMenu->addAction(statuses.at(i)), &QAction::triggered, this, [this, habitIds, i]() {
+            setHabitsStatus(habitIds, Utils::habitStatusFromInt(i));
+        });
+    }
+    addTagMenu(&menu, TagKind::Habit, habitIds);
+
+    menu.addSeparator();
+    connect(menu.addAction("取消习惯"), &QAction::triggered, this, [this, habitIds]() {
+        setHabitsStatus(habitIds, HabitStatus::Cancelled);
+    });
+
+    menu.exec(ui->tableView_habit->viewport()->mapToGlobal(pos));
+}
+
+
+void MainWindow::moveTasks(const QList<int> &taskIds, int parentId)
+{
+    if (!m_dbManager.setTaskParent(taskIds, parentId)) {
+        statusBar()->showMessage("移动任务失败：不能移到自身或其子任务下", 5000);
+        return;
+    }
+    on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
+}
+
+
+QList<int> MainWindow::selectedIds(QAbstractItemView *view) const
+{
+    QList<int> ids;
+    const QModelIndexList rows = view->selectionModel()->selectedRows(0);
+    for (const QModelIndex &index : rows) {
+        bool ok = false;
+        int id = index.data().toString().toInt(&ok);
+        if (ok) {
+            ids.append(id);
+        }
     }
-    adjustTableWidth(ui->tableView_task);
+    return ids;
+}
+
+
+void MainWindow::setTasksStatus(const QList<int> &selectedTaskIds, TaskStatus status)
+{
+    QList<int> taskIds = selectedTaskIds;
+    QHash<int, QString> names;
+    if (status == TaskStatus::InProgress) {
+        for (int taskId : taskIds) {
+            names.insert(taskId, m_modelTask->taskName(taskId));
+        }
+    } else if (status != TaskStatus::Unfinished) {
+        // Finishing or cancelling a task closes its open subtasks with it
+        taskIds.append(m_dbManager.getOpenSubtasks(taskIds));
+    }
+
+    if (!m_dbManager.updateTasksStatus(taskIds, status)) {
+        statusBar()->showMessage("更新任务状态失败", 5000);
+        return;
+    }
+
+    for (int taskId : std::as_const(taskIds)) {
+        if (status == TaskStatus::InProgress) {
+            m_taskNameIndex.insert(taskId, names.value(taskId));
+        } else {
+            m_taskNameIndex.remove(taskId);
+        }
+    }
+    // Matches the completed_date updateTasksStatus wrote
+    const bool completed = status == TaskStatus::Completed || status == TaskStatus::LateCompleted;
+    m_modelTask->setTaskStatus(taskIds, status, completed ? QDate::currentDate() : QDate());
+    m_modelTask->refreshProgress();
+    if (status == TaskStatus::InProgress) {
+        updateTaskReminders(taskIds);
+    } else {
+        m_reminderScheduler->removeTasks(taskIds);
+    }
+
+    // Only today's plan rows follow the tasks
+    if (status != TaskStatus::InProgress && ui->calendarWidget->selectedDate() == QDate::currentDate()) {
+        on_calendarWidget_clicked(ui->calendarWidget->selectedDate());
+    }
+}
+
+
+void MainWindow::shiftTasksDueDate(const QList<int> &taskIds, int days)
+{
+    if (!m_dbManager.shiftTasksDueDate(taskIds, days)) {
+        statusBar()->showMessage("顺延截止日期失败", 5000);
+        return;
+    }
+    updateTaskReminders(taskIds);
+    on_comboBox_task_currentIndexChanged(ui->comboBox_task->currentIndex());
+}
+
+void MainWindow::updateTaskReminders(const QList<int> &taskIds)
+{
+    // Reread by id, so the reminders follow whatever the edit left in the database
+    TaskQuery query;
+    query.ids = taskIds;
+    m_reminderScheduler->updateTasks(m_dbManager.queryTasks(query));
+}
+
+void MainWindow::showReminders(const QList<Reminder> &reminders)
+{
+    // Habits already ticked off today are not reminded of
+    m_habitStats.extendTo(QDate::currentDate());
+    QStringList tasks;
+    QStringList habits;
+    for (const Reminder &reminder : reminders) {
+        if (reminder.kind == Reminder::Kind::Task) {
+            tasks.append(QString("%1（%2截止）").arg(reminder.name, reminder.date.toString("MM月dd日")));
+        } else if (m_habitStats.completedDays(reminder.id, reminder.date, reminder.date) == 0) {
+            habits.append(reminder.name);
+        }
+    }
+
+    auto notify = [this](const QString &title, const QStringList &names) {
+        if (names.isEmpty()) return;
+        QString message = names.mid(0, 5).join("、");
+        if (names.size() > 5) {
+            message += QString(" 等%1项").arg(names.size());
+        }
+        if (m_trayIcon) {
+            m_trayIcon->showMessage(title, message, QSystemTrayIcon::Information, 10000);
+        } else {
+            statusBar()->showMessage(title + ": " + message, 10000);
+        }
+    };
+    notify("任务即将到期", tasks);
+    notify("今日习惯尚未完成", habits);
+}
+
+
+void MainWindow::setHabitsStatus(const QList<int> &habitIds, HabitStatus status)
+{
+    if (!m_dbManager.updateHabitsStatus(habitIds, status)) {
+        statusBar()->showMessage("更新习惯状态失败", 5000);
+        return;
+    }
+    for (int habitId : habitIds) {
+        m_planScheduler->habitScheduleChanged(habitId);
+    }
+
+    // Selected habits are rows of the table, which still shows their old status
+    QList<HabitData> habits;
+    for (int row = 0; row < m_modelHabit->rowCount(); ++row) {
+        HabitData habitData = habitFromRow(row);
+        if (habitIds.contains(habitData.id)) {
+            habitData.status = status;
+            habits.append(habitData);
+        }
+    }
+    m_reminderScheduler->updateHabits(habits);
+    on_comboBox_habit_currentIndexChanged(ui->comboBox_habit->currentIndex());
 }
 
 
@@ -480,7 +1578,19 @@ void MainWindow::on_pushButton_add_habit_clicked()
         habitData.name = dialog.getHabitName();
         habitData.target_frequency = dialog.getHabitFrequency();
 
-        m_dbManager.addHabit(habitData);
+        int habitId = m_dbManager.addHabit(habitData);
+        if (habitId > 0) {
+            habitData.id = habitId;
+            habitData.createdDate = QDate::currentDate();
+            habitData.status = HabitStatus::InProgress;
+            m_habitStats.addHabit(habitData);
+            m_reminderScheduler->updateHabits({habitData});
+            m_planScheduler->habitAdded(habitId);
+            m_tagIndex.addRow(TagKind::Habit, habitId);
+            if (!m_tagFilter.isEmpty()) {
+                evaluateTagFilter(m_tagFilter);
+            }
+        }
 
         on_comboBox_habit_currentIndexChanged(ui->comboBox_habit->currentIndex());
     }
@@ -489,21 +1599,28 @@ void MainWindow::on_pushButton_add_habit_clicked()
 void MainWindow::on_comboBox_habit_currentIndexChanged(int index)
 {
     m_modelHabit->removeRows(0, m_modelHabit->rowCount());
+    m_habitStats.extendTo(QDate::currentDate());
 
     QList<HabitData> habitDataList;
     habitDataList = m_dbManager.getHabitByStatus(index);
 
     for (const HabitData &habitData : std::as_const(habitDataList)) {
+        if (!m_tagFilter.isEmpty() && !m_habitTagFilter.contains(habitData.id)) continue;
+
         QList<QStandardItem*> items;
-        int maxTimes = m_dbManager.getHabitMaxTimes(habitData);
-        int allTimes = m_dbManager.getHabitTimes(habitData);
         items.append(new QStandardItem(QString::number(habitData.id)));
         items.append(new QStandardItem(habitData.name));
         items.append(new QStandardItem(habitData.createdDate.toString("yyyy年MM月dd日")));
         items.append(new QStandardItem(habitData.target_frequency));
-        items.append(new QStandardItem(QString::number(allTimes)));
-        items.append(new QStandardItem(QString::number(maxTimes)));
-        items.append(new QStandardItem(Utils::habitStatusToString(habitData.status)));
+        items.append(new QStandardItem());
+        items.append(new QStandardItem());
+        QStandardItem *statusItem = new QStandardItem(Utils::habitStatusToString(habitData.status));
+        statusItem->setData(static_cast<int>(habitData.status), Utils::StatusRole);
+        items.append(statusItem);
+        for (int i = HabitModel::RateColumn; i <= HabitModel::TrendColumn; ++i) {
+            items.append(new QStandardItem());
+        }
+        fillHabitStats(items, habitData.id);
 
         for (int i = 0; i < items.size(); ++i) {
             if (i == 1) continue;
@@ -517,13 +1634,54 @@ void MainWindow::on_comboBox_habit_currentIndexChanged(int index)
 }
 
 
-void MainWindow::on_calendarWidget_clicked(const QDate &date)
+void MainWindow::fillHabitStats(const QList<QStandardItem *> &items, int habitId)
+{
+    items[HabitModel::TotalColumn]->setText(QString::number(m_habitStats.totalCompletions(habitId)));
+    QStandardItem *streakItem = items[HabitModel::StreakColumn];
+    streakItem->setText(QString::number(m_habitStats.longestStreak(habitId)));
+    const std::array<int, 7> weekdays = m_habitStats.weekdayCompletions(habitId);
+    streakItem->setToolTip(QString("当前连续: %1\n最长间隔: %2天\n周一至周日: %3 %4 %5 %6 %7 %8 %9")
+                               .arg(m_habitStats.currentStreak(habitId))
+                               .arg(m_habitStats.longestGap(habitId))
+                               .arg(weekdays[0]).arg(weekdays[1]).arg(weekdays[2]).arg(weekdays[3])
+                               .arg(weekdays[4]).arg(weekdays[5]).arg(weekdays[6]));
+    int column = HabitModel::RateColumn;
+    for (int days : {7, 30, 365}) {
+        items[column++]->setText(QString("%1%").arg(qRound(m_habitStats.completionRate(habitId, days) * 100)));
+    }
+    items[HabitModel::TrendColumn]->setData(QVariant::fromValue(m_habitStats.rollingRates(habitId, 7, 30)), HabitModel::TrendRole);
+}
+
+void MainWindow::updateHabitStats(const QList<int> &habitIds)
+{
+    m_habitStats.extendTo(QDate::currentDate());
+    for (int row = 0; row < m_modelHabit->rowCount(); ++row) {
+        int habitId = m_modelHabit->item(row, HabitModel::IdColumn)->text().toInt();
+        if (!habitIds.contains(habitId)) continue;
+
+        QList<QStandardItem *> items;
+        for (int column = 0; column < m_modelHabit->columnCount(); ++column) {
+            items.append(m_modelHabit->item(row, column));
+        }
+        {
+            // Computed cells, not edits to write back
+            QSignalBlocker blocker(m_modelHabit);
+            fillHabitStats(items, habitId);
+        }
+        emit m_modelHabit->dataChanged(m_modelHabit->index(row, HabitModel::TotalColumn),
+                                       m_modelHabit->index(row, HabitModel::TrendColumn),
+                                       {Qt::DisplayRole, Qt::ToolTipRole, HabitModel::TrendRole});
+    }
+}
+
+
+void MainWindow::updatePlanChart(const QDate &date)
 {
     QChart *chart = m_chartViewPlan->chart();
     chart->removeAllSeries();
 
     QDate startDate = date.addDays(-13);
-    QMap<QDate, double> resultDate = m_dbManager.getPlanNumberByDate(startDate, date);
+    QMap<QDate, double> resultDate = m_dbManager.getPlanNumberByDate(startDate, date, tagPlanFilter());
 
     QDateTimeAxis *axisX = nullptr;
     QValueAxis *axisY = nullptr;
@@ -577,107 +1735,88 @@ void MainWindow::on_calendarWidget_clicked(const QDate &date)
     }
 
     chart->legend()->hide();
+}
 
-    m_modelPlan->removeRows(0, m_modelPlan->rowCount());
-
-    QList<PlanData> planDataList;
-    planDataList = m_dbManager.getPlanByDate(date);
-    bool needAdd = true;
-
-    for (const PlanData &plan : std::as_const(planDataList))
-    {
-        if (plan.type == "习惯") needAdd = false;
-        QList<QStandardItem*> items;
-        items.append(new QStandardItem(plan.type));
-        items.append(new QStandardItem(plan.name));
-        items.append(new QStandardItem(Utils::planStatusToString(plan.status)));
-
-        items[0]->setTextAlignment(Qt::AlignCenter);
+void MainWindow::updatePlanChartDay(const QDate &date)
+{
+    QChart *chart = m_chartViewPlan->chart();
+    QDate shownDate = ui->calendarWidget->selectedDate();
+    if (date > shownDate || date < shownDate.addDays(-13)) return;
 
-        m_modelPlan->appendRow(items);
+    // The chart shows a single series once it has data; anything else is drawn afresh
+    QLineSeries *series = chart->series().size() == 1 ? qobject_cast<QLineSeries *>(chart->series().first()) : nullptr;
+    if (!series || series->count() == 0) {
+        updatePlanChart(shownDate);
+        return;
     }
 
-    QString currentText = ui->comboBox_type->currentText();
-    ui->textEdit_reflection->clear();
-    ui->textEdit_summary->clear();
-    QDate startPeriodDate = date;
-    QDate endPeriodDate = date;
-
-    if (currentText == "周总结")
-    {
-        startPeriodDate = date.addDays(-date.dayOfWeek() + 1);
-        endPeriodDate = startPeriodDate.addDays(6);
-    }
-    else if (currentText == "月总结")
-    {
-        startPeriodDate = date.addDays(-date.day() + 1);
-        endPeriodDate = startPeriodDate.addMonths(1).addDays(-1);
+    const qreal x = QDateTime(date, QTime(0,0,0)).toMSecsSinceEpoch();
+    const QMap<QDate, double> resultDate = m_dbManager.getPlanNumberByDate(date, date, tagPlanFilter());
+    int index = 0;
+    while (index < series->count() && series->at(index).x() < x) {
+        ++index;
     }
-    else if (currentText == "年中总结")
-    {
-        startPeriodDate = QDate(date.year(), 1, 1);
-        endPeriodDate = QDate(date.year(), 6, 30);
-    }
-    else if (currentText == "年终总结")
-    {
-        startPeriodDate = QDate(date.year(), 1, 1);
-        endPeriodDate = QDate(date.year(), 12, 31);
-    }
-
-    ui->dateEdit_period_start->setDate(startPeriodDate);
-    ui->dateEdit_period_end->setDate(endPeriodDate);
-    ReviewData reviewData;
-    reviewData = m_dbManager.getReviewByDate(currentText, startPeriodDate, endPeriodDate);
-    if (!reviewData.reflection.isEmpty()) {
-        ui->textEdit_reflection->setText(reviewData.reflection);
-    }
-    else {
-        ReviewData data;
-        if (currentText == "月总结") {
-            QDate weekStart = startPeriodDate.addDays(-startPeriodDate.dayOfWeek() + 1);
-            if (weekStart < startPeriodDate && startPeriodDate.dayOfWeek() <= 4) {
-                startPeriodDate = weekStart;
-            }
-
-            QDate weekEnd = endPeriodDate.addDays(7 - endPeriodDate.dayOfWeek());
-            if (weekEnd > endPeriodDate && endPeriodDate.dayOfWeek() > 4) {
-                endPeriodDate = weekEnd;
-            }
-        }
-        QList<ReviewData> listData = m_dbManager.getReviewByType(currentText, startPeriodDate, endPeriodDate);
-        for (const ReviewData &item : std::as_const(listData)) {
-            data.reflection += item.reflection + "\n";
+    const bool present = index < series->count() && series->at(index).x() == x;
+    if (resultDate.isEmpty()) {
+        if (present) {
+            series->remove(index);
         }
-        if (!data.reflection.isEmpty()) {
-            ui->textEdit_reflection->setText(data.reflection.trimmed());
+        if (series->count() == 0) {
+            updatePlanChart(shownDate);
         }
+        return;
     }
-    if (!reviewData.summary.isEmpty()) {
-        ui->textEdit_summary->setText(reviewData.summary);
+
+    const QPointF point(x, qRound(resultDate.first() * 100));
+    if (present) {
+        series->replace(index, point);
+    } else {
+        series->insert(index, point);
     }
-    else {
-        ReviewData data;
-        if (currentText == "月总结") {
-            QDate weekStart = startPeriodDate.addDays(-startPeriodDate.dayOfWeek() + 1);
-            if (weekStart < startPeriodDate && startPeriodDate.dayOfWeek() <= 4) {
-                startPeriodDate = weekStart;
-            }
+}
 
-            QDate weekEnd = endPeriodDate.addDays(7 - endPeriodDate.dayOfWeek());
-            if (weekEnd > endPeriodDate && endPeriodDate.dayOfWeek() > 4) {
-                endPeriodDate = weekEnd;
-            }
-        }
-        QList<ReviewData> listData = m_dbManager.getReviewByType(currentText, startPeriodDate, endPeriodDate);
-        for (const ReviewData &item : std::as_const(listData)) {
-            data.summary += item.summary + "\n";
-        }
-        if (!data.summary.isEmpty()) {
-            ui->textEdit_summary->setText(data.summary.trimmed());
-        }
+
+void MainWindow::on_calendarWidget_clicked(const QDate &date)
+{
+    // The day being left is handed to the saver before its rows are replaced
+    leavePlanDay();
+    updatePlanChart(date);
+
+    m_planDate = date;
+    m_modelPlan->clearPlans();
+
+    loadReview();
+
+    // Rows of this day still being written are read back once they are
+    bool inFlight = false;
+    for (const PendingSave &pending : std::as_const(m_pendingSaves)) {
+        inFlight |= pending.date == date;
     }
+    ui->tableView_plan->setEnabled(!inFlight);
+    if (!inFlight) {
+        loadPlanDay(date);
+    } else {
+        runAfterSaves([this, date] {
+            if (m_planDate != date) return;
+            ui->tableView_plan->setEnabled(true);
+            loadPlanDay(date);
+        });
+    }
+    updateSaveState();
+}
 
+void MainWindow::loadPlanDay(const QDate &date)
+{
+    QList<PlanData> planDataList;
+    planDataList = m_dbManager.getPlanByDate(date);
+    bool needAdd = true;
 
+    for (const PlanData &plan : std::as_const(planDataList))
+    {
+        if (plan.type == "习惯") needAdd = false;
+        int refId = plan.type == "习惯" ? plan.habitId : plan.taskId;
+        m_modelPlan->appendPlan(plan.type, plan.name, plan.status, refId, plan.id, plan.indexId);
+    }
 
     if (!needAdd)
     {
@@ -689,86 +1828,12 @@ void MainWindow::on_calendarWidget_clicked(const QDate &date)
 
     for (const HabitData &habit : std::as_const(habitDataList))
     {
-        if (habit.createdDate > date)
-            continue;
-
-        QString frequency = habit.target_frequency;
-        bool shouldAdd = false;
-
-        if (frequency == "每日一次")
-        {
-            shouldAdd = true;
-        }
-        else if (frequency.startsWith("每二日一次"))
-        {
-            int daysDiff = habit.createdDate.daysTo(date);
-            if (daysDiff % 2 == 0)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每三日一次"))
-        {
-            int daysDiff = habit.createdDate.daysTo(date);
-            if (daysDiff % 3 == 0)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周一"))
-        {
-            if (date.dayOfWeek() == 1)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周二"))
-        {
-            if (date.dayOfWeek() == 2)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周三"))
-        {
-            if (date.dayOfWeek() == 3)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周四"))
-        {
-            if (date.dayOfWeek() == 4)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周五"))
-        {
-            if (date.dayOfWeek() == 5)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周六"))
-        {
-            if (date.dayOfWeek() == 6)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周周日"))
-        {
-            if (date.dayOfWeek() == 7)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周工作日"))
-        {
-            if (date.dayOfWeek() >= 1 && date.dayOfWeek() <= 5)
-                shouldAdd = true;
-        }
-        else if (frequency.startsWith("每周休息日"))
-        {
-            if (date.dayOfWeek() == 6 || date.dayOfWeek() == 7)
-                shouldAdd = true;
-        }
+        bool shouldAdd = Utils::isHabitDue(habit.target_frequency, habit.createdDate, date);
 
         if (shouldAdd)
         {
-            QList<QStandardItem*> items;
-            items.append(new QStandardItem("习惯"));
-            items.append(new QStandardItem(habit.name));
-            items.append(new QStandardItem(Utils::planStatusToString(habit.status)));
-            items[0]->setTextAlignment(Qt::AlignCenter);
-
-            m_modelPlan->appendRow(items);
+            m_modelPlan->appendPlan(QStringLiteral("习惯"), habit.name, PlanStatus::InProgress, habit.id);
         }
-
-        m_dbManager.updateHabitStatusByTimes(habit);
     }
 }
 
@@ -805,25 +1870,17 @@ void MainWindow::on_pushButton_delete_clicked()
         int row = selectedRows[i].row();
         model->removeRow(row);
     }
+    onEditsChanged();
 }
 
 
 void MainWindow::on_pushButton_insert_clicked()
 {
-    QTableView *tableView = ui->tableView_plan;
-    QStandardItemModel *model = qobject_cast<QStandardItemModel*>(tableView->model());
-
-    if (!model) {
-        qDebug() << "Model is not a QStandardItemModel!";
-        return;
-    }
-
-    QList<QStandardItem*> items;
-    items.append(new QStandardItem("任务"));
-    items.append(new QStandardItem(""));
-    items.append(new QStandardItem("进行中"));
-
-    model->appendRow(items);
+    // Lands below the selected row, or at the end when nothing is selected
+    QModelIndex current = ui->tableView_plan->currentIndex();
+    int row = current.isValid() ? current.row() + 1 : m_modelPlan->rowCount();
+    m_modelPlan->insertPlan(row, QStringLiteral("任务"), QString(), PlanStatus::InProgress);
+    ui->tableView_plan->selectRow(row);
 }
 
 void MainWindow::onChartHovered(const QPointF &point, bool state)
@@ -876,7 +1933,14 @@ void MainWindow::onChartHovered(const QPointF &point, bool state)
 
 void MainWindow::on_comboBox_type_currentTextChanged(const QString &arg1)
 {
-    QDate date = ui->calendarWidget->selectedDate();
-    on_calendarWidget_clicked(date);
+    Q_UNUSED(arg1);
+    // The first shown day reads the type itself
+    if (!m_planDate.isValid()) return;
+
+    // Only the review depends on the period type: the edited text is handed off
+    // and the new period's review is one keyed load
+    saveReview();
+    loadReview();
+    updateSaveState();
 }
 
@@ -2,15 +2,34 @@
 #define MAINWINDOW_H
 
 #include "database.h"
+#include "habitevaluator.h"
+#include "planscheduler.h"
+#include "tasksweeper.h"
+#include "midnighttimer.h"
+#include "reminderscheduler.h"
+#include "archiver.h"
+#include "storageflusher.h"
+#include "reviewloader.h"
+#include "searcher.h"
+#include "autosaver.h"
+#include "habitstats.h"
 #include "models/habitmodel.h"
 #include "models/taskmodel.h"
 #include "models/planmodel.h"
+#include "models/tasknameindex.h"
+#include "models/tagindex.h"
+#include "models/planrangemodel.h"
 
 #include <QMainWindow>
 #include <QStandardItemModel>
 #include <QTableView>
+#include <QTreeView>
 #include <QChartView>
 #include <QToolTip>
+#include <QTimer>
+#include <QLabel>
+#include <QSystemTrayIcon>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -23,10 +42,14 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    MainWindow(const QString &dbPath, bool inMemory, QWidget *parent = nullptr);
     ~MainWindow();
 
     bool eventFilter(QObject *obj, QEvent *event);
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void on_pushButton_add_task_clicked();
     void onTableViewTaskDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
@@ -34,6 +57,16 @@ private slots:
 
     void on_comboBox_task_currentIndexChanged(int index);
 
+    void on_lineEdit_task_filter_textChanged(const QString &text);
+
+    void onTableViewTaskHeaderClicked(int column);
+
+    void onTableViewTaskContextMenu(const QPoint &pos);
+
+    void moveTasks(const QList<int> &taskIds, int parentId);
+
+    void onTableViewHabitContextMenu(const QPoint &pos);
+
     void on_pushButton_add_habit_clicked();
 
     void on_comboBox_habit_currentIndexChanged(int index);
@@ -51,22 +84,114 @@ private slots:
 private slots:
     void onChartHovered(const QPointF &point, bool state);
 
+    void onEditsChanged();
+
+    void onEditsSaved(int saveId, bool ok, const QList<int> &insertedIds);
+
     void on_comboBox_type_currentTextChanged(const QString &arg1);
 
 private:
+    // Plan rows and review state handed to a save in flight
+    struct PendingSave {
+        int saveId = 0;
+        QList<int> changedKeys;
+        QList<int> insertKeys;  // rows inserted by the save, in insertedIds order
+        QList<PlanData> removedPlans;
+        QDate date;
+        QHash<int, bool> habitCompletions;  // habit id -> completed on date, applied once saved
+        bool review = false;
+        qint64 reviewKey = 0;  // period the review text was saved for
+    };
+
+    // A row of a day no longer shown, edited or removed while its insert was in flight
+    struct AwaitingRow {
+        QDate date;
+        PlanChange change;
+        bool removed = false;
+    };
+
     Ui::MainWindow *ui;
+    const QString m_dbPath;
+    const QString m_journalPath;
     Database m_dbManager;
+    HabitEvaluator *m_habitEvaluator;
+    PlanScheduler *m_planScheduler;
+    TaskSweeper *m_taskSweeper;
+    MidnightTimer *m_midnightTimer;  // one daily tick for the day-bound jobs
+    ReminderScheduler *m_reminderScheduler;
+    QSystemTrayIcon *m_trayIcon;  // null where the desktop has no tray
+    Archiver *m_archiver;
+    StorageFlusher *m_storageFlusher;
+    ReviewLoader *m_reviewLoader;
+    Searcher *m_searcher;
+    AutoSaver *m_autoSaver;
+    QTimer *m_autoSaveTimer;  // restarted by every edit, saves once edits go idle
+    QTimer *m_journalTimer;
+    QLabel *m_saveStateLabel;
+    QHash<int, PendingSave> m_pendingSaves;  // by save id
+    QHash<int, AwaitingRow> m_awaitingRows;  // by row key, written once the insert reports its id
+    QList<std::function<void()>> m_afterSaves;  // run once no save is in flight
+    bool m_saveQueued;  // a save was asked for while another was in flight
+    bool m_saveFailed;
+    bool m_loadingEditors;  // editor text set by the program is not an edit
+    QDate m_planDate;  // day shown in the plan table
+    QString m_reviewType;  // period type the review editors were loaded for
+    int m_reviewRequest;  // pending review load, -1 until review saves land, 0 once the editors hold the loaded text
     TaskModel* m_modelTask;
     HabitModel* m_modelHabit;
     PlanModel* m_modelPlan;
+    TaskNameIndex m_taskNameIndex;
+    TagIndex m_tagIndex;
+    QString m_tagFilter;  // tag expression the lists and chart are filtered by, empty for none
+    TagBitmap m_taskTagFilter;
+    TagBitmap m_habitTagFilter;
+    QLabel *m_tagFilterLabel;
+    HabitStats m_habitStats;
     QChartView *m_chartViewPlan;
     QToolTip *m_tooltip;
     QActionGroup *themeGroup; // 主题分组，便于同步菜单选中项
     void init();
     void initChart();
     void saveData();
-    void adjustTableWidth(QTableView *tableView);
+    void commitEdits();
+    void leavePlanDay();
+    void loadPlanDay(const QDate &date);
+    void runAfterSaves(const std::function<void()> &run);
+    bool planChange(int row, PlanChange &change) const;
+    void collectEdits(EditBatch &batch, PendingSave *pending);
+    void collectReview(EditBatch &batch, PendingSave *pending);
+    void saveReview();
+    void loadReview();
+    bool hasPendingEdits();
+    void journalEdits();
+    void updateSaveState();
+    void updatePlanChart(const QDate &date);
+    void updatePlanChartDay(const QDate &date);
+    HabitData habitFromRow(int row) const;
+    void fillHabitStats(const QList<QStandardItem *> &items, int habitId);
+    void updateHabitStats(const QList<int> &habitIds);
+    void adjustTableWidth(QAbstractItemView *view);
     void createThemeMenu();
+    void createViewMenu();
+    void createPlanMenu();
+    void createTagMenu();
+    bool evaluateTagFilter(const QString &expression);
+    void setTagFilter(const QString &expression);
+    PlanFilter tagPlanFilter() const;
+    void addTagMenu(QMenu *menu, TagKind kind, const QList<int> &ids);
+    void setTagged(TagKind kind, int tagId, const QList<int> &ids, bool tagged);
+    void rollForwardPlans(const QDate &startDate, const QDate &endDate, const QDate &targetDate);
+    void openPlanner(PlanRangeModel::Mode mode);
+    void openSearch();
+    void showSearchHit(const SearchHit &hit);
+    void selectRowByText(QTableView *tableView, int column, const QString &text);
+    QList<int> selectedIds(QAbstractItemView *view) const;
+    void addTask(int parentId);
+    void setTasksStatus(const QList<int> &selectedTaskIds, TaskStatus status);
+    void shiftTasksDueDate(const QList<int> &taskIds, int days);
+    void updateTaskReminders(const QList<int> &taskIds);
+    void showReminders(const QList<Reminder> &reminders);
+    void setHabitsStatus(const QList<int> &habitIds, HabitStatus status);
     void changeTheme(const QString &themeName);
 };
 #endif // MAINWINDOW_H
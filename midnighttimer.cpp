@@ -0,0 +1,26 @@
+#include "midnighttimer.h"
+
+#include <QDateTime>
+
+MidnightTimer::MidnightTimer(QObject *parent)
+    : QObject{parent}
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, [this] {
+        emit dayStarted(QDate::currentDate());
+        scheduleNextRun();
+    });
+}
+
+void MidnightTimer::start()
+{
+    scheduleNextRun();
+}
+
+void MidnightTimer::scheduleNextRun()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QDateTime nextMidnight(now.date().addDays(1), QTime(0, 0, 5));
+    m_timer.start(static_cast<int>(qMax<qint64>(1000, now.msecsTo(nextMidnight))));
+}
@@ -0,0 +1,29 @@
+#ifndef MIDNIGHTTIMER_H
+#define MIDNIGHTTIMER_H
+
+#include <QDate>
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @brief MidnightTimer One daily tick for the day-bound background jobs: emits
+ *        dayStarted() a few seconds after every local midnight
+ */
+class MidnightTimer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MidnightTimer(QObject *parent = nullptr);
+
+    void start();
+
+signals:
+    void dayStarted(const QDate &today);
+
+private:
+    QTimer m_timer;
+
+    void scheduleNextRun();
+};
+
+#endif // MIDNIGHTTIMER_H
@@ -1,5 +1,7 @@
 #include "habitmodel.h"
 
+#include <QSignalBlocker>
+
 HabitModel::HabitModel(QObject *parent)
     : QStandardItemModel{parent}
 {}
@@ -8,8 +10,30 @@ Qt::ItemFlags HabitModel::flags(const QModelIndex &index) const
 {
     switch (index.column()) {
     case 0:
+    case 7:
+    case 8:
+    case 9:
+    case 10:
         return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
     default:
         return QStandardItemModel::flags(index);
     }
 }
+
+void HabitModel::setHabitStatus(int habitId, HabitStatus status)
+{
+    for (int row = 0; row < rowCount(); ++row) {
+        if (item(row, IdColumn)->text().toInt() != habitId) continue;
+
+        QStandardItem *statusItem = item(row, StatusColumn);
+        if (!statusItem) return;
+        {
+            QSignalBlocker blocker(this);
+            statusItem->setData(static_cast<int>(status), Utils::StatusRole);
+            statusItem->setText(Utils::habitStatusToString(status));
+        }
+        QModelIndex changed = statusItem->index();
+        emit dataChanged(changed, changed, {Qt::DisplayRole, Utils::StatusRole});
+        return;
+    }
+}
@@ -1,13 +1,36 @@
 #ifndef HABITMODEL_H
 #define HABITMODEL_H
 
+#include "../utils.h"
+
 #include <QStandardItemModel>
 
 class HabitModel : public QStandardItemModel
 {
 public:
+    enum Column {
+        IdColumn = 0,
+        NameColumn = 1,
+        CreatedDateColumn = 2,
+        FrequencyColumn = 3,
+        TotalColumn = 4,
+        StreakColumn = 5,
+        StatusColumn = 6,
+        RateColumn = 7,  // 7, 30 and 365 day rates in three columns
+        TrendColumn = 10,
+    };
+
+    // QList<double> of rolling completion rates drawn by SparklineDelegate
+    static constexpr int TrendRole = Qt::UserRole + 2;
+
     explicit HabitModel(QObject *parent = nullptr);
     Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    /**
+     * @brief setHabitStatus Updates the status cell of a loaded habit without
+     *        emitting an edit, so the change is not written back to the database
+     */
+    void setHabitStatus(int habitId, HabitStatus status);
 };
 
 #endif // HABITMODEL_H
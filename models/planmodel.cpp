@@ -1,15 +1,346 @@
 #include "planmodel.h"
 
+#include <QDataStream>
+#include <QMimeData>
+#include <QSignalBlocker>
+
+#include <algorithm>
+
+static const QString kRowsMimeType = QStringLiteral("application/x-planmodel-rows");
+
 PlanModel::PlanModel(QObject *parent)
     : QStandardItemModel{parent}
+    , m_nextRowKey(1)
 {}
 
 Qt::ItemFlags PlanModel::flags(const QModelIndex &index) const
 {
+    if (!index.isValid()) {
+        return QStandardItemModel::flags(index);
+    }
+    // Rows are dragged whole and dropped between rows, never onto one
     switch (index.column()) {
     case 0:
-        return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled;
     default:
-        return QStandardItemModel::flags(index);
+        return (QStandardItemModel::flags(index) | Qt::ItemIsDragEnabled) & ~Qt::ItemIsDropEnabled;
+    }
+}
+
+bool PlanModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (index.data(role) == value) {
+        return true;
+    }
+    if (!QStandardItemModel::setData(index, value, role)) {
+        return false;
+    }
+
+    if (index.column() != 0 && (role == Qt::EditRole || role == Utils::StatusRole)) {
+        QSignalBlocker blocker(this);
+        item(index.row(), 0)->setData(true, DirtyRole);
     }
+    return true;
+}
+
+bool PlanModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (!parent.isValid()) {
+        for (int i = row; i < row + count && i < rowCount(); ++i) {
+            if (planId(i) == 0) continue;
+            PlanData plan;
+            plan.id = planId(i);
+            plan.type = item(i, 0)->text();
+            plan.name = item(i, 1)->text();
+            plan.status = Utils::planStatusFromInt(item(i, 2)->data(Utils::StatusRole).toInt());
+            if (plan.type == QStringLiteral("习惯")) {
+                plan.habitId = refId(i);
+            } else {
+                plan.taskId = refId(i);
+            }
+            if (plan.id < 0) {
+                m_removedInserts.insert(rowKey(i), plan);
+            } else {
+                m_removedPlans.append(plan);
+            }
+        }
+    }
+    return QStandardItemModel::removeRows(row, count, parent);
+}
+
+QStringList PlanModel::mimeTypes() const
+{
+    return {kRowsMimeType};
+}
+
+QMimeData *PlanModel::mimeData(const QModelIndexList &indexes) const
+{
+    QList<int> rows;
+    for (const QModelIndex &index : indexes) {
+        if (index.isValid() && !rows.contains(index.row())) {
+            rows.append(index.row());
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+
+    QByteArray encoded;
+    QDataStream stream(&encoded, QIODevice::WriteOnly);
+    stream << rows;
+
+    QMimeData *data = new QMimeData;
+    data->setData(kRowsMimeType, encoded);
+    return data;
+}
+
+bool PlanModel::dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent)
+{
+    Q_UNUSED(column);
+    if (action != Qt::MoveAction || !data->hasFormat(kRowsMimeType)) {
+        return false;
+    }
+
+    QList<int> rows;
+    QDataStream stream(data->data(kRowsMimeType));
+    stream >> rows;
+    if (row < 0) {
+        row = parent.isValid() ? parent.row() : rowCount();
+    }
+    movePlans(rows, row);
+
+    // The rows are moved in place; reporting the drop as unhandled keeps the
+    // view from removing the dragged source rows afterwards
+    return false;
+}
+
+void PlanModel::clearPlans()
+{
+    QStandardItemModel::removeRows(0, rowCount());
+    m_removedPlans.clear();
+    m_removedInserts.clear();
+}
+
+void PlanModel::appendPlan(const QString &type, const QString &name, PlanStatus status, int refId, int planId, int indexId)
+{
+    appendRow(makeRow(type, name, status, refId, planId, indexId));
+    if (indexId == 0) {
+        assignRanks(rowCount() - 1, 1);
+    }
+}
+
+void PlanModel::insertPlan(int row, const QString &type, const QString &name, PlanStatus status)
+{
+    row = qBound(0, row, rowCount());
+    insertRow(row, makeRow(type, name, status, 0, 0, 0));
+    assignRanks(row, 1);
+}
+
+int PlanModel::movePlans(QList<int> rows, int to)
+{
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [this](int row) {
+        return row < 0 || row >= rowCount();
+    }), rows.end());
+    if (rows.isEmpty()) {
+        return -1;
+    }
+
+    // Rows taken out above the drop point shift it up
+    int first = qBound(0, to, rowCount());
+    for (int row : std::as_const(rows)) {
+        if (row < to) --first;
+    }
+
+    QList<QList<QStandardItem*>> taken;
+    for (int i = rows.size() - 1; i >= 0; --i) {
+        taken.prepend(takeRow(rows.at(i)));
+    }
+    for (int i = 0; i < taken.size(); ++i) {
+        insertRow(first + i, taken.at(i));
+    }
+
+    assignRanks(first, taken.size());
+    return first;
+}
+
+QList<QStandardItem*> PlanModel::makeRow(const QString &type, const QString &name, PlanStatus status, int refId, int planId, int indexId)
+{
+    QList<QStandardItem*> items;
+    QStandardItem *typeItem = new QStandardItem(type);
+    typeItem->setData(refId, RefIdRole);
+    typeItem->setData(planId, PlanIdRole);
+    typeItem->setData(indexId, IndexRole);
+    typeItem->setData(false, DirtyRole);
+    typeItem->setData(m_nextRowKey++, RowKeyRole);
+    typeItem->setTextAlignment(Qt::AlignCenter);
+    QStandardItem *statusItem = new QStandardItem(Utils::planStatusToString(status));
+    statusItem->setData(static_cast<int>(status), Utils::StatusRole);
+    items.append(typeItem);
+    items.append(new QStandardItem(name));
+    items.append(statusItem);
+    return items;
+}
+
+void PlanModel::assignRanks(int first, int count)
+{
+    if (count <= 0) return;
+
+    const int last = first + count;
+    const int prev = first > 0 ? rank(first - 1) : 0;
+    const int next = last < rowCount() ? rank(last) : prev + (count + 1) * Database::PlanRankStep;
+    const int step = (next - prev) / (count + 1);
+
+    bool changed = false;
+    if (step >= 1) {
+        for (int i = 0; i < count; ++i) {
+            changed |= setRank(first + i, prev + (i + 1) * step);
+        }
+    } else {
+        // No gap left between the neighbours: spread the whole day out again
+        for (int row = 0; row < rowCount(); ++row) {
+            changed |= setRank(row, (row + 1) * Database::PlanRankStep);
+        }
+        first = 0;
+        count = rowCount();
+    }
+
+    if (changed) {
+        emit dataChanged(index(first, 0), index(first + count - 1, columnCount() - 1), {IndexRole});
+    }
+}
+
+bool PlanModel::setRank(int row, int rank)
+{
+    QStandardItem *typeItem = item(row, 0);
+    if (typeItem->data(IndexRole).toInt() == rank) {
+        return false;
+    }
+
+    QSignalBlocker blocker(this);
+    typeItem->setData(rank, IndexRole);
+    // New rows are written whole anyway; only a saved row becomes an edit
+    if (typeItem->data(PlanIdRole).toInt() == 0) {
+        return false;
+    }
+    typeItem->setData(true, DirtyRole);
+    return true;
+}
+
+int PlanModel::planId(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    return typeItem ? typeItem->data(PlanIdRole).toInt() : 0;
+}
+
+int PlanModel::refId(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    return typeItem ? typeItem->data(RefIdRole).toInt() : 0;
+}
+
+int PlanModel::rowKey(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    return typeItem ? typeItem->data(RowKeyRole).toInt() : 0;
+}
+
+int PlanModel::rank(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    return typeItem ? typeItem->data(IndexRole).toInt() : 0;
+}
+
+int PlanModel::rowOfKey(int rowKey) const
+{
+    for (int row = 0; row < rowCount(); ++row) {
+        if (item(row, 0)->data(RowKeyRole).toInt() == rowKey) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+bool PlanModel::isRowChanged(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    if (!typeItem) return false;
+
+    int id = typeItem->data(PlanIdRole).toInt();
+    if (id < 0) return false;
+    return id == 0 || typeItem->data(DirtyRole).toBool();
+}
+
+bool PlanModel::isAwaitingId(int row) const
+{
+    QStandardItem *typeItem = item(row, 0);
+    return typeItem && typeItem->data(PlanIdRole).toInt() < 0 && typeItem->data(DirtyRole).toBool();
+}
+
+void PlanModel::markSaved(int row)
+{
+    QStandardItem *typeItem = item(row, 0);
+    if (!typeItem) return;
+
+    QSignalBlocker blocker(this);
+    typeItem->setData(false, DirtyRole);
+    if (typeItem->data(PlanIdRole).toInt() == 0) {
+        typeItem->setData(-1, PlanIdRole);
+    }
+}
+
+bool PlanModel::setSavedId(int rowKey, int planId)
+{
+    auto it = m_removedInserts.find(rowKey);
+    if (it != m_removedInserts.end()) {
+        PlanData plan = it.value();
+        plan.id = planId;
+        m_removedPlans.append(plan);
+        m_removedInserts.erase(it);
+        return false;
+    }
+
+    int row = rowOfKey(rowKey);
+    if (row < 0) return false;
+    QSignalBlocker blocker(this);
+    item(row, 0)->setData(planId, PlanIdRole);
+    return true;
+}
+
+void PlanModel::markUnsaved(int rowKey)
+{
+    auto it = m_removedInserts.find(rowKey);
+    if (it != m_removedInserts.end()) {
+        // Never written, so there is nothing left to delete
+        m_removedInserts.erase(it);
+        return;
+    }
+
+    int row = rowOfKey(rowKey);
+    if (row < 0) return;
+    QSignalBlocker blocker(this);
+    QStandardItem *typeItem = item(row, 0);
+    typeItem->setData(true, DirtyRole);
+    if (typeItem->data(PlanIdRole).toInt() < 0) {
+        typeItem->setData(0, PlanIdRole);
+    }
+}
+
+const QList<PlanData> &PlanModel::removedPlans() const
+{
+    return m_removedPlans;
+}
+
+void PlanModel::clearRemovedPlans()
+{
+    m_removedPlans.clear();
+}
+
+QList<int> PlanModel::removedInsertKeys() const
+{
+    return m_removedInserts.keys();
+}
+
+void PlanModel::restoreRemovedPlans(const QList<PlanData> &plans)
+{
+    m_removedPlans.append(plans);
 }
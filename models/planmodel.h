@@ -1,13 +1,111 @@
 #ifndef PLANMODEL_H
 #define PLANMODEL_H
 
+#include "../database.h"
+
 #include <QStandardItemModel>
 
+/**
+ * @brief PlanModel One day's plan rows. Edits made through the view mark their
+ *        row dirty and removed saved rows are remembered, so a save writes only
+ *        what changed since the day was loaded. Rows are ordered by sparse ranks:
+ *        inserting or dragging a row rewrites that row's rank alone.
+ */
 class PlanModel : public QStandardItemModel
 {
 public:
+    // Carried by the type cell of each row
+    static constexpr int PlanIdRole = Qt::UserRole + 2;  // daily_plan id, 0 until saved, -1 while inserting
+    static constexpr int IndexRole = Qt::UserRole + 3;   // rank, saved as index_id
+    static constexpr int DirtyRole = Qt::UserRole + 4;
+    static constexpr int RowKeyRole = Qt::UserRole + 5;  // stable identity while a save is in flight
+    static constexpr int RefIdRole = Qt::UserRole + 6;   // task or habit id the row points at, by its type
+
     explicit PlanModel(QObject *parent = nullptr);
     Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
+    QStringList mimeTypes() const override;
+    QMimeData *mimeData(const QModelIndexList &indexes) const override;
+    bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) override;
+
+    /**
+     * @brief clearPlans Drops every row and the change tracking, e.g. when another day is shown
+     */
+    void clearPlans();
+
+    /**
+     * @brief appendPlan Adds a row pointing at the task or habit refId; rows without
+     *        a planId are new and always saved, rows without an indexId are ranked
+     *        after the last row
+     */
+    void appendPlan(const QString &type, const QString &name, PlanStatus status, int refId, int planId = 0, int indexId = 0);
+
+    /**
+     * @brief insertPlan Adds a new row at row, ranked between its neighbours
+     */
+    void insertPlan(int row, const QString &type, const QString &name, PlanStatus status);
+
+    /**
+     * @brief movePlans Moves the given rows, in order, to sit before row `to`
+     * @return Row the first moved plan ended up at
+     */
+    int movePlans(QList<int> rows, int to);
+
+    int planId(int row) const;
+    int refId(int row) const;
+    int rowKey(int row) const;
+    int rank(int row) const;
+
+    /**
+     * @brief isRowChanged True for new, edited and re-ranked rows; rows still
+     *        being inserted wait for their id
+     */
+    bool isRowChanged(int row) const;
+
+    /**
+     * @brief isAwaitingId True for a row whose insert is in flight and that was
+     *        edited again since; the edit can only be written once the id arrives
+     */
+    bool isAwaitingId(int row) const;
+
+    /**
+     * @brief markSaved The row's current state was handed to a save
+     */
+    void markSaved(int row);
+
+    /**
+     * @brief setSavedId Gives a row inserted by a finished save its id
+     * @return false when the row was removed meanwhile; it is queued for deletion instead
+     */
+    bool setSavedId(int rowKey, int planId);
+
+    /**
+     * @brief markUnsaved A save failed: the row counts as changed again
+     */
+    void markUnsaved(int rowKey);
+
+    /**
+     * @brief removedPlans Saved rows removed since the last save
+     */
+    const QList<PlanData> &removedPlans() const;
+    void clearRemovedPlans();
+
+    /**
+     * @brief removedInsertKeys Row keys of rows removed while their insert was in flight
+     */
+    QList<int> removedInsertKeys() const;
+    void restoreRemovedPlans(const QList<PlanData> &plans);
+
+private:
+    QList<PlanData> m_removedPlans;
+    QHash<int, PlanData> m_removedInserts;  // by row key, removed before their id arrived
+    int m_nextRowKey;
+
+    int rowOfKey(int rowKey) const;
+    QList<QStandardItem*> makeRow(const QString &type, const QString &name, PlanStatus status, int refId, int planId, int indexId);
+    void assignRanks(int first, int count);
+    bool setRank(int row, int rank);
 };
 
 #endif // PLANMODEL_H
@@ -0,0 +1,116 @@
+#include "planrangemodel.h"
+
+PlanRangeModel::PlanRangeModel(QObject *parent)
+    : QAbstractTableModel{parent}
+    , m_mode(Week)
+{
+    setRange(Week, QDate::currentDate());
+}
+
+int PlanRangeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_mode == Week ? 1 : 6;
+}
+
+int PlanRangeModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 7;
+}
+
+QVariant PlanRangeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+
+    QDate date = dateAt(index);
+    switch (role) {
+    case Qt::DisplayRole:
+        return date.day();
+    case Qt::ToolTipRole: {
+        QStringList lines;
+        lines << date.toString("yyyy年MM月dd日");
+        for (const PlanData &plan : plansAt(index)) {
+            lines << QString("%1 %2 %3").arg(plan.type, plan.name, Utils::planStatusToString(plan.status));
+        }
+        return lines.join("\n");
+    }
+    case Qt::UserRole:
+        return date;
+    default:
+        return QVariant();
+    }
+}
+
+QVariant PlanRangeModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    if (orientation == Qt::Horizontal) {
+        static const QStringList weekDays = {"周一", "周二", "周三", "周四", "周五", "周六", "周日"};
+        return weekDays.value(section);
+    }
+    return m_startDate.addDays(section * 7).toString("MM-dd");
+}
+
+void PlanRangeModel::setRange(Mode mode, const QDate &anchorDate)
+{
+    beginResetModel();
+    m_mode = mode;
+    m_anchorDate = anchorDate;
+    if (mode == Week) {
+        m_startDate = anchorDate.addDays(-anchorDate.dayOfWeek() + 1);
+    } else {
+        QDate firstDay(anchorDate.year(), anchorDate.month(), 1);
+        m_startDate = firstDay.addDays(-firstDay.dayOfWeek() + 1);
+    }
+    m_plans.clear();
+    endResetModel();
+}
+
+void PlanRangeModel::setPlans(const QMap<QDate, QList<PlanData>> &plans)
+{
+    beginResetModel();
+    m_plans = plans;
+    endResetModel();
+}
+
+PlanRangeModel::Mode PlanRangeModel::mode() const
+{
+    return m_mode;
+}
+
+QDate PlanRangeModel::anchorDate() const
+{
+    return m_anchorDate;
+}
+
+QDate PlanRangeModel::startDate() const
+{
+    return m_startDate;
+}
+
+QDate PlanRangeModel::endDate() const
+{
+    return m_startDate.addDays(rowCount() * 7 - 1);
+}
+
+QDate PlanRangeModel::dateAt(const QModelIndex &index) const
+{
+    return m_startDate.addDays(index.row() * 7 + index.column());
+}
+
+bool PlanRangeModel::isInPeriod(const QModelIndex &index) const
+{
+    return m_mode == Week || dateAt(index).month() == m_anchorDate.month();
+}
+
+const QList<PlanData> &PlanRangeModel::plansAt(const QModelIndex &index) const
+{
+    static const QList<PlanData> empty;
+    auto it = m_plans.constFind(dateAt(index));
+    return it != m_plans.constEnd() ? it.value() : empty;
+}
@@ -0,0 +1,46 @@
+#ifndef PLANRANGEMODEL_H
+#define PLANRANGEMODEL_H
+
+#include "../database.h"
+
+#include <QAbstractTableModel>
+
+/**
+ * @brief PlanRangeModel Week or month grid of plan items, one cell per day;
+ *        filled from a single range query grouped by date
+ */
+class PlanRangeModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        Week,
+        Month,
+    };
+
+    explicit PlanRangeModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void setRange(Mode mode, const QDate &anchorDate);
+    void setPlans(const QMap<QDate, QList<PlanData>> &plans);
+
+    Mode mode() const;
+    QDate anchorDate() const;
+    QDate startDate() const;
+    QDate endDate() const;
+    QDate dateAt(const QModelIndex &index) const;
+    bool isInPeriod(const QModelIndex &index) const;
+    const QList<PlanData> &plansAt(const QModelIndex &index) const;
+
+private:
+    Mode m_mode;
+    QDate m_anchorDate;
+    QDate m_startDate;
+    QMap<QDate, QList<PlanData>> m_plans;
+};
+
+#endif // PLANRANGEMODEL_H
@@ -0,0 +1,317 @@
+#include "tagindex.h"
+
+#include <QtAlgorithms>
+
+void TagBitmap::insert(int id)
+{
+    if (id < 0) return;
+    const int word = id >> 6;
+    if (word >= m_words.size()) {
+        m_words.resize(word + 1);
+    }
+    m_words[word] |= quint64(1) << (id & 63);
+}
+
+void TagBitmap::remove(int id)
+{
+    if (id < 0) return;
+    const int word = id >> 6;
+    if (word >= m_words.size()) return;
+    m_words[word] &= ~(quint64(1) << (id & 63));
+    trim();
+}
+
+bool TagBitmap::contains(int id) const
+{
+    if (id < 0) return false;
+    const int word = id >> 6;
+    return word < m_words.size() && (m_words.at(word) >> (id & 63)) & 1;
+}
+
+bool TagBitmap::isEmpty() const
+{
+    return m_words.isEmpty();
+}
+
+int TagBitmap::count() const
+{
+    int total = 0;
+    for (quint64 word : m_words) {
+        total += qPopulationCount(word);
+    }
+    return total;
+}
+
+QList<int> TagBitmap::toList() const
+{
+    QList<int> ids;
+    ids.reserve(count());
+    for (int i = 0; i < m_words.size(); ++i) {
+        for (quint64 word = m_words.at(i); word; word &= word - 1) {
+            ids.append(i * 64 + qCountTrailingZeroBits(word));
+        }
+    }
+    return ids;
+}
+
+TagBitmap &TagBitmap::operator&=(const TagBitmap &other)
+{
+    m_words.resize(qMin(m_words.size(), other.m_words.size()));
+    for (int i = 0; i < m_words.size(); ++i) {
+        m_words[i] &= other.m_words.at(i);
+    }
+    trim();
+    return *this;
+}
+
+TagBitmap &TagBitmap::operator|=(const TagBitmap &other)
+{
+    if (other.m_words.size() > m_words.size()) {
+        m_words.resize(other.m_words.size());
+    }
+    for (int i = 0; i < other.m_words.size(); ++i) {
+        m_words[i] |= other.m_words.at(i);
+    }
+    return *this;
+}
+
+TagBitmap &TagBitmap::operator-=(const TagBitmap &other)
+{
+    const int words = qMin(m_words.size(), other.m_words.size());
+    for (int i = 0; i < words; ++i) {
+        m_words[i] &= ~other.m_words.at(i);
+    }
+    trim();
+    return *this;
+}
+
+void TagBitmap::trim()
+{
+    // No trailing zero words, so an empty set has no words at all
+    while (!m_words.isEmpty() && m_words.last() == 0) {
+        m_words.removeLast();
+    }
+}
+
+struct TagIndex::Parser
+{
+    const TagIndex &index;
+    TagKind kind;
+    QStringList tokens;
+    int pos = 0;
+    QString error;
+
+    Parser(const TagIndex &index, TagKind kind, const QString &expression)
+        : index(index)
+        , kind(kind)
+    {
+        tokenize(expression);
+    }
+
+    QString peek() const
+    {
+        return pos < tokens.size() ? tokens.at(pos) : QString();
+    }
+
+    void tokenize(QString expression)
+    {
+        expression.replace(QChar(0xFF0C), ',');  // ，
+        expression.replace(QChar(0xFF01), '!');  // ！
+        expression.replace(QChar(0xFF08), '(');  // （
+        expression.replace(QChar(0xFF09), ')');  // ）
+
+        QString name;
+        for (QChar ch : std::as_const(expression)) {
+            // A dash negates only where a name could start, so "side-project" stays one tag
+            if (ch.isSpace() || QStringLiteral("|,&!()").contains(ch) || (ch == '-' && name.isEmpty())) {
+                if (!name.isEmpty()) {
+                    tokens.append(name);
+                    name.clear();
+                }
+                if (!ch.isSpace()) {
+                    tokens.append(ch == '-' ? QStringLiteral("!") : QString(ch));
+                }
+            } else {
+                name.append(ch);
+            }
+        }
+        if (!name.isEmpty()) {
+            tokens.append(name);
+        }
+    }
+
+    // Alternatives: a | b, a , b
+    TagBitmap parseOr()
+    {
+        TagBitmap result = parseAnd();
+        while (error.isEmpty() && (peek() == "|" || peek() == ",")) {
+            ++pos;
+            result |= parseAnd();
+        }
+        return result;
+    }
+
+    // Conjunctions: a b, a & b; a negated operand is subtracted instead of complemented
+    TagBitmap parseAnd()
+    {
+        TagBitmap result = parseTerm(nullptr);
+        while (error.isEmpty() && !peek().isEmpty() && peek() != "|" && peek() != "," && peek() != ")") {
+            if (peek() == "&") {
+                ++pos;
+            }
+            bool negated = false;
+            TagBitmap operand = parseTerm(&negated);
+            if (negated) {
+                result -= operand;
+            } else {
+                result &= operand;
+            }
+        }
+        return result;
+    }
+
+    // With negated set, a leading ! is reported rather than applied against every row
+    TagBitmap parseTerm(bool *negated)
+    {
+        bool negate = false;
+        while (peek() == "!") {
+            ++pos;
+            negate = !negate;
+        }
+        TagBitmap operand = parsePrimary();
+        if (negated) {
+            *negated = negate;
+            return operand;
+        }
+        if (!negate) {
+            return operand;
+        }
+        TagBitmap all = kind == TagKind::Task ? index.m_tasks : index.m_habits;
+        all -= operand;
+        return all;
+    }
+
+    TagBitmap parsePrimary()
+    {
+        const QString token = peek();
+        if (token.isEmpty() || token == ")" || token == "|" || token == "," || token == "&") {
+            fail(QStringLiteral("标签表达式不完整"));
+            return TagBitmap();
+        }
+        ++pos;
+
+        if (token == "(") {
+            TagBitmap result = parseOr();
+            if (peek() != ")") {
+                fail(QStringLiteral("缺少右括号"));
+                return TagBitmap();
+            }
+            ++pos;
+            return result;
+        }
+
+        const int tagId = index.tagId(token);
+        if (tagId == 0) {
+            fail(QString("未知标签: %1").arg(token));
+            return TagBitmap();
+        }
+        return index.tagsOf(kind).value(tagId);
+    }
+
+    void fail(const QString &message)
+    {
+        if (error.isEmpty()) {
+            error = message;
+        }
+    }
+};
+
+TagIndex::TagIndex()
+{}
+
+void TagIndex::clear()
+{
+    m_tagIds.clear();
+    m_taskTags.clear();
+    m_habitTags.clear();
+    m_tasks = TagBitmap();
+    m_habits = TagBitmap();
+}
+
+bool TagIndex::isValidName(const QString &name)
+{
+    if (name.isEmpty() || name.startsWith('-')) {
+        return false;
+    }
+    for (QChar ch : name) {
+        if (ch.isSpace() || QStringLiteral("|,&!()，！（）").contains(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TagIndex::addTag(int tagId, const QString &name)
+{
+    m_tagIds.insert(name, tagId);
+}
+
+int TagIndex::tagId(const QString &name) const
+{
+    return m_tagIds.value(name, 0);
+}
+
+QStringList TagIndex::tagNames() const
+{
+    QStringList names = m_tagIds.keys();
+    names.sort();
+    return names;
+}
+
+void TagIndex::addRow(TagKind kind, int id)
+{
+    (kind == TagKind::Task ? m_tasks : m_habits).insert(id);
+}
+
+void TagIndex::tag(TagKind kind, int tagId, int id)
+{
+    tagsOf(kind)[tagId].insert(id);
+}
+
+void TagIndex::untag(TagKind kind, int tagId, int id)
+{
+    auto it = tagsOf(kind).find(tagId);
+    if (it != tagsOf(kind).end()) {
+        it.value().remove(id);
+    }
+}
+
+bool TagIndex::hasTag(TagKind kind, int tagId, int id) const
+{
+    auto it = tagsOf(kind).constFind(tagId);
+    return it != tagsOf(kind).constEnd() && it.value().contains(id);
+}
+
+TagBitmap TagIndex::evaluate(TagKind kind, const QString &expression, QString *error) const
+{
+    Parser parser(*this, kind, expression);
+    TagBitmap result = parser.parseOr();
+    if (parser.error.isEmpty() && parser.pos < parser.tokens.size()) {
+        parser.fail(QString("无法识别: %1").arg(parser.peek()));
+    }
+
+    if (error) {
+        *error = parser.error;
+    }
+    return parser.error.isEmpty() ? result : TagBitmap();
+}
+
+QHash<int, TagBitmap> &TagIndex::tagsOf(TagKind kind)
+{
+    return kind == TagKind::Task ? m_taskTags : m_habitTags;
+}
+
+const QHash<int, TagBitmap> &TagIndex::tagsOf(TagKind kind) const
+{
+    return kind == TagKind::Task ? m_taskTags : m_habitTags;
+}
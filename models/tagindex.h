@@ -0,0 +1,89 @@
+#ifndef TAGINDEX_H
+#define TAGINDEX_H
+
+#include "../database.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief TagBitmap Set of row ids stored as one bit per id, so set algebra over
+ *        whole tables runs a machine word at a time
+ */
+class TagBitmap
+{
+public:
+    void insert(int id);
+    void remove(int id);
+    bool contains(int id) const;
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * @brief toList Ids in ascending order
+     */
+    QList<int> toList() const;
+
+    TagBitmap &operator&=(const TagBitmap &other);
+    TagBitmap &operator|=(const TagBitmap &other);
+    TagBitmap &operator-=(const TagBitmap &other);
+
+private:
+    QList<quint64> m_words;
+
+    void trim();
+};
+
+/**
+ * @brief TagIndex In-memory tag membership of tasks and habits
+ *
+ * Keeps one bitmap per tag and kind plus the bitmap of every row, which
+ * negation works against. Tag expressions are evaluated on the bitmaps alone:
+ * names next to each other (or joined by &) must all match, | or , joins
+ * alternatives, a leading ! or - negates and parentheses group.
+ * e.g. "工作 !紧急 | (学习, 健康)".
+ */
+class TagIndex
+{
+public:
+    TagIndex();
+
+    void clear();
+
+    /**
+     * @brief isValidName Tag names cannot contain expression syntax
+     */
+    static bool isValidName(const QString &name);
+
+    void addTag(int tagId, const QString &name);
+    int tagId(const QString &name) const;
+    QStringList tagNames() const;
+
+    void addRow(TagKind kind, int id);
+    void tag(TagKind kind, int tagId, int id);
+    void untag(TagKind kind, int tagId, int id);
+    bool hasTag(TagKind kind, int tagId, int id) const;
+
+    /**
+     * @brief evaluate Rows of kind matching a tag expression
+     * @param error Receives a description when the expression does not parse
+     *        or names an unknown tag; the result is empty then
+     */
+    TagBitmap evaluate(TagKind kind, const QString &expression, QString *error = nullptr) const;
+
+private:
+    struct Parser;
+
+    QHash<QString, int> m_tagIds;
+    QHash<int, TagBitmap> m_taskTags;
+    QHash<int, TagBitmap> m_habitTags;
+    TagBitmap m_tasks;
+    TagBitmap m_habits;
+
+    QHash<int, TagBitmap> &tagsOf(TagKind kind);
+    const QHash<int, TagBitmap> &tagsOf(TagKind kind) const;
+};
+
+#endif // TAGINDEX_H
@@ -1,16 +1,300 @@
 #include "taskmodel.h"
 
-TaskModel::TaskModel(QObject *parent)
+#include <QDataStream>
+#include <QMimeData>
+#include <QSignalBlocker>
+
+static const QString kTasksMimeType = QStringLiteral("application/x-taskmodel-ids");
+
+TaskModel::TaskModel(Database *dbManager, QObject *parent)
     : QStandardItemModel{parent}
+    , m_dbManager(dbManager)
+    , m_exhausted(true)
 {}
 
 Qt::ItemFlags TaskModel::flags(const QModelIndex &index) const {
+    if (!index.isValid()) {
+        return QStandardItemModel::flags(index);
+    }
     switch (index.column()) {
     case 0:
     case 2:
     case 4:
-        return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    case ProgressColumn:
+        return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
     default:
         return QStandardItemModel::flags(index);
     }
 }
+
+bool TaskModel::hasChildren(const QModelIndex &parent) const
+{
+    // Unread subtasks still show an expander
+    if (parent.isValid() && parent.column() == 0 && rowCount(parent) == 0) {
+        return parent.data(ChildCountRole).toInt() > 0;
+    }
+    return QStandardItemModel::hasChildren(parent);
+}
+
+QStringList TaskModel::mimeTypes() const
+{
+    return {kTasksMimeType};
+}
+
+QMimeData *TaskModel::mimeData(const QModelIndexList &indexes) const
+{
+    QList<int> taskIds;
+    for (const QModelIndex &index : indexes) {
+        int taskId = index.siblingAtColumn(0).data().toInt();
+        if (taskId > 0 && !taskIds.contains(taskId)) {
+            taskIds.append(taskId);
+        }
+    }
+
+    QByteArray encoded;
+    QDataStream stream(&encoded, QIODevice::WriteOnly);
+    stream << taskIds;
+
+    QMimeData *data = new QMimeData;
+    data->setData(kTasksMimeType, encoded);
+    return data;
+}
+
+bool TaskModel::dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent)
+{
+    Q_UNUSED(row);
+    Q_UNUSED(column);
+    if (action != Qt::MoveAction || !data->hasFormat(kTasksMimeType)) {
+        return false;
+    }
+
+    QList<int> taskIds;
+    QDataStream stream(data->data(kTasksMimeType));
+    stream >> taskIds;
+
+    // Dropped on a task: its subtasks; between top-level rows: top-level tasks
+    int parentId = parent.isValid() ? parent.siblingAtColumn(0).data().toInt() : 0;
+    if (!taskIds.isEmpty() && !taskIds.contains(parentId)) {
+        emit parentChangeRequested(taskIds, parentId);
+    }
+
+    // The tree is reloaded from the database once the move is saved; reporting the
+    // drop as unhandled keeps the view from removing the dragged source rows
+    return false;
+}
+
+void TaskModel::setQuery(const TaskQuery &query)
+{
+    removeRows(0, rowCount());
+
+    m_query = query;
+    m_query.limit = PageSize;
+    m_query.afterId = 0;
+    m_query.afterValue = QVariant();
+    m_exhausted = false;
+    fetchMore(QModelIndex());
+}
+
+const TaskQuery &TaskModel::query() const
+{
+    return m_query;
+}
+
+void TaskModel::setTaskStatus(const QList<int> &taskIds, TaskStatus status, const QDate &completedDate)
+{
+    const QSet<int> ids(taskIds.cbegin(), taskIds.cend());
+    const bool keepRows = m_query.statuses.isEmpty() || m_query.statuses.contains(status);
+    setTaskStatus(invisibleRootItem(), ids, status, completedDate, keepRows);
+}
+
+void TaskModel::setTaskStatus(QStandardItem *parentItem, const QSet<int> &ids, TaskStatus status, const QDate &completedDate, bool keepRows)
+{
+    for (int row = parentItem->rowCount() - 1; row >= 0; --row) {
+        QStandardItem *idItem = parentItem->child(row, 0);
+        bool matched = ids.contains(idItem->text().toInt());
+        if (matched && !keepRows) {
+            parentItem->removeRow(row);
+            continue;
+        }
+
+        setTaskStatus(idItem, ids, status, completedDate, keepRows);
+        if (!matched) continue;
+
+        QStandardItem *completedItem = parentItem->child(row, CompletedDateColumn);
+        QStandardItem *statusItem = parentItem->child(row, StatusColumn);
+        {
+            QSignalBlocker blocker(this);
+            completedItem->setText(completedDate.toString("yyyy年MM月dd日"));
+            statusItem->setData(static_cast<int>(status), Utils::StatusRole);
+            statusItem->setText(Utils::taskStatusToString(status));
+        }
+        emit dataChanged(completedItem->index(), statusItem->index(), {Qt::DisplayRole, Utils::StatusRole});
+    }
+}
+
+void TaskModel::refreshProgress()
+{
+    QList<QStandardItem*> idItems;
+    collectIdItems(invisibleRootItem(), idItems);
+
+    QList<int> taskIds;
+    taskIds.reserve(idItems.size());
+    for (QStandardItem *idItem : std::as_const(idItems)) {
+        taskIds.append(idItem->text().toInt());
+    }
+    const QHash<int, TaskProgress> progress = m_dbManager->getTaskProgress(taskIds);
+
+    for (int i = 0; i < idItems.size(); ++i) {
+        QStandardItem *idItem = idItems.at(i);
+        QStandardItem *parentItem = idItem->parent() ? idItem->parent() : invisibleRootItem();
+        QStandardItem *progressItem = parentItem->child(idItem->row(), ProgressColumn);
+        {
+            QSignalBlocker blocker(this);
+            setProgress(idItem, progressItem, progress.value(taskIds.at(i)));
+        }
+        QModelIndex changed = progressItem->index();
+        emit dataChanged(changed, changed, {Qt::DisplayRole});
+    }
+}
+
+QModelIndex TaskModel::revealTask(int taskId)
+{
+    QList<int> path = m_dbManager->getTaskAncestors(taskId);
+    path.append(taskId);
+
+    QStandardItem *parentItem = invisibleRootItem();
+    QStandardItem *found = nullptr;
+    for (int id : std::as_const(path)) {
+        if (parentItem != invisibleRootItem() && canFetchMore(parentItem->index())) {
+            fetchChildren(parentItem);
+        }
+
+        found = nullptr;
+        for (int row = 0; !found; ++row) {
+            // Top-level rows are paged in until the task shows up
+            if (row >= parentItem->rowCount()) {
+                if (parentItem != invisibleRootItem() || m_exhausted) break;
+                fetchMore(QModelIndex());
+                if (row >= parentItem->rowCount()) break;
+            }
+            if (parentItem->child(row, 0)->text().toInt() == id) {
+                found = parentItem->child(row, 0);
+            }
+        }
+
+        // An ancestor the filter leaves out puts its subtasks at the top level
+        if (!found && parentItem == invisibleRootItem()) continue;
+        if (!found) return QModelIndex();
+        parentItem = found;
+    }
+    return found ? found->index() : QModelIndex();
+}
+
+QString TaskModel::taskName(int taskId) const
+{
+    const QList<QStandardItem*> items = findItems(QString::number(taskId), Qt::MatchExactly | Qt::MatchRecursive, 0);
+    if (items.isEmpty()) {
+        return QString();
+    }
+    QStandardItem *idItem = items.first();
+    QStandardItem *parentItem = idItem->parent() ? idItem->parent() : invisibleRootItem();
+    return parentItem->child(idItem->row(), 1)->text();
+}
+
+bool TaskModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        QModelIndex idIndex = parent.siblingAtColumn(0);
+        return idIndex.data(ChildCountRole).toInt() > 0 && !idIndex.data(ChildrenLoadedRole).toBool();
+    }
+    return !m_exhausted;
+}
+
+void TaskModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        if (canFetchMore(parent)) {
+            fetchChildren(itemFromIndex(parent.siblingAtColumn(0)));
+        }
+        return;
+    }
+    if (m_exhausted) {
+        return;
+    }
+
+    const QList<TaskData> page = m_dbManager->queryTasks(m_query);
+    m_exhausted = page.size() < m_query.limit;
+    if (page.isEmpty()) {
+        return;
+    }
+
+    appendTasks(invisibleRootItem(), page);
+    m_query.continueAfter(page.last());
+}
+
+void TaskModel::fetchChildren(QStandardItem *parentItem)
+{
+    {
+        QSignalBlocker blocker(this);
+        parentItem->setData(true, ChildrenLoadedRole);
+    }
+
+    // Subtasks come whole, under the status filter and order of the top level
+    TaskQuery childQuery;
+    childQuery.statuses = m_query.statuses;
+    childQuery.sortKey = m_query.sortKey;
+    childQuery.descending = m_query.descending;
+    childQuery.parentId = parentItem->text().toInt();
+    appendTasks(parentItem, m_dbManager->queryTasks(childQuery));
+}
+
+void TaskModel::appendTasks(QStandardItem *parentItem, const QList<TaskData> &tasks)
+{
+    QList<int> taskIds;
+    taskIds.reserve(tasks.size());
+    for (const TaskData &taskData : tasks) {
+        taskIds.append(taskData.id);
+    }
+    const QHash<int, TaskProgress> progress = m_dbManager->getTaskProgress(taskIds);
+
+    for (const TaskData &taskData : tasks) {
+        QList<QStandardItem*> items;
+        items.append(new QStandardItem(QString::number(taskData.id)));
+        items.append(new QStandardItem(taskData.name));
+        items.append(new QStandardItem(taskData.createdDate.toString("yyyy年MM月dd日")));
+        items.append(new QStandardItem(taskData.dueDate.toString("yyyy年MM月dd日")));
+        items.append(new QStandardItem(taskData.completedDate.toString("yyyy年MM月dd日")));
+        QStandardItem *statusItem = new QStandardItem(Utils::taskStatusToString(taskData.status));
+        statusItem->setData(static_cast<int>(taskData.status), Utils::StatusRole);
+        items.append(statusItem);
+        items.append(new QStandardItem());
+        setProgress(items[0], items[ProgressColumn], progress.value(taskData.id));
+
+        for (int i = 0; i < items.size(); ++i) {
+            if (i == 1) continue;
+            items[i]->setTextAlignment(Qt::AlignCenter);
+        }
+
+        parentItem->appendRow(items);
+    }
+}
+
+void TaskModel::setProgress(QStandardItem *idItem, QStandardItem *progressItem, const TaskProgress &progress)
+{
+    idItem->setData(progress.children, ChildCountRole);
+    if (progress.total > 0) {
+        progressItem->setText(QString("%1/%2 (%3%)").arg(progress.completed).arg(progress.total)
+                                                    .arg(progress.completed * 100 / progress.total));
+    } else {
+        progressItem->setText(QString());
+    }
+}
+
+void TaskModel::collectIdItems(QStandardItem *parentItem, QList<QStandardItem*> &idItems) const
+{
+    for (int row = 0; row < parentItem->rowCount(); ++row) {
+        QStandardItem *idItem = parentItem->child(row, 0);
+        idItems.append(idItem);
+        collectIdItems(idItem, idItems);
+    }
+}
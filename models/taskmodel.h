@@ -1,13 +1,76 @@
 #ifndef TASKMODEL_H
 #define TASKMODEL_H
 
+#include "../database.h"
+
+#include <QSet>
 #include <QStandardItemModel>
 
+/**
+ * @brief TaskModel Task tree filled on demand: setQuery() loads the first page of
+ *        top-level tasks and the view pulls the next one through fetchMore() as it
+ *        scrolls. Subtasks are read when their parent is first expanded; dropping
+ *        rows onto a task asks for them to become its subtasks.
+ */
 class TaskModel : public QStandardItemModel
 {
+    Q_OBJECT
 public:
-    explicit TaskModel(QObject *parent = nullptr);
+    static constexpr int PageSize = 200;
+    static constexpr int CompletedDateColumn = 4;
+    static constexpr int StatusColumn = 5;
+    static constexpr int ProgressColumn = 6;
+
+    // Carried by the id cell of each row
+    static constexpr int ChildCountRole = Qt::UserRole + 2;      // direct subtasks in the database
+    static constexpr int ChildrenLoadedRole = Qt::UserRole + 3;
+
+    explicit TaskModel(Database *dbManager, QObject *parent = nullptr);
     Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QStringList mimeTypes() const override;
+    QMimeData *mimeData(const QModelIndexList &indexes) const override;
+    bool dropMimeData(const QMimeData *data, Qt::DropAction action, int row, int column, const QModelIndex &parent) override;
+
+    void setQuery(const TaskQuery &query);
+    const TaskQuery &query() const;
+
+    /**
+     * @brief setTaskStatus Updates the status and completed date cells of loaded tasks
+     *        without emitting an edit; rows the current status filter no longer
+     *        matches are dropped. An invalid completedDate clears the date cell.
+     */
+    void setTaskStatus(const QList<int> &taskIds, TaskStatus status, const QDate &completedDate);
+
+    /**
+     * @brief refreshProgress Rereads the subtree rollups of every loaded task
+     */
+    void refreshProgress();
+
+    /**
+     * @brief revealTask Loads the rows down to a task, paging and expanding its ancestors
+     * @return Index of the task's id cell, invalid when the current query hides it
+     */
+    QModelIndex revealTask(int taskId);
+
+    QString taskName(int taskId) const;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+signals:
+    void parentChangeRequested(const QList<int> &taskIds, int parentId);
+
+private:
+    Database *m_dbManager;
+    TaskQuery m_query;  // cursor sits after the last loaded top-level row
+    bool m_exhausted;
+
+    void fetchChildren(QStandardItem *parentItem);
+    void appendTasks(QStandardItem *parentItem, const QList<TaskData> &tasks);
+    void setProgress(QStandardItem *idItem, QStandardItem *progressItem, const TaskProgress &progress);
+    void setTaskStatus(QStandardItem *parentItem, const QSet<int> &ids, TaskStatus status, const QDate &completedDate, bool keepRows);
+    void collectIdItems(QStandardItem *parentItem, QList<QStandardItem*> &idItems) const;
 };
 
 #endif // TASKMODEL_H
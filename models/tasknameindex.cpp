@@ -0,0 +1,201 @@
+#include "tasknameindex.h"
+#include "../utils.h"
+
+#include <algorithm>
+#include <limits>
+
+TaskNameIndex::TaskNameIndex()
+{}
+
+void TaskNameIndex::insert(int id, const QString &name)
+{
+    if (m_entries.contains(id)) {
+        remove(id);
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.key = name.toLower();
+    entry.initials = Utils::pinyinInitials(name);
+    if (entry.initials == entry.key) {
+        entry.initials.clear();
+    }
+
+    insertSorted(m_sortedNames, entry.key, id);
+    addPostings(entry.key, id);
+    if (!entry.initials.isEmpty()) {
+        insertSorted(m_sortedInitials, entry.initials, id);
+        addPostings(entry.initials, id);
+    }
+
+    m_nameCount[name]++;
+    m_entries.insert(id, entry);
+}
+
+void TaskNameIndex::remove(int id)
+{
+    auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    const Entry &entry = it.value();
+    removeSorted(m_sortedNames, entry.key, id);
+    removePostings(entry.key, id);
+    if (!entry.initials.isEmpty()) {
+        removeSorted(m_sortedInitials, entry.initials, id);
+        removePostings(entry.initials, id);
+    }
+
+    auto countIt = m_nameCount.find(entry.name);
+    if (countIt != m_nameCount.end() && --countIt.value() <= 0) {
+        m_nameCount.erase(countIt);
+    }
+
+    m_entries.erase(it);
+}
+
+void TaskNameIndex::clear()
+{
+    m_entries.clear();
+    m_nameCount.clear();
+    m_sortedNames.clear();
+    m_sortedInitials.clear();
+    m_postings.clear();
+}
+
+bool TaskNameIndex::contains(int id) const
+{
+    return m_entries.contains(id);
+}
+
+bool TaskNameIndex::containsName(const QString &name) const
+{
+    return m_nameCount.contains(name);
+}
+
+QString TaskNameIndex::name(int id) const
+{
+    auto it = m_entries.constFind(id);
+    return it != m_entries.constEnd() ? it.value().name : QString();
+}
+
+int TaskNameIndex::size() const
+{
+    return m_entries.size();
+}
+
+QList<int> TaskNameIndex::match(const QString &query) const
+{
+    QList<int> result;
+    const QString needle = query.trimmed().toLower();
+
+    if (needle.isEmpty()) {
+        result.reserve(m_sortedNames.size());
+        for (const SortedKey &sortedKey : m_sortedNames) {
+            result.append(sortedKey.id);
+        }
+        return result;
+    }
+
+    QSet<int> seen;
+    collectPrefix(m_sortedNames, needle, result, seen);
+    collectPrefix(m_sortedInitials, needle, result, seen);
+
+    // Smallest posting list among the query's n-grams bounds the candidates
+    const QSet<int> *candidates = nullptr;
+    for (Gram gram : gramsOf(needle)) {
+        auto it = m_postings.constFind(gram);
+        if (it == m_postings.constEnd()) {
+            return result;
+        }
+        if (!candidates || it.value().size() < candidates->size()) {
+            candidates = &it.value();
+        }
+    }
+    if (!candidates) {
+        return result;
+    }
+
+    QList<SortedKey> substringHits;
+    for (int id : *candidates) {
+        if (seen.contains(id)) continue;
+        const Entry &entry = m_entries[id];
+        if (entry.key.contains(needle) || entry.initials.contains(needle)) {
+            substringHits.append({entry.key, id});
+        }
+    }
+    std::sort(substringHits.begin(), substringHits.end());
+    for (const SortedKey &hit : std::as_const(substringHits)) {
+        result.append(hit.id);
+    }
+
+    return result;
+}
+
+QList<TaskNameIndex::Gram> TaskNameIndex::gramsOf(QStringView key)
+{
+    QList<Gram> grams;
+    if (key.size() == 1) {
+        grams.append(Gram(key.at(0).unicode()) << 16);
+        return grams;
+    }
+    for (qsizetype i = 0; i + 1 < key.size(); ++i) {
+        grams.append((Gram(key.at(i).unicode()) << 16) | key.at(i + 1).unicode());
+    }
+    return grams;
+}
+
+void TaskNameIndex::insertSorted(QList<SortedKey> &list, const QString &key, int id)
+{
+    SortedKey sortedKey{key, id};
+    auto it = std::lower_bound(list.begin(), list.end(), sortedKey);
+    list.insert(it, sortedKey);
+}
+
+void TaskNameIndex::removeSorted(QList<SortedKey> &list, const QString &key, int id)
+{
+    SortedKey sortedKey{key, id};
+    auto it = std::lower_bound(list.begin(), list.end(), sortedKey);
+    if (it != list.end() && it->id == id && it->key == key) {
+        list.erase(it);
+    }
+}
+
+void TaskNameIndex::collectPrefix(const QList<SortedKey> &list, const QString &prefix, QList<int> &result, QSet<int> &seen)
+{
+    auto it = std::lower_bound(list.begin(), list.end(), SortedKey{prefix, std::numeric_limits<int>::min()});
+    for (; it != list.end() && it->key.startsWith(prefix); ++it) {
+        if (!seen.contains(it->id)) {
+            seen.insert(it->id);
+            result.append(it->id);
+        }
+    }
+}
+
+void TaskNameIndex::addPostings(const QString &key, int id)
+{
+    // Unigrams serve single-character queries, bigrams everything longer
+    for (QChar ch : key) {
+        m_postings[Gram(ch.unicode()) << 16].insert(id);
+    }
+    for (Gram gram : gramsOf(key)) {
+        m_postings[gram].insert(id);
+    }
+}
+
+void TaskNameIndex::removePostings(const QString &key, int id)
+{
+    QList<Gram> grams = gramsOf(key);
+    for (QChar ch : key) {
+        grams.append(Gram(ch.unicode()) << 16);
+    }
+    for (Gram gram : std::as_const(grams)) {
+        auto it = m_postings.find(gram);
+        if (it == m_postings.end()) continue;
+        it.value().remove(id);
+        if (it.value().isEmpty()) {
+            m_postings.erase(it);
+        }
+    }
+}
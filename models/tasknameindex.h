@@ -0,0 +1,68 @@
+#ifndef TASKNAMEINDEX_H
+#define TASKNAMEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+/**
+ * @brief TaskNameIndex In-memory search index over task names
+ *
+ * Keeps sorted prefix keys and character n-gram postings for the lowercased
+ * name and its pinyin initials, so lookups never scan every task. Entries are
+ * added and removed one at a time as tasks change.
+ */
+class TaskNameIndex
+{
+public:
+    TaskNameIndex();
+
+    void insert(int id, const QString &name);
+    void remove(int id);
+    void clear();
+
+    bool contains(int id) const;
+    bool containsName(const QString &name) const;
+    QString name(int id) const;
+    int size() const;
+
+    /**
+     * @brief match Returns ids whose name or pinyin initials contain query,
+     *        prefix hits first; an empty query returns every id sorted by name
+     */
+    QList<int> match(const QString &query) const;
+
+private:
+    struct Entry {
+        QString name;
+        QString key;
+        QString initials;
+    };
+
+    struct SortedKey {
+        QString key;
+        int id;
+        bool operator<(const SortedKey &other) const
+        {
+            return key < other.key || (key == other.key && id < other.id);
+        }
+    };
+
+    using Gram = quint32;
+
+    QHash<int, Entry> m_entries;
+    QHash<QString, int> m_nameCount;
+    QList<SortedKey> m_sortedNames;
+    QList<SortedKey> m_sortedInitials;
+    QHash<Gram, QSet<int>> m_postings;
+
+    static QList<Gram> gramsOf(QStringView key);
+    static void insertSorted(QList<SortedKey> &list, const QString &key, int id);
+    static void removeSorted(QList<SortedKey> &list, const QString &key, int id);
+    static void collectPrefix(const QList<SortedKey> &list, const QString &prefix, QList<int> &result, QSet<int> &seen);
+    void addPostings(const QString &key, int id);
+    void removePostings(const QString &key, int id);
+};
+
+#endif // TASKNAMEINDEX_H
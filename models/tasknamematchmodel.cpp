@@ -0,0 +1,58 @@
+#include "tasknamematchmodel.h"
+
+TaskNameMatchModel::TaskNameMatchModel(const TaskNameIndex *index, QObject *parent)
+    : QAbstractListModel{parent}
+    , m_index(index)
+    , m_loaded(0)
+{}
+
+int TaskNameMatchModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_loaded;
+}
+
+QVariant TaskNameMatchModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_loaded) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return m_index->name(m_matches.at(index.row()));
+    case Qt::UserRole:
+        return m_matches.at(index.row());
+    default:
+        return QVariant();
+    }
+}
+
+bool TaskNameMatchModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_loaded < m_matches.size();
+}
+
+void TaskNameMatchModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    int count = qMin(PageSize, static_cast<int>(m_matches.size()) - m_loaded);
+    if (count <= 0) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_loaded, m_loaded + count - 1);
+    m_loaded += count;
+    endInsertRows();
+}
+
+void TaskNameMatchModel::setQuery(const QString &query)
+{
+    beginResetModel();
+    m_matches = m_index->match(query);
+    m_loaded = qMin(PageSize, static_cast<int>(m_matches.size()));
+    endResetModel();
+}
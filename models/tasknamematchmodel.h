@@ -0,0 +1,34 @@
+#ifndef TASKNAMEMATCHMODEL_H
+#define TASKNAMEMATCHMODEL_H
+
+#include "tasknameindex.h"
+
+#include <QAbstractListModel>
+
+/**
+ * @brief TaskNameMatchModel List of task names matching a query, exposed page by page
+ *        through canFetchMore/fetchMore so the popup only builds visible rows
+ */
+class TaskNameMatchModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    explicit TaskNameMatchModel(const TaskNameIndex *index, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+public slots:
+    void setQuery(const QString &query);
+
+private:
+    static constexpr int PageSize = 50;
+
+    const TaskNameIndex *m_index;
+    QList<int> m_matches;
+    int m_loaded;
+};
+
+#endif // TASKNAMEMATCHMODEL_H
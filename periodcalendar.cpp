@@ -0,0 +1,160 @@
+#include "periodcalendar.h"
+
+#include <QStringList>
+
+namespace {
+
+constexpr int kTypeShift = 32;
+
+qint64 makeKey(PeriodCalendar::Type type, qint64 value)
+{
+    return (qint64(static_cast<int>(type)) << kTypeShift) | value;
+}
+
+qint64 valueOf(qint64 key)
+{
+    return key & 0xffffffffLL;
+}
+
+const QStringList &typeLabels()
+{
+    static const QStringList labels = {
+        QStringLiteral("日总结"), QStringLiteral("周总结"), QStringLiteral("月总结"),
+        QStringLiteral("年中总结"), QStringLiteral("年终总结")
+    };
+    return labels;
+}
+
+QDate thursdayOf(const QDate &date)
+{
+    return date.addDays(4 - date.dayOfWeek());
+}
+
+} // namespace
+
+PeriodCalendar::Type PeriodCalendar::typeFromString(QStringView str, bool *ok)
+{
+    const QStringList &labels = typeLabels();
+    for (int i = 0; i < labels.size(); ++i) {
+        if (labels.at(i) == str) {
+            if (ok) *ok = true;
+            return static_cast<Type>(i + 1);
+        }
+    }
+    if (ok) *ok = false;
+    return Type::Day;
+}
+
+const QString &PeriodCalendar::typeToString(Type type)
+{
+    int index = static_cast<int>(type) - 1;
+    const QStringList &labels = typeLabels();
+    return labels.at(index >= 0 && index < labels.size() ? index : 0);
+}
+
+qint64 PeriodCalendar::key(Type type, const QDate &date)
+{
+    switch (type) {
+    case Type::Week:
+        // Julian day 0 is a Monday, so Mondays are multiples of seven
+        return makeKey(type, date.addDays(1 - date.dayOfWeek()).toJulianDay() / 7);
+    case Type::Month:
+        return makeKey(type, date.year() * 12 + date.month() - 1);
+    case Type::HalfYear:
+    case Type::Year:
+        return makeKey(type, date.year());
+    case Type::Day:
+    default:
+        return makeKey(Type::Day, date.toJulianDay());
+    }
+}
+
+qint64 PeriodCalendar::key(QStringView type, const QDate &date)
+{
+    return key(typeFromString(type), date);
+}
+
+PeriodCalendar::Type PeriodCalendar::typeOf(qint64 key)
+{
+    int type = static_cast<int>(key >> kTypeShift);
+    return (type >= static_cast<int>(Type::Day) && type <= static_cast<int>(Type::Year))
+               ? static_cast<Type>(type) : Type::Day;
+}
+
+QDate PeriodCalendar::startDate(qint64 key)
+{
+    qint64 value = valueOf(key);
+    switch (typeOf(key)) {
+    case Type::Week:
+        return QDate::fromJulianDay(value * 7);
+    case Type::Month:
+        return QDate(static_cast<int>(value / 12), static_cast<int>(value % 12) + 1, 1);
+    case Type::HalfYear:
+    case Type::Year:
+        return QDate(static_cast<int>(value), 1, 1);
+    case Type::Day:
+    default:
+        return QDate::fromJulianDay(value);
+    }
+}
+
+QDate PeriodCalendar::endDate(qint64 key)
+{
+    QDate start = startDate(key);
+    switch (typeOf(key)) {
+    case Type::Week:
+        return start.addDays(6);
+    case Type::Month:
+        return start.addMonths(1).addDays(-1);
+    case Type::HalfYear:
+        return QDate(start.year(), 6, 30);
+    case Type::Year:
+        return QDate(start.year(), 12, 31);
+    case Type::Day:
+    default:
+        return start;
+    }
+}
+
+QList<PeriodCalendar::KeyRange> PeriodCalendar::childRanges(qint64 key)
+{
+    QDate start = startDate(key);
+    QDate end = endDate(key);
+
+    switch (typeOf(key)) {
+    case Type::Week:
+        return {{PeriodCalendar::key(Type::Day, start), PeriodCalendar::key(Type::Day, end)}};
+    case Type::Month: {
+        QDate firstThursday = thursdayOf(start) < start ? thursdayOf(start).addDays(7) : thursdayOf(start);
+        QDate lastThursday = thursdayOf(end) > end ? thursdayOf(end).addDays(-7) : thursdayOf(end);
+        return {{PeriodCalendar::key(Type::Week, firstThursday), PeriodCalendar::key(Type::Week, lastThursday)}};
+    }
+    case Type::HalfYear:
+        return {{PeriodCalendar::key(Type::Month, start), PeriodCalendar::key(Type::Month, end)}};
+    case Type::Year:
+        return {{PeriodCalendar::key(Type::HalfYear, start), PeriodCalendar::key(Type::HalfYear, start)},
+                {PeriodCalendar::key(Type::Month, QDate(start.year(), 7, 1)), PeriodCalendar::key(Type::Month, end)}};
+    case Type::Day:
+    default:
+        return {};
+    }
+}
+
+QList<qint64> PeriodCalendar::parentKeys(qint64 key)
+{
+    QDate start = startDate(key);
+
+    switch (typeOf(key)) {
+    case Type::Day:
+        return {PeriodCalendar::key(Type::Week, start)};
+    case Type::Week:
+        return {PeriodCalendar::key(Type::Month, thursdayOf(start))};
+    case Type::Month:
+        return {PeriodCalendar::key(start.month() <= 6 ? Type::HalfYear : Type::Year, start)};
+    case Type::HalfYear:
+        return {PeriodCalendar::key(Type::Year, start)};
+    case Type::Year:
+    default:
+        return {};
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef PERIODCALENDAR_H
+#define PERIODCALENDAR_H
+
+#include <QDate>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief PeriodCalendar Maps a review type and a date to an integer period key and back
+ *
+ * The key holds the period type in the high 32 bits and a consecutive period
+ * number in the low bits, so every period of one type lies in one contiguous
+ * integer range and the children of a period are a BETWEEN scan.
+ */
+class PeriodCalendar
+{
+public:
+    enum class Type : int {
+        Day = 1,  // 日总结
+        Week,     // 周总结
+        Month,    // 月总结
+        HalfYear, // 年中总结, always January to June
+        Year,     // 年终总结
+    };
+
+    struct KeyRange {
+        qint64 first;
+        qint64 last;
+    };
+
+    static Type typeFromString(QStringView str, bool *ok = nullptr);
+    static const QString &typeToString(Type type);
+
+    static qint64 key(Type type, const QDate &date);
+    static qint64 key(QStringView type, const QDate &date);
+    static Type typeOf(qint64 key);
+    static QDate startDate(qint64 key);
+    static QDate endDate(qint64 key);
+
+    /**
+     * @brief childRanges Key ranges of the reviews a rollup of key is drafted from;
+     *        a week belongs to the month holding its Thursday
+     */
+    static QList<KeyRange> childRanges(qint64 key);
+
+    /**
+     * @brief parentKeys Periods whose rollup reads the review at key
+     */
+    static QList<qint64> parentKeys(qint64 key);
+};
+
+#endif // PERIODCALENDAR_H
@@ -0,0 +1,81 @@
+#include "plannerdialog.h"
+#include "ui_plannerdialog.h"
+#include "delegates/plancelldelegate.h"
+
+#include <QHeaderView>
+#include <QSignalBlocker>
+
+PlannerDialog::PlannerDialog(Database *dbManager, PlanRangeModel::Mode mode, const QDate &date, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::PlannerDialog)
+    , m_dbManager(dbManager)
+    , m_model(new PlanRangeModel(this))
+{
+    ui->setupUi(this);
+
+    ui->tableView_range->setModel(m_model);
+    ui->tableView_range->setItemDelegate(new PlanCellDelegate(ui->tableView_range));
+    ui->tableView_range->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->tableView_range->setSelectionMode(QAbstractItemView::SingleSelection);
+    ui->tableView_range->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->tableView_range->verticalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    {
+        QSignalBlocker blocker(ui->comboBox_mode);
+        ui->comboBox_mode->setCurrentIndex(mode == PlanRangeModel::Week ? 0 : 1);
+    }
+    showRange(mode, date);
+}
+
+PlannerDialog::~PlannerDialog()
+{
+    delete ui;
+}
+
+void PlannerDialog::reload()
+{
+    m_model->setPlans(m_dbManager->getPlanByRange(m_model->startDate(), m_model->endDate()));
+}
+
+void PlannerDialog::showRange(PlanRangeModel::Mode mode, const QDate &anchorDate)
+{
+    m_model->setRange(mode, anchorDate);
+    reload();
+
+    if (mode == PlanRangeModel::Week) {
+        ui->label_range->setText(QString("%1 - %2").arg(m_model->startDate().toString("yyyy年MM月dd日"),
+                                                        m_model->endDate().toString("yyyy年MM月dd日")));
+    } else {
+        ui->label_range->setText(anchorDate.toString("yyyy年MM月"));
+    }
+}
+
+void PlannerDialog::on_pushButton_prev_clicked()
+{
+    QDate anchor = m_model->anchorDate();
+    showRange(m_model->mode(), m_model->mode() == PlanRangeModel::Week ? anchor.addDays(-7) : anchor.addMonths(-1));
+}
+
+void PlannerDialog::on_pushButton_next_clicked()
+{
+    QDate anchor = m_model->anchorDate();
+    showRange(m_model->mode(), m_model->mode() == PlanRangeModel::Week ? anchor.addDays(7) : anchor.addMonths(1));
+}
+
+void PlannerDialog::on_pushButton_today_clicked()
+{
+    showRange(m_model->mode(), QDate::currentDate());
+}
+
+void PlannerDialog::on_comboBox_mode_currentIndexChanged(int index)
+{
+    showRange(index == 0 ? PlanRangeModel::Week : PlanRangeModel::Month, m_model->anchorDate());
+}
+
+void PlannerDialog::on_tableView_range_doubleClicked(const QModelIndex &index)
+{
+    if (!index.isValid()) {
+        return;
+    }
+    emit dateActivated(m_model->dateAt(index));
+}
@@ -0,0 +1,41 @@
+#ifndef PLANNERDIALOG_H
+#define PLANNERDIALOG_H
+
+#include "database.h"
+#include "models/planrangemodel.h"
+
+#include <QDialog>
+
+namespace Ui {
+class PlannerDialog;
+}
+
+class PlannerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit PlannerDialog(Database *dbManager, PlanRangeModel::Mode mode, const QDate &date, QWidget *parent = nullptr);
+    ~PlannerDialog();
+
+    void reload();
+
+signals:
+    void dateActivated(const QDate &date);
+
+private slots:
+    void on_pushButton_prev_clicked();
+    void on_pushButton_next_clicked();
+    void on_pushButton_today_clicked();
+    void on_comboBox_mode_currentIndexChanged(int index);
+    void on_tableView_range_doubleClicked(const QModelIndex &index);
+
+private:
+    Ui::PlannerDialog *ui;
+    Database *m_dbManager;
+    PlanRangeModel *m_model;
+
+    void showRange(PlanRangeModel::Mode mode, const QDate &anchorDate);
+};
+
+#endif // PLANNERDIALOG_H
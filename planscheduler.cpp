@@ -0,0 +1,81 @@
+#include "planscheduler.h"
+#include "database.h"
+
+static const char *kSchedulerConnection = "plan_scheduler";
+
+PlanSchedulerWorker::PlanSchedulerWorker(const QString &dbName, QObject *parent)
+    : DatabaseWorker(dbName, kSchedulerConnection, parent)
+{}
+
+void PlanSchedulerWorker::materialize(const QDate &startDate, const QDate &endDate)
+{
+    if (database()->materializeThrough(startDate, endDate) > 0) {
+        emit plansMaterialized(startDate, endDate);
+    }
+}
+
+void PlanSchedulerWorker::rematerializeHabit(int habitId, const QDate &startDate, const QDate &endDate)
+{
+    int removed = database()->clearHabitPlans(habitId, startDate);
+    int inserted = database()->materializeHabitPlans(startDate, endDate, {habitId});
+    if (removed > 0 || inserted > 0) {
+        emit plansMaterialized(startDate, endDate);
+    }
+}
+
+void PlanSchedulerWorker::rollForward(const QDate &today, int maxDays)
+{
+    if (database()->rollForwardToToday(today, maxDays) > 0) {
+        emit plansMaterialized(today, today);
+    }
+}
+
+PlanScheduler::PlanScheduler(const QString &dbName, int horizonDays, QObject *parent)
+    : QObject{parent}
+    , m_horizonDays(qMax(0, horizonDays))
+    , m_rollForwardDays(0)
+{
+    PlanSchedulerWorker *worker = new PlanSchedulerWorker(dbName);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &PlanScheduler::materializeRequested, worker, &PlanSchedulerWorker::materialize);
+    connect(this, &PlanScheduler::rematerializeRequested, worker, &PlanSchedulerWorker::rematerializeHabit);
+    connect(this, &PlanScheduler::rollForwardRequested, worker, &PlanSchedulerWorker::rollForward);
+    connect(worker, &PlanSchedulerWorker::plansMaterialized, this, &PlanScheduler::plansMaterialized);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+PlanScheduler::~PlanScheduler()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void PlanScheduler::start()
+{
+    QDate today = QDate::currentDate();
+    emit materializeRequested(today, today.addDays(m_horizonDays));
+    // Queued after the habit rows, so rolled tasks rank below them
+    if (m_rollForwardDays > 0) {
+        emit rollForwardRequested(today, m_rollForwardDays);
+    }
+}
+
+void PlanScheduler::habitAdded(int habitId)
+{
+    QDate today = QDate::currentDate();
+    emit rematerializeRequested(habitId, today, today.addDays(m_horizonDays));
+}
+
+void PlanScheduler::habitScheduleChanged(int habitId)
+{
+    QDate tomorrow = QDate::currentDate().addDays(1);
+    emit rematerializeRequested(habitId, tomorrow, QDate::currentDate().addDays(m_horizonDays));
+}
+
+void PlanScheduler::setRollForwardDays(int days)
+{
+    m_rollForwardDays = qMax(0, days);
+}
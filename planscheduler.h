@@ -0,0 +1,63 @@
+#ifndef PLANSCHEDULER_H
+#define PLANSCHEDULER_H
+
+#include "databaseworker.h"
+
+#include <QDate>
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief PlanSchedulerWorker Writes materialized habit plan rows on its own
+ *        database connection inside the scheduler thread
+ */
+class PlanSchedulerWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit PlanSchedulerWorker(const QString &dbName, QObject *parent = nullptr);
+
+public slots:
+    void materialize(const QDate &startDate, const QDate &endDate);
+    void rematerializeHabit(int habitId, const QDate &startDate, const QDate &endDate);
+    void rollForward(const QDate &today, int maxDays);
+
+signals:
+    void plansMaterialized(const QDate &startDate, const QDate &endDate);
+};
+
+/**
+ * @brief PlanScheduler Keeps due habit rows materialized in daily_plan for
+ *        the next horizonDays days; each start() rolls the window forward, and
+ *        with roll-forward enabled moves unfinished task rows onto the new day
+ */
+class PlanScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PlanScheduler(const QString &dbName, int horizonDays, QObject *parent = nullptr);
+    ~PlanScheduler();
+
+    void start();
+    void habitAdded(int habitId);
+    void habitScheduleChanged(int habitId);
+
+    /**
+     * @brief setRollForwardDays Days looked back for unfinished task rows on each
+     *        run, so a week away is caught up on return; 0 turns roll-forward off
+     */
+    void setRollForwardDays(int days);
+
+signals:
+    void plansMaterialized(const QDate &startDate, const QDate &endDate);
+    void materializeRequested(const QDate &startDate, const QDate &endDate);
+    void rematerializeRequested(int habitId, const QDate &startDate, const QDate &endDate);
+    void rollForwardRequested(const QDate &today, int maxDays);
+
+private:
+    QThread m_thread;
+    int m_horizonDays;
+    int m_rollForwardDays;
+};
+
+#endif // PLANSCHEDULER_H
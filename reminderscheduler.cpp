@@ -0,0 +1,190 @@
+#include "reminderscheduler.h"
+
+#include <QDateTime>
+#include <algorithm>
+#include <functional>
+
+// Long waits are cut into hours, so waking from sleep or a clock change is
+// caught up on without reading anything again
+static const qint64 kMaxWaitMsecs = 60 * 60 * 1000;
+
+ReminderScheduler::ReminderScheduler(int taskLeadDays, const QTime &taskTime, const QTime &habitTime, QObject *parent)
+    : QObject{parent}
+    , m_taskLeadDays(qMax(0, taskLeadDays))
+    , m_taskTime(taskTime)
+    , m_habitTime(habitTime)
+    , m_generation(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ReminderScheduler::fire);
+}
+
+void ReminderScheduler::updateTasks(const QList<TaskData> &tasks)
+{
+    const QDate today = QDate::currentDate();
+    for (const TaskData &task : tasks) {
+        if (task.status != TaskStatus::InProgress || !task.dueDate.isValid() || task.dueDate < today) {
+            m_tasks.remove(task.id);
+            m_remindedTasks.remove(task.id);
+            continue;
+        }
+        if (m_remindedTasks.value(task.id) == task.dueDate) {
+            continue;
+        }
+
+        // A reminder time already passed fires at once, e.g. for a task due tomorrow added tonight
+        Scheduled scheduled;
+        scheduled.name = task.name;
+        scheduled.date = task.dueDate;
+        scheduled.when = QDateTime(task.dueDate.addDays(-m_taskLeadDays), m_taskTime).toMSecsSinceEpoch();
+        push(Reminder::Kind::Task, task.id, scheduled);
+    }
+    rearm();
+}
+
+void ReminderScheduler::removeTasks(const QList<int> &taskIds)
+{
+    for (int taskId : taskIds) {
+        m_tasks.remove(taskId);
+        m_remindedTasks.remove(taskId);
+    }
+    rearm();
+}
+
+void ReminderScheduler::updateHabits(const QList<HabitData> &habits)
+{
+    const QDate today = QDate::currentDate();
+    for (const HabitData &habit : habits) {
+        if (habit.status != HabitStatus::InProgress) {
+            m_habits.remove(habit.id);
+            continue;
+        }
+
+        Scheduled scheduled;
+        scheduled.name = habit.name;
+        scheduled.createdDate = habit.createdDate;
+        scheduled.schedule = Utils::habitSchedule(habit.target_frequency);
+        QDate from = m_remindedHabits.value(habit.id) == today ? today.addDays(1) : today;
+        if (!scheduleHabit(habit.id, scheduled, from)) {
+            m_habits.remove(habit.id);
+        }
+    }
+    rearm();
+}
+
+void ReminderScheduler::removeHabits(const QList<int> &habitIds)
+{
+    for (int habitId : habitIds) {
+        m_habits.remove(habitId);
+        m_remindedHabits.remove(habitId);
+    }
+    rearm();
+}
+
+QHash<int, ReminderScheduler::Scheduled> &ReminderScheduler::scheduledOf(Reminder::Kind kind)
+{
+    return kind == Reminder::Kind::Task ? m_tasks : m_habits;
+}
+
+void ReminderScheduler::push(Reminder::Kind kind, int id, Scheduled scheduled)
+{
+    // Whatever entry the reminder had stays in the heap, stale from here on
+    scheduled.generation = ++m_generation;
+    m_heap.append(Entry{scheduled.when, kind, id, scheduled.generation});
+    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+    scheduledOf(kind).insert(id, scheduled);
+}
+
+bool ReminderScheduler::scheduleHabit(int id, Scheduled scheduled, const QDate &from)
+{
+    // Every frequency repeats within a week
+    QDate day = qMax(from, scheduled.createdDate);
+    for (int i = 0; i < 7; ++i, day = day.addDays(1)) {
+        if (scheduled.schedule.isDue(scheduled.createdDate, day)) {
+            scheduled.date = day;
+            scheduled.when = QDateTime(day, m_habitTime).toMSecsSinceEpoch();
+            push(Reminder::Kind::Habit, id, scheduled);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReminderScheduler::isLive(const Entry &entry) const
+{
+    const QHash<int, Scheduled> &scheduled = entry.kind == Reminder::Kind::Task ? m_tasks : m_habits;
+    auto it = scheduled.constFind(entry.id);
+    return it != scheduled.constEnd() && it->generation == entry.generation;
+}
+
+ReminderScheduler::Entry ReminderScheduler::popTop()
+{
+    std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+    return m_heap.takeLast();
+}
+
+void ReminderScheduler::compact()
+{
+    // Stale entries are otherwise only dropped on reaching the top; rebuilding
+    // once they outnumber live ones keeps the heap within a constant of its size
+    const qsizetype live = m_tasks.size() + m_habits.size();
+    if (m_heap.size() <= 2 * live + 64) {
+        return;
+    }
+
+    m_heap.clear();
+    m_heap.reserve(live);
+    for (Reminder::Kind kind : {Reminder::Kind::Task, Reminder::Kind::Habit}) {
+        const QHash<int, Scheduled> &scheduled = scheduledOf(kind);
+        for (auto it = scheduled.cbegin(); it != scheduled.cend(); ++it) {
+            m_heap.append(Entry{it->when, kind, it.key(), it->generation});
+        }
+    }
+    std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+}
+
+void ReminderScheduler::rearm()
+{
+    compact();
+    while (!m_heap.isEmpty() && !isLive(m_heap.first())) {
+        popTop();
+    }
+    if (m_heap.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+
+    const qint64 wait = m_heap.first().when - QDateTime::currentMSecsSinceEpoch();
+    m_timer.start(static_cast<int>(qBound<qint64>(0, wait, kMaxWaitMsecs)));
+}
+
+void ReminderScheduler::fire()
+{
+    const QDate today = QDate::currentDate();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QList<Reminder> reminders;
+    while (!m_heap.isEmpty() && m_heap.first().when <= now) {
+        const Entry entry = popTop();
+        if (!isLive(entry)) continue;
+
+        const Scheduled scheduled = scheduledOf(entry.kind).take(entry.id);
+        if (entry.kind == Reminder::Kind::Habit) {
+            // A day slept through is not reminded of; the habit moves on to today at the earliest
+            scheduleHabit(entry.id, scheduled, qMax(scheduled.date.addDays(1), today));
+            if (scheduled.date < today) continue;
+            m_remindedHabits.insert(entry.id, scheduled.date);
+        } else {
+            // Passed due dates are left to the task sweeper
+            if (scheduled.date < today) continue;
+            m_remindedTasks.insert(entry.id, scheduled.date);
+        }
+        reminders.append(Reminder{entry.kind, entry.id, scheduled.name, scheduled.date});
+    }
+
+    if (!reminders.isEmpty()) {
+        emit remindersDue(reminders);
+    }
+    rearm();
+}
@@ -0,0 +1,105 @@
+#ifndef REMINDERSCHEDULER_H
+#define REMINDERSCHEDULER_H
+
+#include "database.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTime>
+#include <QTimer>
+
+/**
+ * @brief Reminder A task coming due or a habit due today
+ */
+struct Reminder {
+    enum class Kind { Task, Habit };
+
+    Kind kind;
+    int id;
+    QString name;
+    QDate date; // Due date of the task, the day the habit is due
+};
+
+/**
+ * @brief ReminderScheduler Keeps the next reminder of every open task and active
+ *        habit in a min-heap ordered by fire time, with one single-shot timer armed
+ *        for the top entry.
+ *
+ * A change pushes a fresh entry and bumps the reminder's generation rather than
+ * searching the heap; superseded entries are dropped as they surface. Nothing is
+ * read back from the database, so callers hand in every change themselves.
+ */
+class ReminderScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @param taskLeadDays Days before its due date a task is reminded of
+     * @param taskTime Time of day task reminders fire
+     * @param habitTime Time of day habits due that day are reminded of
+     */
+    ReminderScheduler(int taskLeadDays, const QTime &taskTime, const QTime &habitTime, QObject *parent = nullptr);
+
+    /**
+     * @brief updateTasks Schedules in-progress tasks whose due date has not passed;
+     *        other tasks lose their reminder. Each due date is reminded of once.
+     */
+    void updateTasks(const QList<TaskData> &tasks);
+    void removeTasks(const QList<int> &taskIds);
+
+    /**
+     * @brief updateHabits Schedules in-progress habits for their next due day;
+     *        other habits lose their reminder
+     */
+    void updateHabits(const QList<HabitData> &habits);
+    void removeHabits(const QList<int> &habitIds);
+
+signals:
+    /**
+     * @brief remindersDue Every reminder whose time has come; habits are already
+     *        scheduled again for their next due day
+     */
+    void remindersDue(const QList<Reminder> &reminders);
+
+private:
+    struct Scheduled {
+        QString name;
+        QDate date;
+        qint64 when = 0; // msecs since epoch
+        quint32 generation = 0;
+        QDate createdDate; // Habits only
+        HabitSchedule schedule; // Habits only
+    };
+
+    struct Entry {
+        qint64 when;
+        Reminder::Kind kind;
+        int id;
+        quint32 generation;
+
+        bool operator>(const Entry &other) const { return when > other.when; }
+    };
+
+    int m_taskLeadDays;
+    QTime m_taskTime;
+    QTime m_habitTime;
+    QTimer m_timer;
+    QList<Entry> m_heap;
+    QHash<int, Scheduled> m_tasks;
+    QHash<int, Scheduled> m_habits;
+    QHash<int, QDate> m_remindedTasks; // Due date each task was last reminded of
+    QHash<int, QDate> m_remindedHabits; // Day each habit was last reminded on
+    quint32 m_generation;
+
+    QHash<int, Scheduled> &scheduledOf(Reminder::Kind kind);
+    void push(Reminder::Kind kind, int id, Scheduled scheduled);
+    bool scheduleHabit(int id, Scheduled scheduled, const QDate &from);
+    bool isLive(const Entry &entry) const;
+    Entry popTop();
+    void compact();
+    void rearm();
+    void fire();
+};
+
+#endif // REMINDERSCHEDULER_H
@@ -0,0 +1,65 @@
+#include "reviewloader.h"
+#include "database.h"
+#include "periodcalendar.h"
+
+static const char *kLoaderConnection = "review_loader";
+
+ReviewLoaderWorker::ReviewLoaderWorker(const QString &dbName, const QAtomicInt *latestRequest, QObject *parent)
+    : DatabaseWorker(dbName, kLoaderConnection, parent)
+    , m_latestRequest(latestRequest)
+{}
+
+void ReviewLoaderWorker::load(int requestId, qint64 periodKey)
+{
+    if (requestId != m_latestRequest->loadRelaxed()) {
+        return;
+    }
+
+    ReviewData review = database()->getReviewByKey(periodKey);
+    if ((review.reflection.isEmpty() || review.summary.isEmpty())
+        && PeriodCalendar::typeOf(periodKey) != PeriodCalendar::Type::Day) {
+        // Drafts stay cached until a child review in the rollup range is saved
+        ReviewData draft;
+        if (!database()->getReviewDraft(periodKey, draft)) {
+            draft = database()->buildReviewDraft(periodKey);
+        }
+        if (review.reflection.isEmpty()) {
+            review.reflection = draft.reflection;
+        }
+        if (review.summary.isEmpty()) {
+            review.summary = draft.summary;
+        }
+    }
+
+    emit loaded(requestId, review.reflection, review.summary);
+}
+
+ReviewLoader::ReviewLoader(const QString &dbName, QObject *parent)
+    : QObject{parent}
+{
+    ReviewLoaderWorker *worker = new ReviewLoaderWorker(dbName, &m_latestRequest);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &ReviewLoader::loadRequested, worker, &ReviewLoaderWorker::load);
+    connect(worker, &ReviewLoaderWorker::loaded, this, [this](int requestId, const QString &reflection, const QString &summary) {
+        if (requestId == m_latestRequest.loadRelaxed()) {
+            emit loaded(requestId, reflection, summary);
+        }
+    });
+
+    m_thread.start();
+}
+
+ReviewLoader::~ReviewLoader()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+int ReviewLoader::load(qint64 periodKey)
+{
+    int requestId = m_latestRequest.fetchAndAddRelaxed(1) + 1;
+    emit loadRequested(requestId, periodKey);
+    return requestId;
+}
@@ -0,0 +1,53 @@
+#ifndef REVIEWLOADER_H
+#define REVIEWLOADER_H
+
+#include "databaseworker.h"
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief ReviewLoaderWorker Reads and decompresses review bodies on its own
+ *        database connection inside the loader thread
+ */
+class ReviewLoaderWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit ReviewLoaderWorker(const QString &dbName, const QAtomicInt *latestRequest, QObject *parent = nullptr);
+
+public slots:
+    void load(int requestId, qint64 periodKey);
+
+signals:
+    void loaded(int requestId, const QString &reflection, const QString &summary);
+
+private:
+    const QAtomicInt *m_latestRequest;
+};
+
+/**
+ * @brief ReviewLoader Fetches the review shown for a period off the GUI thread;
+ *        empty fields are drafted from the period's child reviews. Only the
+ *        newest request is answered, older ones are dropped.
+ */
+class ReviewLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReviewLoader(const QString &dbName, QObject *parent = nullptr);
+    ~ReviewLoader();
+
+    int load(qint64 periodKey);
+
+signals:
+    void loaded(int requestId, const QString &reflection, const QString &summary);
+    void loadRequested(int requestId, qint64 periodKey);
+
+private:
+    QThread m_thread;
+    QAtomicInt m_latestRequest;
+};
+
+#endif // REVIEWLOADER_H
@@ -0,0 +1,36 @@
+#include "rollforwarddialog.h"
+#include "ui_rollforwarddialog.h"
+
+RollForwardDialog::RollForwardDialog(const QDate &targetDate, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::RollForwardDialog)
+{
+    ui->setupUi(this);
+
+    ui->dateEdit_start->setDate(targetDate.addDays(-7));
+    ui->dateEdit_end->setDate(targetDate.addDays(-1));
+    ui->dateEdit_target->setDate(targetDate);
+    ui->dateEdit_start->setCalendarPopup(true);
+    ui->dateEdit_end->setCalendarPopup(true);
+    ui->dateEdit_target->setCalendarPopup(true);
+}
+
+RollForwardDialog::~RollForwardDialog()
+{
+    delete ui;
+}
+
+QDate RollForwardDialog::getStartDate()
+{
+    return ui->dateEdit_start->date();
+}
+
+QDate RollForwardDialog::getEndDate()
+{
+    return ui->dateEdit_end->date();
+}
+
+QDate RollForwardDialog::getTargetDate()
+{
+    return ui->dateEdit_target->date();
+}
@@ -0,0 +1,31 @@
+#ifndef ROLLFORWARDDIALOG_H
+#define ROLLFORWARDDIALOG_H
+
+#include <QDate>
+#include <QDialog>
+
+namespace Ui {
+class RollForwardDialog;
+}
+
+/**
+ * @brief RollForwardDialog Picks the source range and target day for rolling
+ *        unfinished task rows forward, e.g. a whole vacation onto today
+ */
+class RollForwardDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RollForwardDialog(const QDate &targetDate, QWidget *parent = nullptr);
+    ~RollForwardDialog();
+
+    QDate getStartDate();
+    QDate getEndDate();
+    QDate getTargetDate();
+
+private:
+    Ui::RollForwardDialog *ui;
+};
+
+#endif // ROLLFORWARDDIALOG_H
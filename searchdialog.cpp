@@ -0,0 +1,111 @@
+#include "searchdialog.h"
+#include "ui_searchdialog.h"
+#include "periodcalendar.h"
+#include "delegates/searchhitdelegate.h"
+
+// Pause after the last keystroke before a query is sent
+static const int kDebounceMs = 150;
+
+// Characters of context kept in front of the match in a snippet
+static const int kSnippetLead = 12;
+
+SearchDialog::SearchDialog(Searcher *searcher, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::SearchDialog)
+    , m_searcher(searcher)
+    , m_model(new QStandardItemModel(this))
+    , m_request(0)
+{
+    ui->setupUi(this);
+
+    ui->listView_results->setModel(m_model);
+    ui->listView_results->setItemDelegate(new SearchHitDelegate(ui->listView_results));
+    ui->listView_results->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->listView_results->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMs);
+    connect(&m_debounce, &QTimer::timeout, this, [this]() {
+        m_request = m_searcher->search(ui->lineEdit_query->text());
+    });
+
+    connect(m_searcher, &Searcher::found, this, [this](int requestId, const QList<SearchHit> &hits) {
+        if (requestId == m_request) {
+            showHits(hits);
+        }
+    });
+}
+
+SearchDialog::~SearchDialog()
+{
+    delete ui;
+}
+
+void SearchDialog::on_lineEdit_query_textChanged(const QString &text)
+{
+    if (text.trimmed().isEmpty()) {
+        // Invalidate whatever is still in flight
+        m_debounce.stop();
+        m_request = m_searcher->search(QString());
+        return;
+    }
+    m_debounce.start();
+}
+
+void SearchDialog::on_lineEdit_query_returnPressed()
+{
+    if (m_model->rowCount() > 0) {
+        on_listView_results_activated(m_model->index(0, 0));
+    }
+}
+
+void SearchDialog::on_listView_results_activated(const QModelIndex &index)
+{
+    if (index.isValid() && index.row() < m_hits.size()) {
+        emit hitActivated(m_hits.at(index.row()));
+    }
+}
+
+void SearchDialog::showHits(const QList<SearchHit> &hits)
+{
+    m_hits = hits;
+    m_model->clear();
+
+    const QString needle = ui->lineEdit_query->text().trimmed();
+    for (const SearchHit &hit : hits) {
+        QString kind;
+        switch (hit.kind) {
+        case SearchKind::Task:
+            kind = QStringLiteral("任务");
+            break;
+        case SearchKind::Habit:
+            kind = QStringLiteral("习惯");
+            break;
+        case SearchKind::Plan:
+            kind = QStringLiteral("计划");
+            break;
+        case SearchKind::Review:
+            kind = QString("%1 %2").arg(PeriodCalendar::typeToString(PeriodCalendar::typeOf(hit.refId)),
+                                        PeriodCalendar::startDate(hit.refId).toString("yyyy年MM月dd日"));
+            break;
+        }
+
+        // Long review text is cut down to a window that starts just before the match
+        QString text = hit.text.simplified();
+        int start = text.indexOf(needle, 0, Qt::CaseInsensitive);
+        int length = start >= 0 ? needle.size() : 0;
+        if (start > kSnippetLead) {
+            text = QStringLiteral("…") + text.mid(start - kSnippetLead);
+            start = kSnippetLead + 1;
+        }
+
+        QStandardItem *item = new QStandardItem(text);
+        item->setData(kind, SearchHitDelegate::KindRole);
+        item->setData(qMax(start, 0), SearchHitDelegate::MatchStartRole);
+        item->setData(length, SearchHitDelegate::MatchLengthRole);
+        item->setToolTip(hit.text);
+        m_model->appendRow(item);
+    }
+
+    ui->label_status->setText(needle.isEmpty() ? QString() : QString("共 %1 条结果").arg(hits.size()));
+}
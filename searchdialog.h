@@ -0,0 +1,41 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include "searcher.h"
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include <QTimer>
+
+namespace Ui {
+class SearchDialog;
+}
+
+class SearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SearchDialog(Searcher *searcher, QWidget *parent = nullptr);
+    ~SearchDialog();
+
+signals:
+    void hitActivated(const SearchHit &hit);
+
+private slots:
+    void on_lineEdit_query_textChanged(const QString &text);
+    void on_lineEdit_query_returnPressed();
+    void on_listView_results_activated(const QModelIndex &index);
+
+private:
+    Ui::SearchDialog *ui;
+    Searcher *m_searcher;
+    QStandardItemModel *m_model;
+    QTimer m_debounce;
+    int m_request;  // newest query sent to the searcher
+    QList<SearchHit> m_hits;
+
+    void showHits(const QList<SearchHit> &hits);
+};
+
+#endif // SEARCHDIALOG_H
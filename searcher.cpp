@@ -0,0 +1,51 @@
+#include "searcher.h"
+
+static const char *kSearcherConnection = "searcher";
+
+// Enough to fill the result list; the best matches come first
+static const int kSearchLimit = 50;
+
+SearcherWorker::SearcherWorker(const QString &dbName, const QAtomicInt *latestRequest, QObject *parent)
+    : DatabaseWorker(dbName, kSearcherConnection, parent)
+    , m_latestRequest(latestRequest)
+{}
+
+void SearcherWorker::search(int requestId, const QString &text)
+{
+    // Typing queues a request per keystroke; only the newest is worth running
+    if (requestId != m_latestRequest->loadRelaxed()) {
+        return;
+    }
+
+    emit found(requestId, database()->search(text, kSearchLimit));
+}
+
+Searcher::Searcher(const QString &dbName, QObject *parent)
+    : QObject{parent}
+{
+    SearcherWorker *worker = new SearcherWorker(dbName, &m_latestRequest);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &Searcher::searchRequested, worker, &SearcherWorker::search);
+    connect(worker, &SearcherWorker::found, this, [this](int requestId, const QList<SearchHit> &hits) {
+        if (requestId == m_latestRequest.loadRelaxed()) {
+            emit found(requestId, hits);
+        }
+    });
+
+    m_thread.start();
+}
+
+Searcher::~Searcher()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+int Searcher::search(const QString &text)
+{
+    int requestId = m_latestRequest.fetchAndAddRelaxed(1) + 1;
+    emit searchRequested(requestId, text);
+    return requestId;
+}
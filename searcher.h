@@ -0,0 +1,54 @@
+#ifndef SEARCHER_H
+#define SEARCHER_H
+
+#include "database.h"
+#include "databaseworker.h"
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief SearcherWorker Runs full-text queries on its own database connection
+ *        inside the search thread
+ */
+class SearcherWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit SearcherWorker(const QString &dbName, const QAtomicInt *latestRequest, QObject *parent = nullptr);
+
+public slots:
+    void search(int requestId, const QString &text);
+
+signals:
+    void found(int requestId, const QList<SearchHit> &hits);
+
+private:
+    const QAtomicInt *m_latestRequest;
+};
+
+/**
+ * @brief Searcher Answers search box queries off the GUI thread. Every keystroke
+ *        supersedes the previous request; stale ones are skipped before they run
+ *        and dropped if they finish late.
+ */
+class Searcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Searcher(const QString &dbName, QObject *parent = nullptr);
+    ~Searcher();
+
+    int search(const QString &text);
+
+signals:
+    void found(int requestId, const QList<SearchHit> &hits);
+    void searchRequested(int requestId, const QString &text);
+
+private:
+    QThread m_thread;
+    QAtomicInt m_latestRequest;
+};
+
+#endif // SEARCHER_H
@@ -0,0 +1,42 @@
+#include "storageflusher.h"
+#include "database.h"
+
+static const char *kFlusherConnection = "storage_flusher";
+
+StorageFlusherWorker::StorageFlusherWorker(const QString &dbName, QObject *parent)
+    : DatabaseWorker(dbName, kFlusherConnection, parent)
+{}
+
+void StorageFlusherWorker::flush()
+{
+    emit flushed(database()->flushToDisk());
+}
+
+StorageFlusher::StorageFlusher(const QString &dbName, int intervalSeconds, QObject *parent)
+    : QObject{parent}
+{
+    StorageFlusherWorker *worker = new StorageFlusherWorker(dbName);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &StorageFlusher::flushRequested, worker, &StorageFlusherWorker::flush);
+    connect(worker, &StorageFlusherWorker::flushed, this, &StorageFlusher::flushed);
+
+    m_timer.setInterval(qMax(1, intervalSeconds) * 1000);
+    m_timer.setTimerType(Qt::VeryCoarseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &StorageFlusher::flushRequested);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+StorageFlusher::~StorageFlusher()
+{
+    m_timer.stop();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void StorageFlusher::start()
+{
+    m_timer.start();
+}
@@ -0,0 +1,49 @@
+#ifndef STORAGEFLUSHER_H
+#define STORAGEFLUSHER_H
+
+#include "databaseworker.h"
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+
+/**
+ * @brief StorageFlusherWorker Writes the in-memory database back to its file
+ *        on its own connection inside the flusher thread
+ */
+class StorageFlusherWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit StorageFlusherWorker(const QString &dbName, QObject *parent = nullptr);
+
+public slots:
+    void flush();
+
+signals:
+    void flushed(bool ok);
+};
+
+/**
+ * @brief StorageFlusher Periodically snapshots the in-memory database to disk
+ *        so slow disks never sit on the edit path
+ */
+class StorageFlusher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StorageFlusher(const QString &dbName, int intervalSeconds, QObject *parent = nullptr);
+    ~StorageFlusher();
+
+    void start();
+
+signals:
+    void flushed(bool ok);
+    void flushRequested();
+
+private:
+    QThread m_thread;
+    QTimer m_timer;
+};
+
+#endif // STORAGEFLUSHER_H
@@ -0,0 +1,40 @@
+#include "tasksweeper.h"
+#include "database.h"
+
+static const char *kSweeperConnection = "task_sweeper";
+
+TaskSweeperWorker::TaskSweeperWorker(const QString &dbName, QObject *parent)
+    : DatabaseWorker(dbName, kSweeperConnection, parent)
+{}
+
+void TaskSweeperWorker::sweep(const QDate &today)
+{
+    const QList<int> taskIds = database()->markOverdueTasks(today);
+    if (!taskIds.isEmpty()) {
+        emit tasksOverdue(taskIds);
+    }
+}
+
+TaskSweeper::TaskSweeper(const QString &dbName, QObject *parent)
+    : QObject{parent}
+{
+    TaskSweeperWorker *worker = new TaskSweeperWorker(dbName);
+    worker->moveToThread(&m_thread);
+
+    connect(&m_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &TaskSweeper::sweepRequested, worker, &TaskSweeperWorker::sweep);
+    connect(worker, &TaskSweeperWorker::tasksOverdue, this, &TaskSweeper::tasksOverdue);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+TaskSweeper::~TaskSweeper()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void TaskSweeper::start()
+{
+    emit sweepRequested(QDate::currentDate());
+}
@@ -0,0 +1,48 @@
+#ifndef TASKSWEEPER_H
+#define TASKSWEEPER_H
+
+#include "databaseworker.h"
+
+#include <QDate>
+#include <QObject>
+#include <QThread>
+
+/**
+ * @brief TaskSweeperWorker Marks overdue tasks on its own database connection
+ *        inside the sweeper thread
+ */
+class TaskSweeperWorker : public DatabaseWorker
+{
+    Q_OBJECT
+public:
+    explicit TaskSweeperWorker(const QString &dbName, QObject *parent = nullptr);
+
+public slots:
+    void sweep(const QDate &today);
+
+signals:
+    void tasksOverdue(const QList<int> &taskIds);
+};
+
+/**
+ * @brief TaskSweeper Moves in-progress tasks whose due date has passed to 未完成
+ *        on every start(): once at launch and again on each midnight tick
+ */
+class TaskSweeper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TaskSweeper(const QString &dbName, QObject *parent = nullptr);
+    ~TaskSweeper();
+
+    void start();
+
+signals:
+    void tasksOverdue(const QList<int> &taskIds);
+    void sweepRequested(const QDate &today);
+
+private:
+    QThread m_thread;
+};
+
+#endif // TASKSWEEPER_H
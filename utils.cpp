@@ -1,88 +1,255 @@
 #include "utils.h"
 #include <QStringList>
-#include <QMap>
+#include <QCollator>
+#include <QHash>
+#include <array>
 
-Utils::Utils()
+namespace {
+
+constexpr QRgb kColorInProgress = qRgb(0x00, 0xff, 0xff); // Qt::cyan
+constexpr QRgb kColorCompleted = qRgb(0x00, 0xff, 0x00);  // Qt::green
+constexpr QRgb kColorUnfinished = qRgb(0xff, 0x00, 0x00); // Qt::red
+constexpr QRgb kColorLate = qRgb(0xff, 0xff, 0x00);       // Qt::yellow
+constexpr QRgb kColorCancelled = qRgb(0xa0, 0xa0, 0xa4);  // Qt::gray
+
+constexpr std::array<QRgb, Utils::taskStatusCount> kTaskStatusColors = {
+    kColorInProgress, kColorCompleted, kColorUnfinished, kColorLate, kColorCancelled
+};
+
+constexpr std::array<QRgb, Utils::habitStatusCount> kHabitStatusColors = {
+    kColorInProgress, kColorCompleted, kColorCancelled
+};
+
+constexpr std::array<QRgb, Utils::planStatusCount> kPlanStatusColors = {
+    kColorInProgress, kColorCompleted, kColorUnfinished
+};
+
+template <std::size_t N>
+std::array<QBrush, N> makeBrushes(const std::array<QRgb, N> &colors)
 {
+    std::array<QBrush, N> brushes;
+    for (std::size_t i = 0; i < N; ++i) {
+        brushes[i] = QBrush(QColor::fromRgb(colors[i]));
+    }
+    return brushes;
+}
 
+const QString &unknownStatus()
+{
+    static const QString str = QStringLiteral("未知状态");
+    return str;
 }
 
-QString Utils::taskStatusToString(int status)
+const QString &labelAt(const QStringList &list, int index)
 {
-    QStringList list = taskStatusList();
-    if (status >= 0 && status < list.size()) {
-        return list[status];
+    if (index >= 0 && index < list.size()) {
+        return list.at(index);
     }
-    return "未知状态";
+    return unknownStatus();
 }
 
-QString Utils::habitStatusToString(int status)
+int indexOfLabel(const QStringList &list, QStringView str)
 {
-    QStringList list = habitStatusList();
-    if (status >= 0 && status < list.size()) {
-        return list[status];
+    for (int i = 0; i < list.size(); ++i) {
+        if (list.at(i) == str) {
+            return i;
+        }
     }
-    return "未知状态";
+    return -1;
 }
 
-QString Utils::planStatusToString(int status)
+int clampStatus(int value, int count)
 {
-    QStringList list = planStatusList();
-    if (status >= 0 && status < list.size()) {
-        return list[status];
+    return (value >= 0 && value < count) ? value : 0;
+}
+
+// First character of each pinyin initial in zh_CN collation order
+constexpr char16_t kPinyinBoundaries[] = u"阿八嚓哒妸发旮哈讥咔垃痳拏噢妑七呥扨它穵夕丫帀";
+constexpr char kPinyinLetters[] = "abcdefghjklmnopqrstwxyz";
+
+QChar pinyinInitial(QChar ch)
+{
+    if (ch.unicode() < 0x4E00 || ch.unicode() > 0x9FFF) {
+        return ch.toLower();
+    }
+
+    static QHash<char16_t, QChar> cache;
+    auto it = cache.constFind(ch.unicode());
+    if (it != cache.constEnd()) {
+        return it.value();
+    }
+
+    static const QCollator collator(QLocale(QLocale::Chinese, QLocale::China));
+    const QString str(ch);
+    QChar initial = ch;
+    int lo = 0;
+    int hi = static_cast<int>(std::size(kPinyinLetters)) - 2;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (collator.compare(str, QString(QChar(kPinyinBoundaries[mid]))) >= 0) {
+            initial = QLatin1Char(kPinyinLetters[mid]);
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
     }
-    return "未知状态";
+
+    cache.insert(ch.unicode(), initial);
+    return initial;
 }
 
-QStringList Utils::taskStatusList()
+} // namespace
+
+Utils::Utils()
 {
-    return {"进行中", "已完成", "未完成", "超时完成", "已取消"};
+
 }
 
-QStringList Utils::habitStatusList()
+const QString& Utils::taskStatusToString(TaskStatus status)
 {
-    return {"进行中", "已完成", "已取消"};
+    return labelAt(taskStatusList(), static_cast<int>(status));
 }
 
-QStringList Utils::habitFrequencyList()
+const QString& Utils::habitStatusToString(HabitStatus status)
 {
-    return {"每日一次", "每二日一次", "每三日一次", "每周周一", "每周周二", "每周周三", "每周周四", "每周周五", "每周周六", "每周周日", "每周工作日", "每周休息日"};
+    return labelAt(habitStatusList(), static_cast<int>(status));
 }
 
-QStringList Utils::planStatusList()
+const QString& Utils::planStatusToString(PlanStatus status)
 {
-    return {"进行中", "已完成", "未完成"};
+    return labelAt(planStatusList(), static_cast<int>(status));
 }
 
-int Utils::taskStatusFromString(const QString &str)
+const QStringList& Utils::taskStatusList()
 {
-    QStringList list = taskStatusList();
-    int idx = list.indexOf(str);
-    return idx >= 0 ? idx : -1;
+    static const QStringList list = {
+        QStringLiteral("进行中"), QStringLiteral("已完成"), QStringLiteral("未完成"),
+        QStringLiteral("超时完成"), QStringLiteral("已取消")
+    };
+    return list;
 }
 
-int Utils::habitStatusFromString(const QString &str)
+const QStringList& Utils::habitStatusList()
 {
-    QStringList list = habitStatusList();
-    int idx = list.indexOf(str);
-    return idx >= 0 ? idx : -1;
+    static const QStringList list = {
+        QStringLiteral("进行中"), QStringLiteral("已完成"), QStringLiteral("已取消")
+    };
+    return list;
 }
 
-int Utils::planStatusFromString(const QString &str)
+const QStringList& Utils::habitFrequencyList()
 {
-    QStringList list = planStatusList();
-    int idx = list.indexOf(str);
-    return idx >= 0 ? idx : -1;
+    static const QStringList list = {
+        QStringLiteral("每日一次"), QStringLiteral("每二日一次"), QStringLiteral("每三日一次"),
+        QStringLiteral("每周周一"), QStringLiteral("每周周二"), QStringLiteral("每周周三"),
+        QStringLiteral("每周周四"), QStringLiteral("每周周五"), QStringLiteral("每周周六"),
+        QStringLiteral("每周周日"), QStringLiteral("每周工作日"), QStringLiteral("每周休息日")
+    };
+    return list;
 }
 
-const QMap<QString, QColor>& Utils::statusColorMap()
+const QStringList& Utils::planStatusList()
 {
-    static const QMap<QString, QColor> map = {
-        {"进行中", Qt::cyan},
-        {"已完成", Qt::green},
-        {"未完成", Qt::red},
-        {"超时完成", Qt::yellow},
-        {"已取消", Qt::gray}
+    static const QStringList list = {
+        QStringLiteral("进行中"), QStringLiteral("已完成"), QStringLiteral("未完成")
     };
-    return map;
+    return list;
+}
+
+TaskStatus Utils::taskStatusFromString(QStringView str, bool *ok)
+{
+    int idx = indexOfLabel(taskStatusList(), str);
+    if (ok) *ok = idx >= 0;
+    return static_cast<TaskStatus>(idx >= 0 ? idx : 0);
+}
+
+HabitStatus Utils::habitStatusFromString(QStringView str, bool *ok)
+{
+    int idx = indexOfLabel(habitStatusList(), str);
+    if (ok) *ok = idx >= 0;
+    return static_cast<HabitStatus>(idx >= 0 ? idx : 0);
+}
+
+PlanStatus Utils::planStatusFromString(QStringView str, bool *ok)
+{
+    int idx = indexOfLabel(planStatusList(), str);
+    if (ok) *ok = idx >= 0;
+    return static_cast<PlanStatus>(idx >= 0 ? idx : 0);
+}
+
+TaskStatus Utils::taskStatusFromInt(int value)
+{
+    return static_cast<TaskStatus>(clampStatus(value, taskStatusCount));
+}
+
+HabitStatus Utils::habitStatusFromInt(int value)
+{
+    return static_cast<HabitStatus>(clampStatus(value, habitStatusCount));
+}
+
+PlanStatus Utils::planStatusFromInt(int value)
+{
+    return static_cast<PlanStatus>(clampStatus(value, planStatusCount));
+}
+
+const QBrush& Utils::statusBrush(TaskStatus status)
+{
+    static const std::array<QBrush, taskStatusCount> brushes = makeBrushes(kTaskStatusColors);
+    return brushes[clampStatus(static_cast<int>(status), taskStatusCount)];
+}
+
+const QBrush& Utils::statusBrush(HabitStatus status)
+{
+    static const std::array<QBrush, habitStatusCount> brushes = makeBrushes(kHabitStatusColors);
+    return brushes[clampStatus(static_cast<int>(status), habitStatusCount)];
+}
+
+const QBrush& Utils::statusBrush(PlanStatus status)
+{
+    static const std::array<QBrush, planStatusCount> brushes = makeBrushes(kPlanStatusColors);
+    return brushes[clampStatus(static_cast<int>(status), planStatusCount)];
+}
+
+QString Utils::pinyinInitials(QStringView str)
+{
+    QString result;
+    result.reserve(str.size());
+    for (QChar ch : str) {
+        if (ch.isSpace()) continue;
+        result.append(pinyinInitial(ch));
+    }
+    return result;
+}
+
+HabitSchedule Utils::habitSchedule(const QString &frequency)
+{
+    HabitSchedule schedule;
+    if (frequency == "每日一次") {
+        schedule.period = 1;
+    }
+    else if (frequency.startsWith("每二日一次")) {
+        schedule.period = 2;
+    }
+    else if (frequency.startsWith("每三日一次")) {
+        schedule.period = 3;
+    }
+    else if (frequency.startsWith("每周工作日")) {
+        schedule.weekdayMask = 0b0011111;
+    }
+    else if (frequency.startsWith("每周休息日")) {
+        schedule.weekdayMask = 0b1100000;
+    }
+    else if (frequency.startsWith("每周周")) {
+        static const QString weekDays = QStringLiteral("一二三四五六日");
+        int target = weekDays.indexOf(frequency.mid(3, 1));
+        if (target >= 0) {
+            schedule.weekdayMask = 1 << target;
+        }
+    }
+    return schedule;
+}
+
+bool Utils::isHabitDue(const QString &frequency, const QDate &createdDate, const QDate &date)
+{
+    return habitSchedule(frequency).isDue(createdDate, date);
 }
@@ -2,25 +2,80 @@
 #define UTILS_H
 #include <QStringList>
 #include <QColor>
+#include <QBrush>
+#include <QDate>
+
+enum class TaskStatus : int {
+    InProgress = 0, // 进行中
+    Completed,      // 已完成
+    Unfinished,     // 未完成
+    LateCompleted,  // 超时完成
+    Cancelled,      // 已取消
+};
+
+enum class HabitStatus : int {
+    InProgress = 0, // 进行中
+    Completed,      // 已完成
+    Cancelled,      // 已取消
+};
+
+enum class PlanStatus : int {
+    InProgress = 0, // 进行中
+    Completed,      // 已完成
+    Unfinished,     // 未完成
+};
+
+/**
+ * @brief HabitSchedule Parsed habit frequency: every `period` days counted from
+ *        the created date, or on the weekdays set in `weekdayMask` (bit 0 = Monday)
+ */
+struct HabitSchedule {
+    int period = 0;
+    int weekdayMask = 0;
+
+    bool isDue(const QDate &createdDate, const QDate &date) const
+    {
+        if (createdDate > date) return false;
+        if (period > 0) return createdDate.daysTo(date) % period == 0;
+        return (weekdayMask >> (date.dayOfWeek() - 1)) & 1;
+    }
+};
 
 class Utils
 {
 public:
     Utils();
 
+    // Item data role carrying the status enum (as int) next to its display label
+    static constexpr int StatusRole = Qt::UserRole + 1;
+
+    static constexpr int taskStatusCount = 5;
+    static constexpr int habitStatusCount = 3;
+    static constexpr int planStatusCount = 3;
+
 public:
-    static QString taskStatusToString(int status);
-    static QString habitStatusToString(int status);
-    static QString planStatusToString(int status);
-    static QStringList taskStatusList();
-    static QStringList habitStatusList();
-    static QStringList habitFrequencyList();
-    static QStringList planStatusList();
-    static int taskStatusFromString(const QString &str);
-    static int habitStatusFromString(const QString &str);
-    static int planStatusFromString(const QString &str);
-
-    static const QMap<QString, QColor>& statusColorMap();
+    static const QString& taskStatusToString(TaskStatus status);
+    static const QString& habitStatusToString(HabitStatus status);
+    static const QString& planStatusToString(PlanStatus status);
+    static const QStringList& taskStatusList();
+    static const QStringList& habitStatusList();
+    static const QStringList& habitFrequencyList();
+    static const QStringList& planStatusList();
+    static TaskStatus taskStatusFromString(QStringView str, bool *ok = nullptr);
+    static HabitStatus habitStatusFromString(QStringView str, bool *ok = nullptr);
+    static PlanStatus planStatusFromString(QStringView str, bool *ok = nullptr);
+    static TaskStatus taskStatusFromInt(int value);
+    static HabitStatus habitStatusFromInt(int value);
+    static PlanStatus planStatusFromInt(int value);
+
+    static const QBrush& statusBrush(TaskStatus status);
+    static const QBrush& statusBrush(HabitStatus status);
+    static const QBrush& statusBrush(PlanStatus status);
+
+    static QString pinyinInitials(QStringView str);
+
+    static HabitSchedule habitSchedule(const QString &frequency);
+    static bool isHabitDue(const QString &frequency, const QDate &createdDate, const QDate &date);
 };
 
 #endif // UTILS_H